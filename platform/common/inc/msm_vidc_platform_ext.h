@@ -255,6 +255,14 @@ enum v4l2_mpeg_vidc_av1_tier {
 #define V4L2_CID_MPEG_VIDC_INTERLACE                                          \
 	(V4L2_CID_MPEG_VIDC_BASE + 0x4B)
 
+/*
+ * Control to set a producer dma_fence fd for the next input buffer.
+ * Driver holds the buffer until the fence signals and returns it with
+ * error flag if the fence fails.
+ */
+#define V4L2_CID_MPEG_VIDC_INBUF_FENCE_FD                                     \
+	(V4L2_CID_MPEG_VIDC_BASE + 0x4C)
+
 int msm_vidc_adjust_ir_period(void *instance, struct v4l2_ctrl *ctrl);
 int msm_vidc_adjust_dec_frame_rate(void *instance, struct v4l2_ctrl *ctrl);
 int msm_vidc_adjust_dec_operating_rate(void *instance, struct v4l2_ctrl *ctrl);
@@ -385,19 +385,10 @@ int msm_vidc_read_efuse(struct msm_vidc_core *core)
 
 enum msm_vidc_inst_capability_type msm_vidc_get_cap_id(struct msm_vidc_inst *inst, u32 id)
 {
-	enum msm_vidc_inst_capability_type i = INST_CAP_NONE + 1;
+	if (!inst->codec_caps)
+		return INST_CAP_NONE;
 
-	enum msm_vidc_inst_capability_type cap_id = INST_CAP_NONE;
-
-	do {
-		if (inst->capabilities[i].v4l2_id == id) {
-			cap_id = inst->capabilities[i].cap_id;
-			break;
-		}
-		i++;
-	} while (i < INST_CAP_MAX);
-
-	return cap_id;
+	return msm_vidc_cid_map_lookup(inst->codec_caps, id);
 }
 
 int msm_vidc_update_cap_value(struct msm_vidc_inst *inst, u32 cap_id,
@@ -451,8 +442,8 @@ bool is_parent_available(struct msm_vidc_inst *inst,
 		return false;
 
 	while (i < MAX_CAP_CHILDREN &&
-	       inst->capabilities[check_parent].children[i]) {
-		cap_child = inst->capabilities[check_parent].children[i];
+	       inst->cap_table[check_parent].children[i]) {
+		cap_child = inst->cap_table[check_parent].children[i];
 		if (cap_child == cap_id)
 			return true;
 		i++;
@@ -527,7 +518,7 @@ int msm_vidc_v4l2_menu_to_hfi(struct msm_vidc_inst *inst,
 	default:
 		i_vpr_e(inst,
 			"%s: mapping not specified for ctrl_id: %#x\n",
-			__func__, inst->capabilities[cap_id].v4l2_id);
+			__func__, inst->cap_table[cap_id].v4l2_id);
 		return -EINVAL;
 	}
 
@@ -535,7 +526,7 @@ set_default:
 	i_vpr_e(inst,
 		"%s: invalid value %d for ctrl id: %#x. Set default: %u\n",
 		__func__, inst->capabilities[cap_id].value,
-		inst->capabilities[cap_id].v4l2_id, *value);
+		inst->cap_table[cap_id].v4l2_id, *value);
 	return 0;
 }
 
@@ -634,7 +625,7 @@ int msm_vidc_v4l2_to_hfi_enum(struct msm_vidc_inst *inst,
 	default:
 		i_vpr_e(inst,
 			"%s: mapping not specified for ctrl_id: %#x\n",
-			__func__, inst->capabilities[cap_id].v4l2_id);
+			__func__, inst->cap_table[cap_id].v4l2_id);
 		return -EINVAL;
 	}
 
@@ -642,7 +633,7 @@ set_default:
 	i_vpr_e(inst,
 		"%s: invalid value %d for ctrl id: %#x. Set default: %u\n",
 		__func__, inst->capabilities[cap_id].value,
-		inst->capabilities[cap_id].v4l2_id, *value);
+		inst->cap_table[cap_id].v4l2_id, *value);
 	return 0;
 }
 
@@ -670,7 +661,7 @@ int msm_vidc_packetize_control(struct msm_vidc_inst *inst,
 		cap_name(cap_id), inst->capabilities[cap_id].value, payload);
 
 	rc = venus_hfi_session_property(inst,
-					inst->capabilities[cap_id].hfi_id,
+					inst->cap_table[cap_id].hfi_id,
 					HFI_HOST_FLAGS_NONE,
 					msm_vidc_get_port_info(inst, cap_id),
 					payload_type,
@@ -2200,7 +2191,7 @@ int msm_vidc_adjust_roi_info(void *instance, struct v4l2_ctrl *ctrl)
 
 int msm_vidc_adjust_dec_outbuf_fence_type(void *instance, struct v4l2_ctrl *ctrl)
 {
-	struct msm_vidc_inst_cap *capability;
+	struct msm_vidc_inst_cap_state *capability;
 	s32 adjusted_value, meta_outbuf_fence = 0;
 	struct msm_vidc_inst *inst = (struct msm_vidc_inst *)instance;
 	struct msm_vidc_core *core;
@@ -2231,7 +2222,7 @@ int msm_vidc_adjust_dec_outbuf_fence_type(void *instance, struct v4l2_ctrl *ctrl
 
 int msm_vidc_adjust_dec_outbuf_fence_direction(void *instance, struct v4l2_ctrl *ctrl)
 {
-	struct msm_vidc_inst_cap *capability;
+	struct msm_vidc_inst_cap_state *capability;
 	s32 adjusted_value, meta_outbuf_fence = 0;
 	struct msm_vidc_inst *inst = (struct msm_vidc_inst *)instance;
 	struct msm_vidc_core *core;
@@ -2736,7 +2727,7 @@ int msm_vidc_set_frame_qp(void *instance,
 {
 	int rc = 0;
 	struct msm_vidc_inst *inst = (struct msm_vidc_inst *)instance;
-	struct msm_vidc_inst_cap *capab;
+	struct msm_vidc_inst_cap_state *capab;
 	s32 i_frame_qp = 0, p_frame_qp = 0, b_frame_qp = 0;
 	u32 i_qp_enable = 0, p_qp_enable = 0, b_qp_enable = 0;
 	u32 client_qp_enable = 0, hfi_value = 0, offset = 0;
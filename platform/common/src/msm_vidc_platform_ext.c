@@ -151,7 +151,7 @@ int msm_vidc_set_ir_period(void *instance,
 		ir_type = HFI_PROP_IR_CYCLIC_PERIOD;
 	} else {
 		i_vpr_e(inst, "%s: invalid ir_type %u\n",
-			__func__, inst->capabilities[IR_TYPE].cap_id);
+			__func__, inst->cap_table[IR_TYPE].cap_id);
 		return -EINVAL;
 	}
 
@@ -1494,6 +1494,10 @@ static struct msm_platform_inst_capability instance_cap_data_qcs8300[] = {
 		0, S32_MAX, 1, 0,
 		V4L2_CID_MPEG_VIDC_ENC_INPUT_COMPRESSION_RATIO,
 		0, CAP_FLAG_DYNAMIC_ALLOWED},
+	{INBUF_FENCE_FD, DEC | ENC, CODECS_ALL,
+		INVALID_FD, INT_MAX, 1, INVALID_FD,
+		V4L2_CID_MPEG_VIDC_INBUF_FENCE_FD,
+		0, CAP_FLAG_DYNAMIC_ALLOWED},
 	{FILM_GRAIN, DEC, AV1,
 		0, 1, 1, 0,
 		V4L2_CID_MPEG_VIDC_AV1D_FILM_GRAIN_PRESENT,
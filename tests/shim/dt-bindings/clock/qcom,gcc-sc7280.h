@@ -0,0 +1,2 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* placeholder clock ids, only the names matter to the tests */
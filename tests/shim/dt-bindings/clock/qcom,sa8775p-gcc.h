@@ -0,0 +1,3 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* placeholder clock ids, only the names matter to the tests */
+#define GCC_VIDEO_AXI0_CLK              1
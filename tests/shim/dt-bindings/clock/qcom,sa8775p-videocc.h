@@ -0,0 +1,4 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* placeholder clock ids, only the names matter to the tests */
+#define VIDEO_CC_MVS0C_CLK              2
+#define VIDEO_CC_MVS0_CLK               3
@@ -0,0 +1,7 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/* placeholder clock ids, only the names matter to the tests */
+#define VIDEO_CC_MVS0_AXI_CLK           1
+#define VIDEO_CC_MVS0_CORE_CLK          2
+#define VIDEO_CC_MVSC_CORE_CLK          3
+#define VIDEO_CC_MVSC_CTL_AXI_CLK       4
+#define VIDEO_CC_VENUS_AHB_CLK          5
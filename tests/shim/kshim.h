@@ -0,0 +1,658 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Userspace stand-ins for the kernel types and helpers the driver headers
+ * touch. Only layout-irrelevant placeholders live here: anything that the
+ * buffer calculators actually compute with comes from the real headers.
+ * Mutexes and completions are backed by pthreads for the core init and
+ * lock tests; lockdep_assert_held() checks the caller owns the mutex and
+ * counts violations in lockdep_warnings. Workqueues run their work on
+ * pthread workers and, as in the kernel, never run a work item on two
+ * workers at once; delayed work is queued without the delay.
+ */
+
+#ifndef _VIDC_TEST_KSHIM_H_
+#define _VIDC_TEST_KSHIM_H_
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <linux/types.h>
+#include <linux/videodev2.h>
+
+#define __user
+#define __iomem
+#define __must_check
+#define __maybe_unused          __attribute__((unused))
+#define __printf(a, b)          __attribute__((format(printf, a, b)))
+
+#define LINUX_VERSION_CODE      KERNEL_VERSION(6, 6, 0)
+#define KERNEL_VERSION(a, b, c) (((a) << 16) + ((b) << 8) + (c))
+
+#define HZ                      100
+#define NSEC_PER_USEC           1000L
+#define NSEC_PER_MSEC           1000000L
+#define NSEC_PER_SEC            1000000000L
+#define USEC_PER_SEC            1000000L
+#define BITS_PER_LONG           (sizeof(long) * 8)
+#define BIT(nr)                 (1UL << (nr))
+#define BIT_ULL(nr)             (1ULL << (nr))
+#define GENMASK(h, l)           (((~0UL) << (l)) & (~0UL >> (BITS_PER_LONG - 1 - (h))))
+#define BITS_TO_LONGS(nr)       (((nr) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define DECLARE_BITMAP(name, bits) unsigned long name[BITS_TO_LONGS(bits)]
+#define ARRAY_SIZE(arr)         (sizeof(arr) / sizeof((arr)[0]))
+#define ALIGN(x, a)             (((x) + (a) - 1) & ~((__typeof__(x))(a) - 1))
+#define DIV_ROUND_UP(n, d)      (((n) + (d) - 1) / (d))
+#define roundup(x, y)           ((((x) + ((y) - 1)) / (y)) * (y))
+#define do_div(n, base)         ({ u32 __rem = (n) % (base); (n) /= (base); __rem; })
+#define div_u64(n, d)           ((u64)(n) / (d))
+
+#define min(a, b)               ((a) < (b) ? (a) : (b))
+#define max(a, b)               ((a) > (b) ? (a) : (b))
+#define min_t(t, a, b)          ((t)(a) < (t)(b) ? (t)(a) : (t)(b))
+#define max_t(t, a, b)          ((t)(a) > (t)(b) ? (t)(a) : (t)(b))
+#define max3(a, b, c)           max(max(a, b), c)
+#define clamp(v, lo, hi)        min(max(v, lo), hi)
+#define MIN(a, b)               min(a, b)
+#define MAX(a, b)               max(a, b)
+
+#define SZ_1K                   0x00000400
+#define SZ_4K                   0x00001000
+#define SZ_1M                   0x00100000
+
+#define U32_MAX                 ((u32)~0U)
+#define S32_MAX                 ((s32)(U32_MAX >> 1))
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define pr_err(fmt, ...)        fprintf(stderr, fmt, ##__VA_ARGS__)
+#define pr_info(fmt, ...)       fprintf(stderr, fmt, ##__VA_ARGS__)
+#define trace_printk(fmt, ...)  fprintf(stderr, fmt, ##__VA_ARGS__)
+#define WARN_ON(x)              (!!(x))
+#define BUG_ON(x)               do { if (x) __builtin_trap(); } while (0)
+
+typedef int spinlock_t;
+typedef struct { int refs; } refcount_t;
+typedef struct { int counter; } atomic_t;
+typedef u64 dma_addr_t;
+typedef u64 phys_addr_t;
+typedef long long ktime_t;
+typedef int irqreturn_t;
+
+enum dma_data_direction { DMA_BIDIRECTIONAL };
+
+struct list_head { struct list_head *next, *prev; };
+
+#define INIT_LIST_HEAD(head)    do { (head)->next = (head); (head)->prev = (head); } while (0)
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+#define list_for_each_entry(pos, head, member) \
+	for (pos = list_entry((head)->next, __typeof__(*pos), member); \
+	     &pos->member != (head); \
+	     pos = list_entry(pos->member.next, __typeof__(*pos), member))
+
+#define list_for_each_entry_safe(pos, n, head, member) \
+	for (pos = list_entry((head)->next, __typeof__(*pos), member), \
+	     n = list_entry(pos->member.next, __typeof__(*pos), member); \
+	     &pos->member != (head); \
+	     pos = n, n = list_entry(n->member.next, __typeof__(*n), member))
+
+static inline bool list_empty(const struct list_head *head)
+{
+	return head->next == head;
+}
+
+static inline void list_add_tail(struct list_head *entry, struct list_head *head)
+{
+	entry->prev = head->prev;
+	entry->next = head;
+	head->prev->next = entry;
+	head->prev = entry;
+}
+
+static inline void list_add(struct list_head *entry, struct list_head *head)
+{
+	entry->prev = head;
+	entry->next = head->next;
+	head->next->prev = entry;
+	head->next = entry;
+}
+
+static inline void list_replace_init(struct list_head *old,
+	struct list_head *new)
+{
+	new->next = old->next;
+	new->next->prev = new;
+	new->prev = old->prev;
+	new->prev->next = new;
+	INIT_LIST_HEAD(old);
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+	INIT_LIST_HEAD(entry);
+}
+
+#define LIST_HEAD(name)         struct list_head name = { &(name), &(name) }
+#define list_first_entry(ptr, type, member) list_entry((ptr)->next, type, member)
+
+static inline void list_del_init(struct list_head *entry)
+{
+	list_del(entry);
+}
+
+static inline void list_splice_init(struct list_head *list,
+	struct list_head *head)
+{
+	if (list_empty(list))
+		return;
+	list->next->prev = head;
+	list->prev->next = head->next;
+	head->next->prev = list->prev;
+	head->next = list->next;
+	INIT_LIST_HEAD(list);
+}
+
+static inline void list_move_tail(struct list_head *entry, struct list_head *head)
+{
+	list_del(entry);
+	list_add_tail(entry, head);
+}
+
+static inline u64 ktime_get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+#define msecs_to_jiffies(ms)    DIV_ROUND_UP((unsigned long)(ms) * HZ, 1000)
+
+struct mutex {
+	pthread_mutex_t m;
+	pthread_t owner;
+	bool locked;
+};
+
+extern int lockdep_warnings;
+
+static inline void mutex_init(struct mutex *lock)
+{
+	pthread_mutex_init(&lock->m, NULL);
+	lock->locked = false;
+}
+
+static inline void mutex_lock(struct mutex *lock)
+{
+	pthread_mutex_lock(&lock->m);
+	lock->owner = pthread_self();
+	__atomic_store_n(&lock->locked, true, __ATOMIC_RELAXED);
+}
+
+static inline void mutex_unlock(struct mutex *lock)
+{
+	__atomic_store_n(&lock->locked, false, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&lock->m);
+}
+
+static inline void mutex_destroy(struct mutex *lock)
+{
+	pthread_mutex_destroy(&lock->m);
+}
+
+static inline bool mutex_is_locked(struct mutex *lock)
+{
+	return __atomic_load_n(&lock->locked, __ATOMIC_RELAXED);
+}
+
+/* only the owner writes owner while locked, so this read is stable */
+#define lockdep_assert_held(l) \
+	do { \
+		if (!mutex_is_locked(l) || \
+		    !pthread_equal((l)->owner, pthread_self())) \
+			__atomic_add_fetch(&lockdep_warnings, 1, __ATOMIC_RELAXED); \
+	} while (0)
+
+struct completion {
+	pthread_mutex_t m;
+	pthread_cond_t c;
+	unsigned int done;
+};
+
+static inline void init_completion(struct completion *x)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&x->m, NULL);
+	pthread_cond_init(&x->c, &attr);
+	pthread_condattr_destroy(&attr);
+	x->done = 0;
+}
+
+static inline void reinit_completion(struct completion *x)
+{
+	pthread_mutex_lock(&x->m);
+	x->done = 0;
+	pthread_mutex_unlock(&x->m);
+}
+
+static inline void complete_all(struct completion *x)
+{
+	pthread_mutex_lock(&x->m);
+	x->done = UINT_MAX;
+	pthread_cond_broadcast(&x->c);
+	pthread_mutex_unlock(&x->m);
+}
+
+static inline unsigned long wait_for_completion_timeout(struct completion *x,
+	unsigned long timeout)
+{
+	u64 end = ktime_get_ns() + (u64)timeout * (NSEC_PER_SEC / HZ);
+	struct timespec ts = {
+		.tv_sec = end / NSEC_PER_SEC,
+		.tv_nsec = end % NSEC_PER_SEC,
+	};
+	unsigned long left = 0;
+
+	pthread_mutex_lock(&x->m);
+	while (!x->done)
+		if (pthread_cond_timedwait(&x->c, &x->m, &ts) == ETIMEDOUT)
+			break;
+	if (x->done)
+		left = max(DIV_ROUND_UP(end - min(end, ktime_get_ns()),
+			NSEC_PER_SEC / HZ), 1UL);
+	pthread_mutex_unlock(&x->m);
+
+	return left;
+}
+
+static inline void spin_lock_init(spinlock_t *lock)
+{
+	__atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+static inline void spin_lock(spinlock_t *lock)
+{
+	while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE))
+		;
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+	__atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+#define BIT_WORD(nr)            ((nr) / BITS_PER_LONG)
+#define BIT_MASK(nr)            (1UL << ((nr) % BITS_PER_LONG))
+#define set_bit(nr, addr) \
+	((void)__atomic_fetch_or((addr) + BIT_WORD(nr), BIT_MASK(nr), \
+		__ATOMIC_SEQ_CST))
+#define test_and_clear_bit(nr, addr) \
+	(!!(__atomic_fetch_and((addr) + BIT_WORD(nr), ~BIT_MASK(nr), \
+		__ATOMIC_SEQ_CST) & BIT_MASK(nr)))
+#define test_bit(nr, addr)      (!!((addr)[BIT_WORD(nr)] & BIT_MASK(nr)))
+
+static inline void bitmap_zero(unsigned long *map, unsigned int nbits)
+{
+	memset(map, 0, BITS_TO_LONGS(nbits) * sizeof(long));
+}
+
+static inline bool bitmap_empty(const unsigned long *map, unsigned int nbits)
+{
+	unsigned int i;
+
+	for (i = 0; i < nbits / BITS_PER_LONG; i++)
+		if (map[i])
+			return false;
+
+	return !(nbits % BITS_PER_LONG) ||
+		!(map[i] & (BIT_MASK(nbits) - 1));
+}
+
+#define __set_bit(nr, addr)     ((addr)[BIT_WORD(nr)] |= BIT_MASK(nr))
+
+static inline void bitmap_copy(unsigned long *dst, const unsigned long *src,
+	unsigned int nbits)
+{
+	memcpy(dst, src, BITS_TO_LONGS(nbits) * sizeof(long));
+}
+
+static inline void bitmap_andnot(unsigned long *dst, const unsigned long *src1,
+	const unsigned long *src2, unsigned int nbits)
+{
+	unsigned int i;
+
+	for (i = 0; i < BITS_TO_LONGS(nbits); i++)
+		dst[i] = src1[i] & ~src2[i];
+}
+
+/* a word at a time, as the kernel does */
+static inline unsigned long find_next_bit(const unsigned long *addr,
+	unsigned long size, unsigned long offset)
+{
+	unsigned long word;
+
+	if (offset >= size)
+		return size;
+	word = addr[BIT_WORD(offset)] & (~0UL << (offset % BITS_PER_LONG));
+	while (!word) {
+		offset = (BIT_WORD(offset) + 1) * BITS_PER_LONG;
+		if (offset >= size)
+			return size;
+		word = addr[BIT_WORD(offset)];
+	}
+	offset = BIT_WORD(offset) * BITS_PER_LONG + __builtin_ctzl(word);
+
+	return offset < size ? offset : size;
+}
+
+static inline unsigned long find_first_zero_bit(const unsigned long *addr,
+	unsigned long size)
+{
+	unsigned long i, bit;
+
+	for (i = 0; i < BITS_TO_LONGS(size); i++) {
+		if (~addr[i]) {
+			bit = i * BITS_PER_LONG + __builtin_ctzl(~addr[i]);
+			return bit < size ? bit : size;
+		}
+	}
+
+	return size;
+}
+
+#define for_each_set_bit(bit, addr, size) \
+	for ((bit) = find_next_bit((addr), (size), 0); \
+	     (bit) < (size); \
+	     (bit) = find_next_bit((addr), (size), (bit) + 1))
+
+static inline unsigned int bitmap_weight(const unsigned long *map,
+	unsigned int nbits)
+{
+	unsigned int i, weight = 0;
+
+	for (i = 0; i < nbits; i++)
+		weight += test_bit(i, map);
+
+	return weight;
+}
+#define xchg(ptr, v)            __atomic_exchange_n(ptr, v, __ATOMIC_SEQ_CST)
+
+/* zeroed up front, as the kernel does, rather than on first touch */
+static inline void *vzalloc(size_t size)
+{
+	void *addr = malloc(size);
+
+	if (addr)
+		memset(addr, 0, size);
+
+	return addr;
+}
+
+static inline void vfree(const void *addr)
+{
+	free((void *)addr);
+}
+
+static inline void sort(void *base, size_t num, size_t size,
+	int (*cmp)(const void *, const void *), void *swap)
+{
+	qsort(base, num, size, cmp);
+}
+
+struct kref { int unused; };
+
+#define WQ_UNBOUND              BIT(1)
+#define WQ_HIGHPRI              BIT(4)
+#define WQ_SHIM_WORKERS         4
+
+struct workqueue_struct;
+
+struct work_struct {
+	void (*func)(struct work_struct *work);
+	struct workqueue_struct *wq;
+	struct list_head entry;
+	bool pending;
+	bool running;
+};
+
+struct delayed_work { struct work_struct work; };
+
+struct workqueue_struct {
+	pthread_mutex_t m;
+	pthread_cond_t more;
+	pthread_cond_t done;
+	struct list_head list;
+	pthread_t workers[WQ_SHIM_WORKERS];
+	int nr_workers;
+	int nr_running;
+	bool stop;
+};
+
+#define INIT_WORK(w, f) \
+	do { \
+		memset(w, 0, sizeof(*(w))); \
+		(w)->func = (f); \
+		INIT_LIST_HEAD(&(w)->entry); \
+	} while (0)
+#define INIT_DELAYED_WORK(dw, f) INIT_WORK(&(dw)->work, f)
+
+/* first queued work that is not running on another worker, under wq->m */
+static inline struct work_struct *__wq_next_work(struct workqueue_struct *wq)
+{
+	struct work_struct *work;
+
+	list_for_each_entry(work, &wq->list, entry)
+		if (!work->running)
+			return work;
+
+	return NULL;
+}
+
+static inline void *__wq_worker(void *arg)
+{
+	struct workqueue_struct *wq = arg;
+	struct work_struct *work;
+
+	pthread_mutex_lock(&wq->m);
+	while (!wq->stop) {
+		work = __wq_next_work(wq);
+		if (!work) {
+			pthread_cond_wait(&wq->more, &wq->m);
+			continue;
+		}
+		list_del(&work->entry);
+		work->pending = false;
+		work->running = true;
+		wq->nr_running++;
+		pthread_mutex_unlock(&wq->m);
+
+		work->func(work);
+
+		pthread_mutex_lock(&wq->m);
+		work->running = false;
+		wq->nr_running--;
+		/* a requeue of this work may have been waiting for it */
+		pthread_cond_broadcast(&wq->more);
+		pthread_cond_broadcast(&wq->done);
+	}
+	pthread_mutex_unlock(&wq->m);
+
+	return NULL;
+}
+
+static inline struct workqueue_struct *__alloc_workqueue(int nr_workers)
+{
+	struct workqueue_struct *wq;
+	int i;
+
+	wq = calloc(1, sizeof(*wq));
+	if (!wq)
+		return NULL;
+	pthread_mutex_init(&wq->m, NULL);
+	pthread_cond_init(&wq->more, NULL);
+	pthread_cond_init(&wq->done, NULL);
+	INIT_LIST_HEAD(&wq->list);
+	wq->nr_workers = nr_workers;
+	for (i = 0; i < nr_workers; i++)
+		pthread_create(&wq->workers[i], NULL, __wq_worker, wq);
+
+	return wq;
+}
+
+#define alloc_workqueue(name, flags, max_active, ...) \
+	__alloc_workqueue((max_active) ? \
+		min_t(int, max_active, WQ_SHIM_WORKERS) : WQ_SHIM_WORKERS)
+#define alloc_ordered_workqueue(name, flags, ...) __alloc_workqueue(1)
+
+static inline bool queue_work(struct workqueue_struct *wq,
+	struct work_struct *work)
+{
+	bool queued = false;
+
+	pthread_mutex_lock(&wq->m);
+	if (!work->pending) {
+		work->wq = wq;
+		work->pending = true;
+		list_add_tail(&work->entry, &wq->list);
+		pthread_cond_signal(&wq->more);
+		queued = true;
+	}
+	pthread_mutex_unlock(&wq->m);
+
+	return queued;
+}
+
+static inline bool cancel_work_sync(struct work_struct *work)
+{
+	struct workqueue_struct *wq = work->wq;
+	bool pending;
+
+	if (!wq)
+		return false;
+
+	pthread_mutex_lock(&wq->m);
+	pending = work->pending;
+	if (pending) {
+		list_del(&work->entry);
+		work->pending = false;
+	}
+	while (work->running)
+		pthread_cond_wait(&wq->done, &wq->m);
+	pthread_mutex_unlock(&wq->m);
+
+	return pending;
+}
+
+static inline void flush_workqueue(struct workqueue_struct *wq)
+{
+	pthread_mutex_lock(&wq->m);
+	while (!list_empty(&wq->list) || wq->nr_running)
+		pthread_cond_wait(&wq->done, &wq->m);
+	pthread_mutex_unlock(&wq->m);
+}
+
+static inline void destroy_workqueue(struct workqueue_struct *wq)
+{
+	int i;
+
+	flush_workqueue(wq);
+	pthread_mutex_lock(&wq->m);
+	wq->stop = true;
+	pthread_cond_broadcast(&wq->more);
+	pthread_mutex_unlock(&wq->m);
+	for (i = 0; i < wq->nr_workers; i++)
+		pthread_join(wq->workers[i], NULL);
+	pthread_cond_destroy(&wq->done);
+	pthread_cond_destroy(&wq->more);
+	pthread_mutex_destroy(&wq->m);
+	free(wq);
+}
+
+static inline bool mod_delayed_work(struct workqueue_struct *wq,
+	struct delayed_work *dwork, unsigned long delay)
+{
+	return queue_work(wq, &dwork->work);
+}
+
+static inline bool cancel_delayed_work_sync(struct delayed_work *dwork)
+{
+	return cancel_work_sync(&dwork->work);
+}
+
+static inline bool delayed_work_pending(struct delayed_work *dwork)
+{
+	return __atomic_load_n(&dwork->work.pending, __ATOMIC_ACQUIRE);
+}
+struct dma_fence { int unused; };
+struct dma_fence_cb { int unused; };
+struct iosys_map { void *vaddr; };
+struct vb2_vmarea_handler { int unused; };
+struct v4l2_fh { int unused; };
+struct v4l2_ctrl_handler { int error; };
+struct v4l2_device { int unused; };
+struct video_device { int unused; };
+struct media_device { int unused; };
+struct v4l2_m2m_dev;
+struct v4l2_m2m_ctx;
+struct v4l2_ctrl_ops;
+
+struct v4l2_ctrl {
+	struct v4l2_ctrl_handler *handler;
+	u32 id;
+	const char *name;
+	unsigned long flags;
+	s32 val;
+	void *priv;
+};
+
+struct v4l2_ctrl_config {
+	const struct v4l2_ctrl_ops *ops;
+	u32 id;
+	const char *name;
+	enum v4l2_ctrl_type type;
+	s64 min;
+	s64 max;
+	u64 step;
+	s64 def;
+	u32 flags;
+	u64 menu_skip_mask;
+	const char * const *qmenu;
+};
+
+struct vb2_queue { unsigned int streaming:1; };
+struct vb2_buffer;
+struct device { int unused; };
+struct platform_device { struct device dev; };
+
+#define GFP_KERNEL              0
+
+static inline void *devm_kzalloc(struct device *dev, size_t size, int gfp)
+{
+	return calloc(1, size);
+}
+
+struct dentry;
+struct file;
+
+struct static_key_true { bool enabled; };
+struct static_key_false { bool enabled; };
+#define DECLARE_STATIC_KEY_TRUE(name)  extern struct static_key_true name
+#define DECLARE_STATIC_KEY_FALSE(name) extern struct static_key_false name
+#define DEFINE_STATIC_KEY_TRUE(name)   struct static_key_true name = { true }
+#define DEFINE_STATIC_KEY_FALSE(name)  struct static_key_false name = { false }
+#define static_branch_likely(key)      ((key)->enabled)
+#define static_branch_unlikely(key)    ((key)->enabled)
+
+#endif /* _VIDC_TEST_KSHIM_H_ */
@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#include "kshim.h"
+
+int v4l2_ctrl_handler_init(struct v4l2_ctrl_handler *hdl,
+	unsigned int nr_of_controls_hint);
+void v4l2_ctrl_handler_free(struct v4l2_ctrl_handler *hdl);
+struct v4l2_ctrl *v4l2_ctrl_find(struct v4l2_ctrl_handler *hdl, u32 id);
+int v4l2_ctrl_modify_range(struct v4l2_ctrl *ctrl,
+	s64 min, s64 max, u64 step, s64 def);
+struct v4l2_ctrl *v4l2_ctrl_new_custom(struct v4l2_ctrl_handler *hdl,
+	const struct v4l2_ctrl_config *cfg, void *priv);
+struct v4l2_ctrl *v4l2_ctrl_new_std(struct v4l2_ctrl_handler *hdl,
+	const struct v4l2_ctrl_ops *ops, u32 id, s64 min, s64 max, u64 step,
+	s64 def);
+struct v4l2_ctrl *v4l2_ctrl_new_std_menu(struct v4l2_ctrl_handler *hdl,
+	const struct v4l2_ctrl_ops *ops, u32 id, u8 max, u64 mask, u8 def);
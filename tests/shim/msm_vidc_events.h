@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Tracepoints compile out in the userspace build. Shadows
+ * vidc/inc/msm_vidc_events.h, which needs the kernel tracing headers.
+ */
+
+#ifndef _VIDC_TEST_EVENTS_H_
+#define _VIDC_TEST_EVENTS_H_
+
+#include "kshim.h"
+
+#define trace_msm_v4l2_vidc_core_init(event) do { } while (0)
+#define trace_msm_v4l2_vidc_fw_load(event)   do { } while (0)
+
+#endif /* _VIDC_TEST_EVENTS_H_ */
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-only
+"""
+Per-stage buffer latency report from msm_vidc_buffer_stage trace events.
+
+Capture:
+    trace-cmd record -e msm_vidc_events:msm_vidc_buffer_stage <usecase>
+    trace-cmd report -t > trace.txt
+or read /sys/kernel/tracing/trace directly after enabling the event.
+
+Usage:
+    vidc_buffer_latency.py trace.txt [--sid 0x...]
+
+tests/traces/buffer_stage.txt is a hand-written excerpt; make -C tests check
+compares its report with tests/golden/buffer_latency.txt.
+
+A buffer is tracked by (session id, type, vb2 index) from qbuf until dqbuf;
+the time between consecutive stages is reported as percentiles per port.
+"""
+
+import argparse
+import re
+import sys
+from collections import defaultdict
+
+STAGES = ["qbuf", "submit", "fw_done", "vb2_done", "dqbuf"]
+
+EVENT_RE = re.compile(
+    r"\s(?P<time>\d+\.\d+):\s+msm_vidc_buffer_stage:\s+"
+    r"sid (?P<sid>0x[0-9a-f]+|0) stage (?P<stage>\w+) type (?P<type>\w+) "
+    r"idx (?P<idx>\d+)")
+
+
+def percentile(values, pct):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    k = (len(values) - 1) * pct / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(values) - 1)
+    return values[lo] + (values[hi] - values[lo]) * (k - lo)
+
+
+def to_ns(stamp):
+    # "123.456789" (usecs) or "123.456789012" (nsecs, trace-cmd report -t)
+    sec, frac = stamp.split(".")
+    return int(sec) * 1000000000 + int(frac.ljust(9, "0")[:9])
+
+
+def parse(lines, sid_filter):
+    pending = {}
+    latencies = defaultdict(lambda: defaultdict(list))
+
+    for line in lines:
+        m = EVENT_RE.search(line)
+        if not m:
+            continue
+        sid = int(m.group("sid"), 16)
+        if sid_filter is not None and sid != sid_filter:
+            continue
+        stage = m.group("stage")
+        if stage not in STAGES:
+            continue
+        key = (sid, m.group("type"), int(m.group("idx")))
+        now = to_ns(m.group("time"))
+
+        if stage == "qbuf":
+            pending[key] = {"qbuf": now}
+            continue
+        stamps = pending.get(key)
+        if stamps is None:
+            continue
+        stamps[stage] = now
+        if stage == "dqbuf":
+            record(latencies[key[1]], pending.pop(key))
+
+    return latencies
+
+
+def record(per_type, stamps):
+    prev = None
+    for stage in STAGES:
+        if stage not in stamps:
+            continue
+        if prev is not None:
+            per_type["%s->%s" % (prev, stage)].append(
+                stamps[stage] - stamps[prev])
+        prev = stage
+    if "dqbuf" in stamps:
+        per_type["qbuf->dqbuf"].append(stamps["dqbuf"] - stamps["qbuf"])
+
+
+def stage_order(name):
+    start, end = name.split("->")
+    return (STAGES.index(end) - STAGES.index(start) > 1,
+            STAGES.index(start))
+
+
+def report(latencies):
+    hdr = "%-12s %-20s %8s %10s %10s %10s %10s" % (
+        "type", "stage", "count", "p50(us)", "p90(us)", "p99(us)", "max(us)")
+    print(hdr)
+    print("-" * len(hdr))
+    for buf_type in sorted(latencies):
+        for name, values in sorted(latencies[buf_type].items(),
+                                   key=lambda kv: stage_order(kv[0])):
+            print("%-12s %-20s %8d %10.1f %10.1f %10.1f %10.1f" % (
+                buf_type, name, len(values),
+                percentile(values, 50) / 1000.0,
+                percentile(values, 90) / 1000.0,
+                percentile(values, 99) / 1000.0,
+                max(values) / 1000.0))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("trace", help="trace text, '-' for stdin")
+    parser.add_argument("--sid", type=lambda v: int(v, 16),
+                        help="only report this session id (hex)")
+    args = parser.parse_args()
+
+    if args.trace == "-":
+        latencies = parse(sys.stdin, args.sid)
+    else:
+        with open(args.trace) as f:
+            latencies = parse(f, args.sid)
+
+    if not latencies:
+        print("no complete msm_vidc_buffer_stage sequences found")
+        return 1
+    report(latencies)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
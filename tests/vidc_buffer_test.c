@@ -0,0 +1,351 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Golden-value test for the internal buffer size calculators and the
+ * msm_media_info.h stride/scanline helpers.
+ *
+ *   vidc_buffer_test <golden dir>              compare against golden tables
+ *   vidc_buffer_test --generate <golden dir>   rewrite the golden tables
+ *
+ * Regenerate only for an intended size change and review the table diff:
+ * every changed cell is memory gained or lost per session.
+ */
+
+#include <stdlib.h>
+
+#include "msm_media_info.h"
+#include "msm_vidc_driver.h"
+#include "vidc_test_session.h"
+
+#define MAX_COLS 16
+#define KEY_LEN  64
+
+struct row {
+	char key[KEY_LEN];
+	u32 val[MAX_COLS];
+};
+
+struct table {
+	const char *file;
+	const char *header;
+	u32 ncols;
+	struct row *rows;
+	u32 count;
+	u32 alloc;
+};
+
+static const u32 test_res[][2] = {
+	{  320,  240 },
+	{ 1280,  720 },
+	{ 1920, 1080 },
+	{ 3840, 2160 },
+};
+
+static const u32 test_pipes[] = { 1, 2, 4 };
+
+static struct row *table_add(struct table *t)
+{
+	if (t->count == t->alloc) {
+		t->alloc = t->alloc ? t->alloc * 2 : 256;
+		t->rows = realloc(t->rows, t->alloc * sizeof(*t->rows));
+		if (!t->rows) {
+			perror("realloc");
+			exit(2);
+		}
+	}
+	memset(&t->rows[t->count], 0, sizeof(*t->rows));
+	return &t->rows[t->count++];
+}
+
+static void add_buffer_row(struct table *t, const struct vidc_test_config *cfg)
+{
+	static struct vidc_test_session s;
+	struct row *r;
+	u32 i;
+
+	vidc_test_session_init(&s, cfg);
+	r = table_add(t);
+	snprintf(r->key, KEY_LEN, "%s %s %s %ux%u %u %u %u",
+		cfg->variant->name, vidc_test_domain_name(cfg->domain),
+		vidc_test_codec_name(cfg->codec), cfg->width, cfg->height,
+		cfg->bitdepth, cfg->pipes, cfg->stage);
+	for (i = 0; i < vidc_test_buf_type_count; i++) {
+		if (vidc_test_buf_applies(cfg, vidc_test_buf_types[i]))
+			r->val[i] = cfg->variant->size(&s.inst,
+				vidc_test_buf_types[i]);
+	}
+}
+
+static void build_buffer_table(struct table *t)
+{
+	static const enum msm_vidc_domain_type domains[] = {
+		MSM_VIDC_DECODER, MSM_VIDC_ENCODER,
+	};
+	static const enum msm_vidc_codec_type codecs[] = {
+		MSM_VIDC_H264, MSM_VIDC_HEVC, MSM_VIDC_VP9, MSM_VIDC_AV1,
+	};
+	struct vidc_test_config cfg = {0};
+	u32 v, d, c, r, b, p, st, enc_codecs;
+
+	enc_codecs = MSM_VIDC_H264 | MSM_VIDC_HEVC;
+	for (v = 0; v < vidc_test_variant_count; v++) {
+		cfg.variant = &vidc_test_variants[v];
+	for (d = 0; d < ARRAY_SIZE(domains); d++) {
+		cfg.domain = domains[d];
+	for (c = 0; c < ARRAY_SIZE(codecs); c++) {
+		cfg.codec = codecs[c];
+		if (cfg.domain == MSM_VIDC_DECODER &&
+			!(cfg.variant->codecs & cfg.codec))
+			continue;
+		if (cfg.domain == MSM_VIDC_ENCODER && !(enc_codecs & cfg.codec))
+			continue;
+	for (r = 0; r < ARRAY_SIZE(test_res); r++) {
+		cfg.width = test_res[r][0];
+		cfg.height = test_res[r][1];
+	for (b = 8; b <= 10; b += 2) {
+		/* no 10-bit AVC profile on any target */
+		if (b == 10 && cfg.codec == MSM_VIDC_H264)
+			continue;
+		cfg.bitdepth = b;
+	for (p = 0; p < ARRAY_SIZE(test_pipes); p++) {
+		/* iris2 is a single-pipe core */
+		if (!strcmp(cfg.variant->name, "iris2") && test_pipes[p] != 1)
+			continue;
+		cfg.pipes = test_pipes[p];
+	for (st = MSM_VIDC_STAGE_1; st <= MSM_VIDC_STAGE_2; st++) {
+		cfg.stage = st;
+		add_buffer_row(t, &cfg);
+	}
+	}
+	}
+	}
+	}
+	}
+	}
+}
+
+static void build_media_info_table(struct table *t)
+{
+	static const struct {
+		const char *name;
+		enum msm_vidc_colorformat_type fmt;
+	} fmts[] = {
+		{ "nv12",      MSM_VIDC_FMT_NV12      },
+		{ "nv21",      MSM_VIDC_FMT_NV21      },
+		{ "nv12c",     MSM_VIDC_FMT_NV12C     },
+		{ "p010",      MSM_VIDC_FMT_P010      },
+		{ "tp10c",     MSM_VIDC_FMT_TP10C     },
+		{ "rgba8888",  MSM_VIDC_FMT_RGBA8888  },
+		{ "rgba8888c", MSM_VIDC_FMT_RGBA8888C },
+	};
+	static const u32 res[][2] = {
+		{  176,  144 },
+		{  320,  240 },
+		{ 1280,  720 },
+		{ 1366,  768 },
+		{ 1920, 1080 },
+		{ 3840, 2160 },
+		{ 7680, 4320 },
+	};
+	struct row *row;
+	u32 f, r, w, h, c;
+
+	for (f = 0; f < ARRAY_SIZE(fmts); f++) {
+	for (r = 0; r < ARRAY_SIZE(res); r++) {
+		c = fmts[f].fmt;
+		w = res[r][0];
+		h = res[r][1];
+		row = table_add(t);
+		snprintf(row->key, KEY_LEN, "%s %ux%u", fmts[f].name, w, h);
+		if (c == MSM_VIDC_FMT_RGBA8888 || c == MSM_VIDC_FMT_RGBA8888C) {
+			row->val[0] = video_rgb_stride_bytes(c, w);
+			row->val[1] = video_rgb_scanlines(c, h);
+			row->val[4] = video_rgb_meta_stride(c, w);
+			row->val[5] = video_rgb_meta_scanlines(c, h);
+		} else {
+			row->val[0] = video_y_stride_bytes(c, w);
+			row->val[1] = video_y_scanlines(c, h);
+			row->val[2] = video_uv_stride_bytes(c, w);
+			row->val[3] = video_uv_scanlines(c, h);
+			row->val[4] = video_y_meta_stride(c, w);
+			row->val[5] = video_y_meta_scanlines(c, h);
+			row->val[6] = video_uv_meta_stride(c, w);
+			row->val[7] = video_uv_meta_scanlines(c, h);
+		}
+		row->val[8] = video_buffer_size(c, w, h, false);
+		row->val[9] = video_buffer_size(c, w, h, true);
+	}
+	}
+}
+
+static FILE *open_golden(const char *dir, const char *file, const char *mode)
+{
+	char path[512];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, file);
+	fp = fopen(path, mode);
+	if (!fp)
+		perror(path);
+	return fp;
+}
+
+static int write_table(const char *dir, const struct table *t)
+{
+	FILE *fp;
+	u32 i, j;
+
+	fp = open_golden(dir, t->file, "w");
+	if (!fp)
+		return -1;
+
+	fprintf(fp, "# generated by vidc_buffer_test --generate, do not edit\n");
+	fprintf(fp, "# %s\n", t->header);
+	for (i = 0; i < t->count; i++) {
+		fprintf(fp, "%s", t->rows[i].key);
+		for (j = 0; j < t->ncols; j++)
+			fprintf(fp, " %u", t->rows[i].val[j]);
+		fprintf(fp, "\n");
+	}
+	fclose(fp);
+	printf("wrote %u rows to %s/%s\n", t->count, dir, t->file);
+	return 0;
+}
+
+/* golden lines are "<key fields> <ncols values>"; split off the values */
+static int parse_golden_line(char *line, u32 ncols, struct row *r)
+{
+	char *tok[KEY_LEN];
+	u32 ntok = 0, nkey, i;
+	char *p, *save = NULL;
+
+	for (p = strtok_r(line, " \t\n", &save); p && ntok < KEY_LEN;
+		p = strtok_r(NULL, " \t\n", &save))
+		tok[ntok++] = p;
+	if (ntok <= ncols)
+		return -1;
+
+	nkey = ntok - ncols;
+	r->key[0] = '\0';
+	for (i = 0; i < nkey; i++) {
+		if (i)
+			strncat(r->key, " ", KEY_LEN - strlen(r->key) - 1);
+		strncat(r->key, tok[i], KEY_LEN - strlen(r->key) - 1);
+	}
+	for (i = 0; i < ncols; i++)
+		r->val[i] = strtoul(tok[nkey + i], NULL, 0);
+	return 0;
+}
+
+static int compare_table(const char *dir, const struct table *t,
+	const char * const *col_names)
+{
+	char line[512];
+	struct row golden;
+	bool *seen;
+	u32 i, j, lineno = 0, rows = 0;
+	int failures = 0;
+	FILE *fp;
+
+	fp = open_golden(dir, t->file, "r");
+	if (!fp)
+		return 1;
+
+	seen = calloc(t->count, sizeof(*seen));
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (parse_golden_line(line, t->ncols, &golden)) {
+			printf("%s:%u: malformed line\n", t->file, lineno);
+			failures++;
+			continue;
+		}
+		rows++;
+		for (i = 0; i < t->count; i++) {
+			if (!strcmp(t->rows[i].key, golden.key))
+				break;
+		}
+		if (i == t->count) {
+			printf("%s:%u: [%s] no longer generated\n",
+				t->file, lineno, golden.key);
+			failures++;
+			continue;
+		}
+		seen[i] = true;
+		for (j = 0; j < t->ncols; j++) {
+			if (t->rows[i].val[j] == golden.val[j])
+				continue;
+			printf("%s:%u: [%s] %s: golden %u, got %u (%+lld)\n",
+				t->file, lineno, golden.key, col_names[j],
+				golden.val[j], t->rows[i].val[j],
+				(long long)t->rows[i].val[j] - golden.val[j]);
+			failures++;
+		}
+	}
+	fclose(fp);
+
+	for (i = 0; i < t->count; i++) {
+		if (!seen[i]) {
+			printf("%s: [%s] missing from golden table\n",
+				t->file, t->rows[i].key);
+			failures++;
+		}
+	}
+	free(seen);
+
+	printf("%s: %u rows, %d mismatches\n", t->file, rows, failures);
+	return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	static const char * const media_info_cols[] = {
+		"y_stride", "y_scanlines", "uv_stride", "uv_scanlines",
+		"y_meta_stride", "y_meta_scanlines", "uv_meta_stride",
+		"uv_meta_scanlines", "size", "size_interlace",
+	};
+	const char *buffer_cols[MAX_COLS];
+	struct table buffers = {
+		.file = "buffer_sizes.txt",
+		.header = "variant domain codec WxH bitdepth pipes stage "
+			"input output bin comv non_comv line persist dpb arp vpss partial_data",
+		.ncols = vidc_test_buf_type_count,
+	};
+	struct table media_info = {
+		.file = "media_info.txt",
+		.header = "colorformat WxH y_stride y_scanlines uv_stride uv_scanlines "
+			"y_meta_stride y_meta_scanlines uv_meta_stride uv_meta_scanlines "
+			"size size_interlace",
+		.ncols = ARRAY_SIZE(media_info_cols),
+	};
+	bool generate = false;
+	const char *dir;
+	int ret = 0;
+	u32 i;
+
+	if (argc == 3 && !strcmp(argv[1], "--generate")) {
+		generate = true;
+		dir = argv[2];
+	} else if (argc == 2) {
+		dir = argv[1];
+	} else {
+		fprintf(stderr, "usage: %s [--generate] <golden dir>\n", argv[0]);
+		return 2;
+	}
+
+	for (i = 0; i < vidc_test_buf_type_count; i++)
+		buffer_cols[i] = buf_name(vidc_test_buf_types[i]);
+
+	build_buffer_table(&buffers);
+	build_media_info_table(&media_info);
+
+	if (generate) {
+		ret |= write_table(dir, &buffers);
+		ret |= write_table(dir, &media_info);
+		return ret ? 1 : 0;
+	}
+
+	ret |= compare_table(dir, &buffers, buffer_cols);
+	ret |= compare_table(dir, &media_info, media_info_cols);
+	return ret;
+}
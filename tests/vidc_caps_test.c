@@ -0,0 +1,277 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Shared capability tables and control id lookup against every platform.
+ *
+ *   vidc_caps_test [repeat]
+ *
+ * Builds core->inst_caps from the qcm6490, sa8775p and qcs8300 tables with
+ * vidc/src/msm_vidc_caps.c, both compiled unmodified, and opens two
+ * sessions on every (domain, codec) entry with
+ * msm_vidc_get_inst_capability().
+ *
+ * Checks that each session's capabilities hold what the full per-session
+ * copy used to, that writing one session's values leaves the other session
+ * and the shared table alone, and that a codec change reloads them. Then
+ * compares msm_vidc_cid_map_lookup() with the linear walk
+ * msm_vidc_get_cap_id() used to do, for every control id of the platform
+ * and a few that are not, and prints the time per lookup of each.
+ */
+
+#include <stdlib.h>
+#include <media/v4l2_vidc_extensions.h>
+
+#include "msm_vidc_core.h"
+#include "msm_vidc_driver.h"
+#include "msm_vidc_inst.h"
+#include "msm_vidc_platform.h"
+#include "msm_vidc_memory.h"
+#include "resources.h"
+#include "msm_vidc_debug.h"
+#include "msm_vidc_qcm6490.h"
+#include "msm_vidc_sa8775p.h"
+#include "msm_vidc_qcs8300.h"
+
+#define MAX_IDS (INST_CAP_MAX * 2)
+
+struct platform {
+	const char *name;
+	int (*init)(struct msm_vidc_core *core);
+};
+
+static const struct platform platforms[] = {
+	{ "qcm6490", msm_vidc_init_platform_qcm6490 },
+	{ "sa8775p", msm_vidc_init_platform_sa8775p },
+	{ "qcs8300", msm_vidc_init_platform_qcs8300 },
+};
+
+static struct msm_vidc_core core;
+static struct msm_vidc_platform platform;
+static struct platform_device pdev;
+static struct msm_vidc_inst inst_a, inst_b;
+static int failed;
+
+#define CHECK(cond, fmt, ...) \
+	do { \
+		if (!(cond)) { \
+			printf("  FAIL: " fmt "\n", ##__VA_ARGS__); \
+			failed = 1; \
+		} \
+	} while (0)
+
+/* referenced by the platform tables only through ops the test never calls */
+static const struct msm_vidc_memory_ops mem_ops;
+static const struct msm_vidc_resources_ops res_ops;
+u32 vpe_csc_custom_matrix_coeff[MAX_MATRIX_COEFFS];
+u32 vpe_csc_custom_bias_coeff[MAX_BIAS_COEFFS];
+u32 vpe_csc_custom_limit_coeff[MAX_LIMIT_COEFFS];
+
+const struct msm_vidc_memory_ops *get_mem_ops(void)
+{
+	return &mem_ops;
+}
+
+const struct msm_vidc_memory_ops *get_mem_ops_ext(void)
+{
+	return &mem_ops;
+}
+
+const struct msm_vidc_resources_ops *get_resources_ops(void)
+{
+	return &res_ops;
+}
+
+/* msm_vidc_get_cap_id() before the cid map */
+static enum msm_vidc_inst_capability_type linear_cap_id(
+	const struct msm_vidc_inst_cap *cap_table, u32 id)
+{
+	enum msm_vidc_inst_capability_type i = INST_CAP_NONE + 1;
+	enum msm_vidc_inst_capability_type cap_id = INST_CAP_NONE;
+
+	do {
+		if (cap_table[i].v4l2_id == id) {
+			cap_id = cap_table[i].cap_id;
+			break;
+		}
+		i++;
+	} while (i < INST_CAP_MAX);
+
+	return cap_id;
+}
+
+static bool cap_equal(const struct msm_vidc_inst_cap_state *state,
+	const struct msm_vidc_inst_cap *cap)
+{
+	return state->min == cap->min && state->max == cap->max &&
+		state->step_or_mask == cap->step_or_mask &&
+		state->value == cap->value && state->flags == cap->flags;
+}
+
+static bool caps_equal(const struct msm_vidc_inst *inst,
+	const struct msm_vidc_inst_capability *caps)
+{
+	u32 k;
+
+	for (k = 0; k <= INST_CAP_MAX; k++)
+		if (!cap_equal(&inst->capabilities[k], &caps->cap[k]))
+			return false;
+
+	return true;
+}
+
+static void open_inst(struct msm_vidc_inst *inst,
+	const struct msm_vidc_inst_capability *caps)
+{
+	inst->core = &core;
+	inst->domain = caps->domain;
+	inst->codec = caps->codec;
+	msm_vidc_get_inst_capability(inst);
+}
+
+/* the per-session state against the full copy it replaces */
+static void check_tables(u32 codecs)
+{
+	static struct msm_vidc_inst_cap copy[INST_CAP_MAX + 1];
+	const struct msm_vidc_inst_capability *caps, *next;
+	u32 j, k;
+
+	for (j = 0; j < codecs; j++) {
+		caps = &core.inst_caps[j];
+		memcpy(copy, caps->cap, sizeof(copy));
+		open_inst(&inst_a, caps);
+		open_inst(&inst_b, caps);
+
+		CHECK(inst_a.cap_table == caps->cap &&
+			inst_a.codec_caps == caps,
+			"%#x/%#x: not the shared table", caps->domain, caps->codec);
+		CHECK(caps_equal(&inst_a, caps),
+			"%#x/%#x: state differs from the table",
+			caps->domain, caps->codec);
+
+		for (k = 0; k <= INST_CAP_MAX; k++) {
+			inst_a.capabilities[k].value = ~copy[k].value;
+			inst_a.capabilities[k].flags ^= CAP_FLAG_DYNAMIC_ALLOWED;
+		}
+		CHECK(caps_equal(&inst_b, caps),
+			"%#x/%#x: write leaked into another session",
+			caps->domain, caps->codec);
+		CHECK(!memcmp(copy, caps->cap, sizeof(copy)),
+			"%#x/%#x: write leaked into the shared table",
+			caps->domain, caps->codec);
+
+		/* s_fmt to another codec of the same domain */
+		next = &core.inst_caps[(j + 1) % codecs];
+		if (next->domain != caps->domain)
+			continue;
+		open_inst(&inst_a, next);
+		CHECK(inst_a.cap_table == next->cap && caps_equal(&inst_a, next),
+			"%#x -> %#x: codec change kept stale caps",
+			caps->codec, next->codec);
+	}
+}
+
+static u32 collect_ids(u32 codecs, u32 *ids)
+{
+	u32 count = 0, i, j, k;
+
+	for (j = 0; j < codecs; j++) {
+		for (k = INST_CAP_NONE + 1; k < INST_CAP_MAX; k++) {
+			u32 id = core.inst_caps[j].cap[k].v4l2_id;
+
+			if (!id)
+				continue;
+			for (i = 0; i < count && ids[i] != id; i++)
+				;
+			if (i == count && count < MAX_IDS - 3)
+				ids[count++] = id;
+		}
+	}
+	/* not controls of this driver; control ids are never 0 */
+	ids[count++] = V4L2_CID_BRIGHTNESS;
+	ids[count++] = V4L2_CID_MPEG_VIDC_BASE + 0xffff;
+	ids[count++] = U32_MAX;
+
+	return count;
+}
+
+static void check_lookup(u32 codecs, u32 repeat)
+{
+	static u32 ids[MAX_IDS];
+	enum msm_vidc_inst_capability_type linear, map;
+	const struct msm_vidc_inst_capability *caps;
+	u64 start, linear_ns = 0, map_ns = 0;
+	u32 count, lookups = 0, mismatches = 0, dups = 0, i, j, r;
+	volatile u32 sink = 0;
+
+	count = collect_ids(codecs, ids);
+	for (j = 0; j < codecs; j++) {
+		caps = &core.inst_caps[j];
+		for (i = 0; i < count; i++) {
+			linear = linear_cap_id(caps->cap, ids[i]);
+			map = msm_vidc_cid_map_lookup(caps, ids[i]);
+			lookups++;
+			if (linear != map) {
+				mismatches++;
+				printf("  %#x/%#x cid %#x: linear %u, map %u\n",
+					caps->domain, caps->codec, ids[i],
+					linear, map);
+			}
+		}
+		for (i = 1; i < caps->cid_map_count; i++)
+			dups += caps->cid_map[i].v4l2_id ==
+				caps->cid_map[i - 1].v4l2_id;
+
+		start = ktime_get_ns();
+		for (r = 0; r < repeat; r++)
+			for (i = 0; i < count; i++)
+				sink += linear_cap_id(caps->cap, ids[i]);
+		linear_ns += ktime_get_ns() - start;
+		start = ktime_get_ns();
+		for (r = 0; r < repeat; r++)
+			for (i = 0; i < count; i++)
+				sink += msm_vidc_cid_map_lookup(caps, ids[i]);
+		map_ns += ktime_get_ns() - start;
+	}
+
+	printf("  %u codec tables, %u control ids, %u lookups, %u mismatches, "
+		"%u shared cids\n", codecs, count, lookups, mismatches, dups);
+	printf("  ns per lookup: linear %.1f, cid map %.1f\n",
+		linear_ns / (double)(lookups * repeat),
+		map_ns / (double)(lookups * repeat));
+	CHECK(!mismatches, "cid map disagrees with the linear walk");
+}
+
+int main(int argc, char **argv)
+{
+	u32 repeat = 200, codecs, p;
+	int rc;
+
+	if (argc > 1)
+		repeat = max_t(u32, strtoul(argv[1], NULL, 0), 1);
+
+	for (p = 0; p < ARRAY_SIZE(platforms); p++) {
+		printf("%s\n", platforms[p].name);
+		memset(&core, 0, sizeof(core));
+		memset(&platform, 0, sizeof(platform));
+		core.pdev = &pdev;
+		core.platform = &platform;
+
+		rc = platforms[p].init(&core);
+		if (!rc)
+			rc = msm_vidc_init_core_caps(&core);
+		if (!rc)
+			rc = msm_vidc_init_instance_caps(&core);
+		CHECK(!rc, "capability init failed: %d", rc);
+		if (rc)
+			continue;
+
+		codecs = core.enc_codecs_count + core.dec_codecs_count;
+		check_tables(codecs);
+		check_lookup(codecs, repeat);
+		free(core.inst_caps);
+	}
+
+	if (failed)
+		printf("FAIL\n");
+
+	return failed;
+}
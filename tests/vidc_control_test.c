@@ -0,0 +1,683 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Dynamic control propagation against the list walk it replaced.
+ *
+ *   vidc_control_test [controls]
+ *
+ * Opens a session on every (domain, codec) entry of the qcm6490, sa8775p
+ * and qcs8300 tables and runs vidc/src/msm_vidc_control.c unmodified on it
+ * while streaming. The adjust op of every cap is replaced by a model that
+ * derives the value from the client value and the values of the cap's
+ * parents, the set op by one that records the cap sent. A session first
+ * adjusts all caps in dependency order, as msm_vidc_adjust_v4l2_properties()
+ * does before streamon, then takes random dynamic controls through
+ * msm_vidc_s_ctrl().
+ *
+ * Every control is replayed from the same state through the children_list
+ * and firmware_list walk msm_vidc_adjust_dynamic_property() used to do.
+ * Where that walk completes, the caps adjusted, the caps sent and the
+ * resulting values must match. It leaves the children of a changed child
+ * unvisited on children_list and fails, so those controls are counted
+ * instead. Every control is also checked against a full adjust pass from
+ * the state before it: same values, each cap adjusted at most once, and
+ * exactly the changed caps sent.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "msm_vidc_core.h"
+#include "msm_vidc_driver.h"
+#include "msm_vidc_inst.h"
+#include "msm_vidc_control.h"
+#include "msm_vidc_platform.h"
+#include "msm_vidc_memory.h"
+#include "msm_venc.h"
+#include "resources.h"
+#include "venus_hfi.h"
+#include "msm_vidc_debug.h"
+#include "msm_vidc_qcm6490.h"
+#include "msm_vidc_sa8775p.h"
+#include "msm_vidc_qcs8300.h"
+
+/* values a client sets; the model derives values 0..2 from the parents */
+#define CLIENT_VALUES 8
+
+struct platform {
+	const char *name;
+	int (*init)(struct msm_vidc_core *core);
+};
+
+static const struct platform platforms[] = {
+	{ "qcm6490", msm_vidc_init_platform_qcm6490 },
+	{ "sa8775p", msm_vidc_init_platform_sa8775p },
+	{ "qcs8300", msm_vidc_init_platform_qcs8300 },
+};
+
+/* adjust and set calls of one control */
+struct prop_log {
+	DECLARE_BITMAP(adjusted, INST_CAP_MAX);
+	DECLARE_BITMAP(sent, INST_CAP_MAX);
+	u32 adjusts;
+};
+
+struct prop_stats {
+	u32 controls;
+	u32 rejected;
+	u32 old_failed;
+	u32 adjusts;
+	u32 sent;
+};
+
+static struct msm_vidc_core core;
+static struct msm_vidc_platform platform;
+static struct platform_device pdev;
+static struct msm_vidc_inst inst;
+static struct vb2_queue streaming_q = { .streaming = 1 };
+static struct prop_log log;
+static u16 parents[INST_CAP_MAX][INST_CAP_MAX];
+static u16 parent_count[INST_CAP_MAX];
+static LIST_HEAD(children_list);
+static LIST_HEAD(firmware_list);
+static int failed;
+
+#define CHECK(cond, fmt, ...) \
+	do { \
+		if (!(cond)) { \
+			printf("  FAIL: " fmt "\n", ##__VA_ARGS__); \
+			failed = 1; \
+		} \
+	} while (0)
+
+/* referenced by the platform tables only through ops the test never calls */
+static const struct msm_vidc_memory_ops mem_ops;
+static const struct msm_vidc_resources_ops res_ops;
+u32 vpe_csc_custom_matrix_coeff[MAX_MATRIX_COEFFS];
+u32 vpe_csc_custom_bias_coeff[MAX_BIAS_COEFFS];
+u32 vpe_csc_custom_limit_coeff[MAX_LIMIT_COEFFS];
+
+const struct msm_vidc_memory_ops *get_mem_ops(void)
+{
+	return &mem_ops;
+}
+
+const struct msm_vidc_memory_ops *get_mem_ops_ext(void)
+{
+	return &mem_ops;
+}
+
+const struct msm_vidc_resources_ops *get_resources_ops(void)
+{
+	return &res_ops;
+}
+
+/* referenced by the control handler and static paths the test never takes */
+struct msm_vidc_core *g_core;
+
+const char *state_name(enum msm_vidc_state state)
+{
+	return "STREAMING";
+}
+
+struct msm_vidc_inst *get_inst_ref(struct msm_vidc_core *core,
+	struct msm_vidc_inst *instance)
+{
+	return NULL;
+}
+
+void put_inst(struct msm_vidc_inst *inst)
+{
+}
+
+void client_lock(struct msm_vidc_inst *inst, const char *function)
+{
+}
+
+void client_unlock(struct msm_vidc_inst *inst, const char *function)
+{
+}
+
+void core_lock(struct msm_vidc_core *core, const char *function)
+{
+}
+
+void core_unlock(struct msm_vidc_core *core, const char *function)
+{
+}
+
+int msm_vidc_get_control(struct msm_vidc_inst *inst, struct v4l2_ctrl *ctrl)
+{
+	return -EINVAL;
+}
+
+int msm_vidc_update_bitstream_buffer_size(struct msm_vidc_inst *inst)
+{
+	return -EINVAL;
+}
+
+int msm_vidc_update_meta_port_settings(struct msm_vidc_inst *inst)
+{
+	return -EINVAL;
+}
+
+int msm_vidc_update_buffer_count(struct msm_vidc_inst *inst, u32 port)
+{
+	return -EINVAL;
+}
+
+int msm_vidc_update_debug_str(struct msm_vidc_inst *inst)
+{
+	return -EINVAL;
+}
+
+int msm_venc_s_fmt_output(struct msm_vidc_inst *inst, struct v4l2_format *f)
+{
+	return -EINVAL;
+}
+
+void venus_hfi_session_property_batch_begin(struct msm_vidc_inst *inst)
+{
+}
+
+int venus_hfi_session_property_batch_end(struct msm_vidc_inst *inst,
+	bool discard, u32 *sent)
+{
+	return -EINVAL;
+}
+
+int v4l2_ctrl_handler_init(struct v4l2_ctrl_handler *hdl,
+	unsigned int nr_of_controls_hint)
+{
+	return -EINVAL;
+}
+
+void v4l2_ctrl_handler_free(struct v4l2_ctrl_handler *hdl)
+{
+}
+
+struct v4l2_ctrl *v4l2_ctrl_find(struct v4l2_ctrl_handler *hdl, u32 id)
+{
+	return NULL;
+}
+
+int v4l2_ctrl_modify_range(struct v4l2_ctrl *ctrl,
+	s64 min, s64 max, u64 step, s64 def)
+{
+	return -EINVAL;
+}
+
+struct v4l2_ctrl *v4l2_ctrl_new_custom(struct v4l2_ctrl_handler *hdl,
+	const struct v4l2_ctrl_config *cfg, void *priv)
+{
+	return NULL;
+}
+
+struct v4l2_ctrl *v4l2_ctrl_new_std(struct v4l2_ctrl_handler *hdl,
+	const struct v4l2_ctrl_ops *ops, u32 id, s64 min, s64 max, u64 step,
+	s64 def)
+{
+	return NULL;
+}
+
+struct v4l2_ctrl *v4l2_ctrl_new_std_menu(struct v4l2_ctrl_handler *hdl,
+	const struct v4l2_ctrl_ops *ops, u32 id, u8 max, u64 mask, u8 def)
+{
+	return NULL;
+}
+
+/*
+ * A real adjust op clamps the client value against the values of its
+ * parents. The model keeps the client (or current) value for a quarter of
+ * the parent states and derives one of three values from them otherwise,
+ * so a changed parent changes a child often but not always. It only reads
+ * the parents, so a second adjust with unchanged parents is a no-op.
+ */
+static int model_adjust(void *instance, struct v4l2_ctrl *ctrl,
+	enum msm_vidc_inst_capability_type cap_id)
+{
+	struct msm_vidc_inst *inst = instance;
+	u32 hash = cap_id, i;
+	s32 value;
+
+	for (i = 0; i < parent_count[cap_id]; i++)
+		hash = hash * 31 + inst->capabilities[parents[cap_id][i]].value;
+	hash ^= hash >> 13;
+	hash *= 0x9e3779b1;
+
+	if (!(hash & 3))
+		value = ctrl ? ctrl->val : inst->capabilities[cap_id].value;
+	else
+		value = (hash >> 2) % 3;
+
+	set_bit(cap_id, log.adjusted);
+	log.adjusts++;
+
+	return msm_vidc_update_cap_value(inst, cap_id, value, __func__);
+}
+
+static int model_set(void *instance, enum msm_vidc_inst_capability_type cap_id)
+{
+	set_bit(cap_id, log.sent);
+
+	return 0;
+}
+
+/*
+ * adjust ops are not told their cap, so each cap gets its own. Numbers are
+ * spelled as three digits: adjust_042 models cap 1042 - 1000.
+ */
+#define SEQ10(X, p) \
+	X(p##0) X(p##1) X(p##2) X(p##3) X(p##4) \
+	X(p##5) X(p##6) X(p##7) X(p##8) X(p##9)
+#define SEQ100(X, p) \
+	SEQ10(X, p##0) SEQ10(X, p##1) SEQ10(X, p##2) SEQ10(X, p##3) \
+	SEQ10(X, p##4) SEQ10(X, p##5) SEQ10(X, p##6) SEQ10(X, p##7) \
+	SEQ10(X, p##8) SEQ10(X, p##9)
+#define ADJUST_OP(n) \
+	static int adjust_##n(void *inst, struct v4l2_ctrl *ctrl) \
+	{ \
+		return model_adjust(inst, ctrl, 1##n - 1000); \
+	}
+#define ADJUST_REF(n) adjust_##n,
+
+SEQ100(ADJUST_OP, 0)
+SEQ100(ADJUST_OP, 1)
+
+static int (* const adjust_ops[])(void *inst, struct v4l2_ctrl *ctrl) = {
+	SEQ100(ADJUST_REF, 0)
+	SEQ100(ADJUST_REF, 1)
+};
+
+static_assert(ARRAY_SIZE(adjust_ops) >= INST_CAP_MAX, "too few adjust ops");
+
+/* point every adjust and set op of every codec at the models */
+static void install_models(u32 codecs)
+{
+	struct msm_vidc_inst_cap *cap;
+	u32 j, k;
+
+	for (j = 0; j < codecs; j++) {
+		for (k = INST_CAP_NONE + 1; k < INST_CAP_MAX; k++) {
+			cap = &core.inst_caps[j].cap[k];
+			if (cap->adjust)
+				cap->adjust = adjust_ops[k];
+			if (cap->set)
+				cap->set = model_set;
+		}
+	}
+}
+
+static void find_parents(const struct msm_vidc_inst_cap *table)
+{
+	enum msm_vidc_inst_capability_type child;
+	u32 k, i;
+
+	memset(parent_count, 0, sizeof(parent_count));
+	for (k = INST_CAP_NONE + 1; k < INST_CAP_MAX; k++) {
+		if (!table[k].cap_id)
+			continue;
+		for (i = 0; i < MAX_CAP_CHILDREN && table[k].children[i]; i++) {
+			child = table[k].children[i];
+			if (is_valid_cap_id(child))
+				parents[child][parent_count[child]++] = k;
+		}
+	}
+}
+
+/* msm_vidc_adjust_dynamic_property() and its helpers before the bitmaps */
+static int old_add_node_list(struct list_head *list,
+	enum msm_vidc_inst_capability_type cap_id)
+{
+	struct msm_vidc_inst_cap_entry *entry = NULL;
+
+	entry = vzalloc(sizeof(*entry));
+	if (!entry)
+		return -ENOMEM;
+
+	INIT_LIST_HEAD(&entry->list);
+	entry->cap_id = cap_id;
+	list_add(&entry->list, list);
+
+	return 0;
+}
+
+static int old_add_capid_to_fw_list(enum msm_vidc_inst_capability_type cap_id)
+{
+	struct msm_vidc_inst_cap_entry *entry = NULL;
+
+	list_for_each_entry(entry, &firmware_list, list) {
+		if (entry->cap_id == cap_id)
+			return 0;
+	}
+
+	return old_add_node_list(&firmware_list, cap_id);
+}
+
+static int old_add_children(struct msm_vidc_inst *inst,
+	enum msm_vidc_inst_capability_type cap_id)
+{
+	const struct msm_vidc_inst_cap *cap;
+	int i, rc = 0;
+
+	cap = &inst->cap_table[cap_id];
+
+	for (i = 0; i < MAX_CAP_CHILDREN; i++) {
+		if (!cap->children[i])
+			break;
+
+		if (!is_valid_cap_id(cap->children[i]))
+			continue;
+
+		rc = old_add_node_list(&children_list, cap->children[i]);
+		if (rc)
+			return rc;
+	}
+
+	return rc;
+}
+
+static int old_adjust_cap(struct msm_vidc_inst *inst,
+	enum msm_vidc_inst_capability_type cap_id, struct v4l2_ctrl *ctrl)
+{
+	const struct msm_vidc_inst_cap *cap;
+
+	if (!is_valid_cap_id(cap_id))
+		return 0;
+
+	cap = &inst->cap_table[cap_id];
+	if (!is_valid_cap(inst, cap->cap_id))
+		return 0;
+
+	if (!cap->adjust) {
+		if (ctrl)
+			msm_vidc_update_cap_value(inst, cap_id, ctrl->val, __func__);
+		return 0;
+	}
+
+	return cap->adjust(inst, ctrl);
+}
+
+static void old_free_list(struct list_head *list)
+{
+	struct msm_vidc_inst_cap_entry *entry = NULL, *temp = NULL;
+
+	list_for_each_entry_safe(entry, temp, list, list) {
+		list_del_init(&entry->list);
+		vfree(entry);
+	}
+}
+
+static int old_adjust_dynamic_property(struct msm_vidc_inst *inst,
+	enum msm_vidc_inst_capability_type cap_id, struct v4l2_ctrl *ctrl)
+{
+	struct msm_vidc_inst_cap_entry *entry = NULL, *temp = NULL;
+	struct msm_vidc_inst_cap_state *cap;
+	s32 prev_value;
+	int rc = 0;
+
+	cap = &inst->capabilities[0];
+
+	if (!(cap[cap_id].flags & CAP_FLAG_DYNAMIC_ALLOWED))
+		return -EBUSY;
+
+	prev_value = cap[cap_id].value;
+	rc = old_adjust_cap(inst, cap_id, ctrl);
+	if (rc)
+		return rc;
+
+	if (cap[cap_id].value == prev_value && cap_id == GOP_SIZE)
+		return 0;
+
+	rc = old_add_capid_to_fw_list(cap_id);
+	if (rc)
+		goto error;
+
+	if (cap[cap_id].value == prev_value)
+		return 0;
+
+	rc = old_add_children(inst, cap_id);
+	if (rc)
+		goto error;
+
+	list_for_each_entry_safe(entry, temp, &children_list, list) {
+		if (!inst->cap_table[entry->cap_id].adjust) {
+			rc = -EINVAL;
+			goto error;
+		}
+
+		prev_value = cap[entry->cap_id].value;
+		rc = old_adjust_cap(inst, entry->cap_id, NULL);
+		if (rc)
+			goto error;
+
+		if (cap[entry->cap_id].value != prev_value) {
+			rc = old_add_capid_to_fw_list(entry->cap_id);
+			if (rc)
+				goto error;
+
+			rc = old_add_children(inst, entry->cap_id);
+			if (rc)
+				goto error;
+		}
+
+		list_del_init(&entry->list);
+		vfree(entry);
+	}
+
+	if (!list_empty(&children_list)) {
+		rc = -EINVAL;
+		goto error;
+	}
+
+	return 0;
+error:
+	old_free_list(&children_list);
+	old_free_list(&firmware_list);
+
+	return rc;
+}
+
+static int old_s_ctrl(struct msm_vidc_inst *inst,
+	enum msm_vidc_inst_capability_type cap_id, struct v4l2_ctrl *ctrl)
+{
+	struct msm_vidc_inst_cap_entry *entry = NULL;
+	const struct msm_vidc_inst_cap *cap;
+	int rc;
+
+	inst->capabilities[cap_id].flags |= CAP_FLAG_CLIENT_SET;
+	rc = old_adjust_dynamic_property(inst, cap_id, ctrl);
+	if (rc)
+		return rc;
+
+	list_for_each_entry(entry, &firmware_list, list) {
+		cap = &inst->cap_table[entry->cap_id];
+		if (is_valid_cap(inst, cap->cap_id) && cap->set)
+			cap->set(inst, entry->cap_id);
+	}
+	old_free_list(&firmware_list);
+
+	return 0;
+}
+
+/* caps a client can set while streaming, each behind its own control id */
+static u32 dynamic_caps(enum msm_vidc_inst_capability_type *caps)
+{
+	const struct msm_vidc_inst_cap *table = inst.cap_table;
+	u32 count = 0, k;
+
+	for (k = INST_CAP_NONE + 1; k < INST_CAP_MAX; k++) {
+		if (!table[k].cap_id || !table[k].v4l2_id ||
+		    !(inst.capabilities[k].flags & CAP_FLAG_DYNAMIC_ALLOWED) ||
+		    msm_vidc_get_cap_id(&inst, table[k].v4l2_id) != k)
+			continue;
+		caps[count++] = k;
+	}
+
+	return count;
+}
+
+static void run_control(enum msm_vidc_inst_capability_type cap_id, s32 val,
+	struct prop_stats *stats)
+{
+	static struct msm_vidc_inst_cap_state before[INST_CAP_MAX + 1];
+	static struct msm_vidc_inst_cap_state old[INST_CAP_MAX + 1];
+	static struct msm_vidc_inst_cap_state ref[INST_CAP_MAX + 1];
+	DECLARE_BITMAP(expect_sent, INST_CAP_MAX);
+	struct prop_log old_log;
+	struct v4l2_ctrl ctrl = {
+		.id = inst.cap_table[cap_id].v4l2_id,
+		.name = cap_name(cap_id),
+		.val = val,
+	};
+	const struct msm_vidc_inst_cap *cap;
+	int rc, old_rc;
+	u32 k;
+
+	memcpy(before, inst.capabilities, sizeof(before));
+
+	/* the old walk */
+	memset(&log, 0, sizeof(log));
+	old_rc = old_s_ctrl(&inst, cap_id, &ctrl);
+	memcpy(old, inst.capabilities, sizeof(old));
+	old_log = log;
+
+	/* the client value followed by a full pass in dependency order */
+	memcpy(inst.capabilities, before, sizeof(before));
+	inst.capabilities[cap_id].flags |= CAP_FLAG_CLIENT_SET;
+	rc = old_adjust_cap(&inst, cap_id, &ctrl);
+	if (!rc)
+		rc = msm_vidc_adjust_v4l2_properties(&inst);
+	CHECK(!rc, "%s: full adjust pass failed: %d", cap_name(cap_id), rc);
+	memcpy(ref, inst.capabilities, sizeof(ref));
+
+	memcpy(inst.capabilities, before, sizeof(before));
+	memset(&log, 0, sizeof(log));
+	rc = msm_vidc_s_ctrl(&inst, &ctrl);
+
+	stats->controls++;
+	stats->adjusts += log.adjusts;
+	stats->sent += bitmap_weight(log.sent, INST_CAP_MAX);
+	if (rc) {
+		/* a child without an adjust op, which the old walk rejects too */
+		stats->rejected++;
+		CHECK(old_rc == rc, "%s = %d: rc %d, old walk %d",
+			cap_name(cap_id), val, rc, old_rc);
+		return;
+	}
+
+	if (!old_rc) {
+		CHECK(!memcmp(log.adjusted, old_log.adjusted, sizeof(log.adjusted)),
+			"%s = %d: adjusted caps differ from the old walk",
+			cap_name(cap_id), val);
+		CHECK(!memcmp(log.sent, old_log.sent, sizeof(log.sent)),
+			"%s = %d: sent caps differ from the old walk",
+			cap_name(cap_id), val);
+		CHECK(!memcmp(inst.capabilities, old, sizeof(old)),
+			"%s = %d: values differ from the old walk",
+			cap_name(cap_id), val);
+	} else {
+		stats->old_failed++;
+	}
+
+	CHECK(!memcmp(inst.capabilities, ref, sizeof(ref)),
+		"%s = %d: values differ from a full adjust pass",
+		cap_name(cap_id), val);
+	CHECK(log.adjusts == bitmap_weight(log.adjusted, INST_CAP_MAX),
+		"%s = %d: a cap was adjusted twice", cap_name(cap_id), val);
+
+	bitmap_zero(expect_sent, INST_CAP_MAX);
+	for (k = INST_CAP_NONE + 1; k < INST_CAP_MAX; k++) {
+		cap = &inst.cap_table[k];
+		if (!is_valid_cap(&inst, k) || !cap->set)
+			continue;
+		if (before[k].value != ref[k].value ||
+		    (k == cap_id && cap_id != GOP_SIZE))
+			set_bit(k, expect_sent);
+	}
+	CHECK(!memcmp(log.sent, expect_sent, sizeof(expect_sent)),
+		"%s = %d: sent caps are not the changed ones",
+		cap_name(cap_id), val);
+}
+
+static void run_session(const struct msm_vidc_inst_capability *caps,
+	u32 controls, unsigned int *seed, struct prop_stats *stats)
+{
+	static enum msm_vidc_inst_capability_type dyn[INST_CAP_MAX];
+	struct msm_vidc_inst_cap_entry *entry = NULL, *temp = NULL;
+	u32 count, i;
+	int rc;
+
+	memset(&inst, 0, sizeof(inst));
+	inst.core = &core;
+	inst.domain = caps->domain;
+	inst.codec = caps->codec;
+	INIT_LIST_HEAD(&inst.caps_list);
+	inst.bufq[INPUT_PORT].vb2q = &streaming_q;
+	inst.bufq[OUTPUT_PORT].vb2q = &streaming_q;
+	msm_vidc_get_inst_capability(&inst);
+	find_parents(inst.cap_table);
+
+	rc = msm_vidc_prepare_dependency_list(&inst);
+	if (!rc)
+		rc = msm_vidc_adjust_v4l2_properties(&inst);
+	CHECK(!rc, "%#x/%#x: session setup failed: %d",
+		caps->domain, caps->codec, rc);
+
+	count = dynamic_caps(dyn);
+	for (i = 0; i < controls && count && !rc; i++)
+		run_control(dyn[rand_r(seed) % count],
+			rand_r(seed) % CLIENT_VALUES, stats);
+
+	list_for_each_entry_safe(entry, temp, &inst.caps_list, list) {
+		list_del_init(&entry->list);
+		vfree(entry);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	u32 controls = 2000, codecs, j, p;
+	unsigned int seed = 1;
+	int rc;
+
+	if (argc > 1)
+		controls = max_t(u32, strtoul(argv[1], NULL, 0), 1);
+
+	/* children without an adjust op are rejected at error level */
+	msm_vidc_debug = 0;
+
+	for (p = 0; p < ARRAY_SIZE(platforms); p++) {
+		struct prop_stats stats = { 0 };
+
+		printf("%s\n", platforms[p].name);
+		memset(&core, 0, sizeof(core));
+		memset(&platform, 0, sizeof(platform));
+		core.pdev = &pdev;
+		core.platform = &platform;
+
+		rc = platforms[p].init(&core);
+		if (!rc)
+			rc = msm_vidc_init_core_caps(&core);
+		if (!rc)
+			rc = msm_vidc_init_instance_caps(&core);
+		CHECK(!rc, "capability init failed: %d", rc);
+		if (rc)
+			continue;
+
+		codecs = core.enc_codecs_count + core.dec_codecs_count;
+		install_models(codecs);
+		for (j = 0; j < codecs; j++)
+			run_session(&core.inst_caps[j], controls, &seed, &stats);
+
+		printf("  %u controls, %u rejected, %u the old walk failed, "
+			"%u adjusts, %u caps sent\n", stats.controls,
+			stats.rejected, stats.old_failed, stats.adjusts,
+			stats.sent);
+		free(core.inst_caps);
+	}
+
+	if (failed)
+		printf("FAIL\n");
+
+	return failed;
+}
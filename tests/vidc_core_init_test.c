@@ -0,0 +1,365 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Concurrent open against a stub firmware loader.
+ *
+ *   vidc_core_init_test
+ *
+ * Runs vidc/src/msm_vidc_core.c unmodified. OPENERS threads open the
+ * device the way msm_vidc_open() does (msm_vidc_core_init() followed by
+ * msm_vidc_core_init_wait()) while fw_load() sleeps LOAD_MS to stand in
+ * for request_firmware, the mdt load and TZ authentication. A prober
+ * thread keeps taking core->lock meanwhile, the way the ISR and the pm
+ * and clk workers do.
+ *
+ * Checks that the firmware is loaded once, that core->lock is never held
+ * across the load, that openers are not timed out by the sys init
+ * response timeout while the load is running, and that a load failure or
+ * a forced deinit during the load fails every opener and leaves the core
+ * deinited. The state helpers below mirror vidc/src/msm_vidc_state.c.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "msm_vidc_core.h"
+#include "msm_vidc_driver.h"
+#include "msm_vidc_state.h"
+#include "msm_vidc_debug.h"
+#include "venus_hfi.h"
+#include "firmware.h"
+
+#define OPENERS          8
+#define LOAD_MS          200
+#define SYS_INIT_MS      5
+#define RESPONSE_MS      50
+#define MAX_LOCK_WAIT_MS 20
+
+enum load_mode {
+	LOAD_OK,
+	LOAD_FAIL,
+	LOAD_DEINIT,
+};
+
+static struct msm_vidc_core core;
+static enum load_mode mode;
+static volatile bool loading;
+static pthread_t sys_init_t;
+static bool sys_init_sent;
+static int loads, locked_loads, deinits, releases;
+static int failed;
+
+#define CHECK(cond, fmt, ...) \
+	do { \
+		if (!(cond)) { \
+			printf("  FAIL: " fmt "\n", ##__VA_ARGS__); \
+			failed = 1; \
+		} \
+	} while (0)
+
+static void sleep_ms(unsigned int ms)
+{
+	usleep(ms * 1000);
+}
+
+void core_lock(struct msm_vidc_core *core, const char *function)
+{
+	mutex_lock(&core->lock);
+}
+
+void core_unlock(struct msm_vidc_core *core, const char *function)
+{
+	mutex_unlock(&core->lock);
+}
+
+int __strict_check(struct msm_vidc_core *core, const char *function)
+{
+	bool fatal = !mutex_is_locked(&core->lock);
+
+	if (fatal)
+		printf("  FAIL: %s: strict check failed\n", function);
+	failed |= fatal;
+
+	return fatal ? -EINVAL : 0;
+}
+
+const char *allow_name(enum msm_vidc_allow allow)
+{
+	return allow == MSM_VIDC_ALLOW ? "allowed" : "not allowed";
+}
+
+const char *core_state_name(enum msm_vidc_core_state state)
+{
+	static const char * const name[] = {
+		[MSM_VIDC_CORE_DEINIT] = "CORE_DEINIT",
+		[MSM_VIDC_CORE_INIT_WAIT] = "CORE_INIT_WAIT",
+		[MSM_VIDC_CORE_INIT] = "CORE_INIT",
+		[MSM_VIDC_CORE_ERROR] = "CORE_ERROR",
+	};
+
+	return state < ARRAY_SIZE(name) && name[state] ? name[state] : "UNKNOWN";
+}
+
+bool core_in_valid_state(struct msm_vidc_core *core)
+{
+	return (core->state == MSM_VIDC_CORE_INIT ||
+		core->state == MSM_VIDC_CORE_INIT_WAIT);
+}
+
+bool is_core_state(struct msm_vidc_core *core, enum msm_vidc_core_state state)
+{
+	return core->state == state;
+}
+
+enum msm_vidc_allow msm_vidc_allow_core_state_change(
+	struct msm_vidc_core *core,
+	enum msm_vidc_core_state req_state)
+{
+	if (core->state == req_state)
+		return MSM_VIDC_IGNORE;
+	if ((core->state == MSM_VIDC_CORE_INIT_WAIT &&
+	     req_state == MSM_VIDC_CORE_DEINIT) ||
+	    (core->state == MSM_VIDC_CORE_DEINIT &&
+	     req_state == MSM_VIDC_CORE_INIT) ||
+	    (core->state == MSM_VIDC_CORE_INIT &&
+	     req_state == MSM_VIDC_CORE_INIT_WAIT))
+		return MSM_VIDC_DISALLOW;
+	if (core->state == MSM_VIDC_CORE_ERROR &&
+	    req_state != MSM_VIDC_CORE_DEINIT)
+		return MSM_VIDC_IGNORE;
+	if (core->state == MSM_VIDC_CORE_DEINIT &&
+	    req_state == MSM_VIDC_CORE_ERROR)
+		return MSM_VIDC_IGNORE;
+
+	return MSM_VIDC_ALLOW;
+}
+
+int msm_vidc_change_core_state(struct msm_vidc_core *core,
+	enum msm_vidc_core_state request_state, const char *func)
+{
+	enum msm_vidc_core_state prev_state;
+	enum msm_vidc_allow allow;
+
+	if (__strict_check(core, func))
+		return -EINVAL;
+
+	allow = msm_vidc_allow_core_state_change(core, request_state);
+	if (allow == MSM_VIDC_IGNORE)
+		return 0;
+	else if (allow == MSM_VIDC_DISALLOW)
+		return -EINVAL;
+
+	/* openers wait for the core to leave INIT_WAIT */
+	if (request_state == MSM_VIDC_CORE_INIT_WAIT)
+		reinit_completion(&core->init_done);
+
+	prev_state = core->state;
+	core->state = request_state;
+
+	if (prev_state == MSM_VIDC_CORE_INIT_WAIT)
+		complete_all(&core->init_done);
+
+	return 0;
+}
+
+int msm_vidc_change_core_sub_state(struct msm_vidc_core *core,
+	enum msm_vidc_core_sub_state clear_sub_state,
+	enum msm_vidc_core_sub_state set_sub_state, const char *func)
+{
+	if (__strict_check(core, func))
+		return -EINVAL;
+
+	core->sub_state &= ~clear_sub_state;
+	core->sub_state |= set_sub_state;
+
+	return 0;
+}
+
+int msm_vidc_change_state(struct msm_vidc_inst *inst,
+	enum msm_vidc_state request_state, const char *func)
+{
+	return 0;
+}
+
+int venus_hfi_core_power_on(struct msm_vidc_core *core)
+{
+	return __strict_check(core, __func__);
+}
+
+/* stands in for the sys init response, handled under core->lock */
+static void *sys_init_done(void *arg)
+{
+	sleep_ms(SYS_INIT_MS);
+	core_lock(&core, __func__);
+	if (is_core_state(&core, MSM_VIDC_CORE_INIT_WAIT))
+		msm_vidc_change_core_state(&core, MSM_VIDC_CORE_INIT, __func__);
+	core_unlock(&core, __func__);
+
+	return NULL;
+}
+
+int venus_hfi_core_init(struct msm_vidc_core *core)
+{
+	int rc;
+
+	rc = __strict_check(core, __func__);
+	if (rc)
+		return rc;
+
+	pthread_create(&sys_init_t, NULL, sys_init_done, NULL);
+	sys_init_sent = true;
+
+	return 0;
+}
+
+int venus_hfi_core_deinit(struct msm_vidc_core *core, bool force)
+{
+	__strict_check(core, __func__);
+	deinits++;
+
+	return 0;
+}
+
+int fw_load(struct msm_vidc_core *core)
+{
+	__atomic_add_fetch(&loads, 1, __ATOMIC_RELAXED);
+	if (mutex_is_locked(&core->lock))
+		__atomic_add_fetch(&locked_loads, 1, __ATOMIC_RELAXED);
+
+	loading = true;
+	sleep_ms(LOAD_MS);
+	loading = false;
+
+	return mode == LOAD_FAIL ? -ENOENT : 0;
+}
+
+void fw_release(struct msm_vidc_core *core)
+{
+	releases++;
+}
+
+static void *opener(void *arg)
+{
+	int *rc = arg;
+
+	*rc = msm_vidc_core_init(&core);
+	if (!*rc)
+		*rc = msm_vidc_core_init_wait(&core);
+
+	return NULL;
+}
+
+/* takes core->lock while the load runs, as the ISR and workers would */
+static void *prober(void *arg)
+{
+	u64 *max_wait = arg, start;
+	bool seen = false;
+
+	while (!seen || loading) {
+		if (!loading) {
+			sleep_ms(1);
+			continue;
+		}
+		seen = true;
+		start = ktime_get_ns();
+		core_lock(&core, __func__);
+		*max_wait = max(*max_wait, ktime_get_ns() - start);
+		core_unlock(&core, __func__);
+		sleep_ms(1);
+	}
+
+	return NULL;
+}
+
+/* forced deinit from another context, e.g. ssr, during the load */
+static void *deinit_during_load(void *arg)
+{
+	while (!loading)
+		sleep_ms(1);
+	sleep_ms(LOAD_MS / 4);
+	msm_vidc_core_deinit(&core, true);
+
+	return NULL;
+}
+
+static void run(const char *name, enum load_mode load_mode)
+{
+	pthread_t open_t[OPENERS], probe_t, deinit_t;
+	int rc[OPENERS], ok = 0, i;
+	u64 start, elapsed, max_wait = 0;
+
+	printf("%s\n", name);
+	mode = load_mode;
+	loads = locked_loads = deinits = releases = 0;
+	core.state = MSM_VIDC_CORE_DEINIT;
+	core.sub_state = 0;
+
+	start = ktime_get_ns();
+	pthread_create(&probe_t, NULL, prober, &max_wait);
+	if (mode == LOAD_DEINIT)
+		pthread_create(&deinit_t, NULL, deinit_during_load, NULL);
+	for (i = 0; i < OPENERS; i++)
+		pthread_create(&open_t[i], NULL, opener, &rc[i]);
+	for (i = 0; i < OPENERS; i++) {
+		pthread_join(open_t[i], NULL);
+		ok += !rc[i];
+	}
+	pthread_join(probe_t, NULL);
+	if (mode == LOAD_DEINIT)
+		pthread_join(deinit_t, NULL);
+	if (sys_init_sent)
+		pthread_join(sys_init_t, NULL);
+	sys_init_sent = false;
+	elapsed = ktime_get_ns() - start;
+
+	printf("  %d of %d opens ok in %llu ms, fw loads %d, core deinits %d, "
+		"max core->lock wait %llu ms, state %s\n", ok, OPENERS,
+		elapsed / NSEC_PER_MSEC, loads, deinits,
+		max_wait / NSEC_PER_MSEC, core_state_name(core.state));
+
+	CHECK(loads == 1, "firmware loaded %d times", loads);
+	CHECK(!locked_loads, "core->lock held across fw_load()");
+	CHECK(max_wait < MAX_LOCK_WAIT_MS * NSEC_PER_MSEC,
+		"core->lock held for %llu ms during the load",
+		max_wait / NSEC_PER_MSEC);
+	CHECK(!core.fw_booting, "fw_booting left set");
+	if (mode == LOAD_OK) {
+		CHECK(ok == OPENERS, "%d openers failed", OPENERS - ok);
+		CHECK(is_core_state(&core, MSM_VIDC_CORE_INIT),
+			"core left in %s", core_state_name(core.state));
+		CHECK(!deinits, "core deinited %d times", deinits);
+	} else {
+		CHECK(!ok, "%d openers succeeded", ok);
+		CHECK(is_core_state(&core, MSM_VIDC_CORE_DEINIT),
+			"core left in %s", core_state_name(core.state));
+		CHECK(deinits == 1 && releases == 1,
+			"core deinited %d times, fw released %d times",
+			deinits, releases);
+	}
+
+	/* a closed device drops the core for the next run */
+	core_lock(&core, __func__);
+	msm_vidc_core_deinit_locked(&core, false);
+	core_unlock(&core, __func__);
+}
+
+int main(void)
+{
+	/* expected core init failures are logged at error level */
+	msm_vidc_debug = 0;
+
+	mutex_init(&core.lock);
+	init_completion(&core.init_done);
+	INIT_LIST_HEAD(&core.instances);
+	INIT_LIST_HEAD(&core.dangling_instances);
+	/* shorter than the load: openers must keep waiting past it */
+	core.capabilities[HW_RESPONSE_TIMEOUT].value = RESPONSE_MS;
+
+	run("concurrent open", LOAD_OK);
+	run("concurrent open, fw load fails", LOAD_FAIL);
+	run("concurrent open, forced deinit during fw load", LOAD_DEINIT);
+
+	if (failed)
+		printf("FAIL\n");
+
+	return failed;
+}
@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Closed loop dcvs replay.
+ *
+ *   vidc_dcvs_sim <trace> [fps]
+ *
+ * Replays a recorded per-frame firmware cycle trace through the closed
+ * loop controller in msm_vidc_power.h and reports deadline misses and the
+ * average core clock. The client queues one input per frame period and
+ * keeps DPB_OUTPUTS output buffers with firmware, so output buffers are
+ * queued well ahead of the frame they carry, as in real-time playback.
+ * A frame misses its deadline when it is not done DISPLAY_DELAY frame
+ * periods after its ETB.
+ *
+ * Three policies are compared: the controller fed from the matching ETB,
+ * the same controller fed from FTB only (the sample then measures the
+ * interval between FBDs), and a fixed maximum rate. Exits non-zero when
+ * the ETB fed controller ends up at or above the FTB only one on average,
+ * or misses more deadlines than the fixed maximum rate plus 1%.
+ */
+
+#include <stdlib.h>
+
+#include "msm_vidc_power.h"
+
+#define MAX_FRAMES    4096
+#define DPB_OUTPUTS   8
+#define DISPLAY_DELAY 2
+
+enum sim_policy {
+	SIM_ETB,
+	SIM_FTB_ONLY,
+	SIM_MAX_RATE,
+};
+
+static const char * const policy_name[] = {
+	[SIM_ETB] = "closed loop, etb",
+	[SIM_FTB_ONLY] = "closed loop, ftb only",
+	[SIM_MAX_RATE] = "max rate",
+};
+
+/* qcm6490 sku0 */
+static struct frequency_table freq_tbl[] = {
+	{460000048}, {424000000}, {335000000}, {240000000}, {133333000},
+};
+
+struct sim_result {
+	u32 misses;
+	u64 avg_freq;
+};
+
+static u32 load_trace(const char *path, u64 *cycles)
+{
+	char line[128];
+	u32 n = 0;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		exit(2);
+	}
+	while (n < MAX_FRAMES && fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		cycles[n++] = strtoull(line, NULL, 10);
+	}
+	fclose(f);
+
+	return n;
+}
+
+static void run(enum sim_policy policy, const u64 *trace, u32 frames,
+	u32 fps, struct sim_result *res)
+{
+	u64 done[MAX_FRAMES];
+	u64 period = NSEC_PER_SEC / fps;
+	u64 clk = freq_tbl[0].freq, rate = 0;
+	u64 avg = 0, freq_sum = 0, last_done = 0;
+	u64 etb, ftb, start, proc, sample;
+	u32 samples = 0, k;
+
+	res->misses = 0;
+	for (k = 0; k < frames; k++) {
+		etb = (u64)k * period + 1;
+		ftb = k < DPB_OUTPUTS ? 1 : done[k - DPB_OUTPUTS];
+
+		start = max3(etb, ftb, last_done);
+		proc = DIV_ROUND_UP(trace[k] * NSEC_PER_SEC, clk);
+		done[k] = start + proc;
+		if (done[k] > etb + DISPLAY_DELAY * period)
+			res->misses++;
+		freq_sum += clk;
+
+		sample = msm_vidc_frame_proc_ns(
+			policy == SIM_FTB_ONLY ? 0 : etb, ftb,
+			last_done, done[k], fps);
+		last_done = done[k];
+		if (policy == SIM_MAX_RATE || !sample)
+			continue;
+
+		avg = msm_vidc_frame_cycles_avg(avg, samples++,
+			sample * clk / NSEC_PER_SEC);
+		if (samples < DCVS_WINDOW)
+			continue;
+
+		rate = msm_vidc_closed_loop_rate(freq_tbl, ARRAY_SIZE(freq_tbl),
+			avg, fps, rate, 10, 10);
+		clk = rate;
+	}
+	res->avg_freq = frames ? freq_sum / frames : 0;
+}
+
+int main(int argc, char **argv)
+{
+	static u64 trace[MAX_FRAMES];
+	struct sim_result res[ARRAY_SIZE(policy_name)];
+	u32 frames, fps = 30, i;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <trace> [fps]\n", argv[0]);
+		return 2;
+	}
+	if (argc > 2)
+		fps = strtoul(argv[2], NULL, 10);
+
+	frames = load_trace(argv[1], trace);
+	if (!frames || !fps) {
+		fprintf(stderr, "%s: empty trace\n", argv[1]);
+		return 2;
+	}
+
+	printf("%u frames at %u fps\n", frames, fps);
+	printf("%-24s %8s %10s\n", "policy", "misses", "avg MHz");
+	for (i = 0; i < ARRAY_SIZE(policy_name); i++) {
+		run(i, trace, frames, fps, &res[i]);
+		printf("%-24s %8u %10llu\n", policy_name[i], res[i].misses,
+			res[i].avg_freq / 1000000);
+	}
+
+	if (res[SIM_ETB].avg_freq >= res[SIM_FTB_ONLY].avg_freq ||
+	    res[SIM_ETB].misses > res[SIM_MAX_RATE].misses + frames / 100) {
+		printf("FAIL\n");
+		return 1;
+	}
+
+	return 0;
+}
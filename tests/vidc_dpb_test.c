@@ -0,0 +1,294 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * DPB list slots against the payload scan they replaced.
+ *
+ *   vidc_dpb_test [lists]
+ *
+ * Replays random DPB list sequences through msm_vidc_dpb_slots_update(),
+ * the way handle_dpb_list_property() does for every list firmware sends.
+ * A list mostly carries entries of the previous one over, and holds zero
+ * (unused) entries, duplicate entries, entries of no read only buffer and
+ * garbage in the words the match ignores.
+ *
+ * After every list, each read only buffer is classified with
+ * msm_vidc_dpb_slots_find() from its cached slot, as
+ * msm_vdec_release_nonref_buffers() does, sometimes from a stale one.
+ * Checks the verdict against the scan of all dpb_list_payload entries it
+ * replaced, that an entry listed in consecutive lists keeps its slot, and
+ * that the referenced and dropped slots are the distinct entries of the
+ * current list and the ones only the previous list held. Then prints the
+ * time to classify all buffers each way, which the driver pays on every
+ * output qbuf, and the time to update the slots, paid once per list.
+ * Timings are informational.
+ */
+
+#include <stdlib.h>
+
+#include "msm_vidc_internal.h"
+
+#define RO_BUFS      32
+#define DPB_ENTRIES  (MAX_DPB_LIST_ARRAY_SIZE / 4)
+#define FOREIGN      8
+
+struct dpb_key {
+	u32 device_addr;
+	u32 data_offset;
+};
+
+struct ro_buf {
+	u64 device_addr;
+	u32 data_offset;
+	u8 dpb_slot;
+};
+
+static struct ro_buf bufs[RO_BUFS];
+static struct dpb_key pool[RO_BUFS + FOREIGN];
+static int failed;
+
+#define CHECK(cond, fmt, ...) \
+	do { \
+		if (!(cond)) { \
+			printf("  FAIL: " fmt "\n", ##__VA_ARGS__); \
+			failed = 1; \
+		} \
+	} while (0)
+
+/* msm_vdec_release_nonref_buffers() before the slots */
+static bool scan_referenced(const u32 *payload, const struct ro_buf *buf)
+{
+	int i;
+
+	for (i = 0; (i + 3) < MAX_DPB_LIST_ARRAY_SIZE; i = i + 4) {
+		if (buf->device_addr == payload[i] &&
+			buf->data_offset == payload[i + 3])
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Pairs of buffers share a base address at different data offsets, and
+ * the last few sit above 4G: the low word of their address is that of
+ * another buffer, which neither match may mistake for theirs.
+ */
+static void init_bufs(void)
+{
+	u32 k;
+
+	for (k = 0; k < RO_BUFS; k++) {
+		bufs[k].device_addr = 0x80000000 + (k / 2) * 0x200000;
+		bufs[k].data_offset = (k % 2) * 0x1000;
+		if (k >= RO_BUFS - 4)
+			bufs[k].device_addr += 0x100000000ULL - 0x200000;
+		bufs[k].dpb_slot = MAX_DPB_SLOTS;
+		pool[k].device_addr = bufs[k].device_addr;
+		pool[k].data_offset = bufs[k].data_offset;
+	}
+	for (k = 0; k < FOREIGN; k++) {
+		pool[RO_BUFS + k].device_addr = 0x40000000 + k * 0x200000;
+		pool[RO_BUFS + k].data_offset = k % 3 ? 0 : 0x800;
+	}
+}
+
+static void set_entry(u32 *payload, u32 i, const struct dpb_key *key,
+	unsigned int *seed)
+{
+	payload[i] = key->device_addr;
+	/* the high base_address word and addr_offset take no part */
+	payload[i + 1] = rand_r(seed) % 4 ? 0 : rand_r(seed);
+	payload[i + 2] = rand_r(seed) % 4 ? 0 : rand_r(seed);
+	payload[i + 3] = key->data_offset;
+}
+
+static void next_list(u32 *payload, const u32 *prev, unsigned int *seed)
+{
+	struct dpb_key key;
+	u32 e, i, r;
+
+	for (e = 0; e < DPB_ENTRIES; e++) {
+		i = e * 4;
+		r = rand_r(seed) % 10;
+		if (r < 2) {
+			/* unused, sometimes with stale words behind it */
+			memset(&payload[i], 0, 4 * sizeof(u32));
+			if (r)
+				payload[i + 3] = pool[rand_r(seed) % RO_BUFS].data_offset;
+		} else if (r < 3 && e) {
+			memcpy(&payload[i], &payload[(rand_r(seed) % e) * 4],
+				4 * sizeof(u32));
+		} else if (r < 8) {
+			memcpy(&payload[i],
+				&prev[(rand_r(seed) % DPB_ENTRIES) * 4],
+				4 * sizeof(u32));
+		} else {
+			key = pool[rand_r(seed) % ARRAY_SIZE(pool)];
+			set_entry(payload, i, &key, seed);
+		}
+	}
+}
+
+static bool listed(const u32 *payload, u32 device_addr, u32 data_offset)
+{
+	u32 i;
+
+	for (i = 0; (i + 3) < MAX_DPB_LIST_ARRAY_SIZE; i += 4)
+		if (payload[i] && payload[i] == device_addr &&
+		    payload[i + 3] == data_offset)
+			return true;
+
+	return false;
+}
+
+/* distinct non-zero entries of @payload, and how many @other lists too */
+static u32 distinct(const u32 *payload, const u32 *other, u32 *common)
+{
+	u32 count = 0, i, j;
+
+	*common = 0;
+	for (i = 0; (i + 3) < MAX_DPB_LIST_ARRAY_SIZE; i += 4) {
+		if (!payload[i])
+			continue;
+		for (j = 0; j < i; j += 4)
+			if (payload[j] == payload[i] &&
+			    payload[j + 3] == payload[i + 3])
+				break;
+		if (j < i)
+			continue;
+		count++;
+		*common += listed(other, payload[i], payload[i + 3]);
+	}
+
+	return count;
+}
+
+static void check_slots(const struct msm_vidc_dpb_slots *slots,
+	const struct msm_vidc_dpb_slots *prev_slots, const u32 *payload,
+	const u32 *prev, const unsigned long *dropped, u32 n)
+{
+	u32 count, common, prev_count, slot, prev_slot, i;
+
+	for (i = 0; (i + 3) < MAX_DPB_LIST_ARRAY_SIZE; i += 4) {
+		if (!payload[i])
+			continue;
+		slot = msm_vidc_dpb_slots_find(slots, MAX_DPB_SLOTS,
+			payload[i], payload[i + 3]);
+		CHECK(slot < MAX_DPB_SLOTS, "list %u: entry %u has no slot",
+			n, i / 4);
+		if (!listed(prev, payload[i], payload[i + 3]))
+			continue;
+		prev_slot = msm_vidc_dpb_slots_find(prev_slots, MAX_DPB_SLOTS,
+			payload[i], payload[i + 3]);
+		CHECK(slot == prev_slot, "list %u: entry %u moved from slot %u to %u",
+			n, i / 4, prev_slot, slot);
+	}
+
+	count = distinct(payload, prev, &common);
+	prev_count = distinct(prev, payload, &common);
+	CHECK(bitmap_weight(slots->ref, MAX_DPB_SLOTS) == count,
+		"list %u: %u slots referenced for %u entries", n,
+		bitmap_weight(slots->ref, MAX_DPB_SLOTS), count);
+	CHECK(bitmap_weight(dropped, MAX_DPB_SLOTS) == prev_count - common,
+		"list %u: %u slots dropped, %u entries left the list", n,
+		bitmap_weight(dropped, MAX_DPB_SLOTS), prev_count - common);
+}
+
+static void replay(u32 lists, unsigned int seed)
+{
+	static u32 payload[MAX_DPB_LIST_ARRAY_SIZE];
+	static u32 prev[MAX_DPB_LIST_ARRAY_SIZE];
+	struct msm_vidc_dpb_slots slots = { 0 }, prev_slots;
+	DECLARE_BITMAP(dropped, MAX_DPB_SLOTS);
+	u32 n, k, checks = 0, mismatches = 0, refs = 0;
+	bool scan, found;
+
+	memset(prev, 0, sizeof(prev));
+	for (n = 0; n < lists; n++) {
+		next_list(payload, prev, &seed);
+		prev_slots = slots;
+		msm_vidc_dpb_slots_update(&slots, payload, dropped);
+		check_slots(&slots, &prev_slots, payload, prev, dropped, n);
+
+		for (k = 0; k < RO_BUFS; k++) {
+			/* a buffer recycled with another buffer's slot */
+			if (!(rand_r(&seed) % 16))
+				bufs[k].dpb_slot = rand_r(&seed) % (MAX_DPB_SLOTS + 1);
+			bufs[k].dpb_slot = msm_vidc_dpb_slots_find(&slots,
+				bufs[k].dpb_slot, bufs[k].device_addr,
+				bufs[k].data_offset);
+			found = bufs[k].dpb_slot < MAX_DPB_SLOTS;
+			scan = scan_referenced(payload, &bufs[k]);
+			checks++;
+			refs += scan;
+			if (found != scan) {
+				mismatches++;
+				printf("  list %u buf %#llx+%#x: scan %d, slots %d\n",
+					n, bufs[k].device_addr,
+					bufs[k].data_offset, scan, found);
+			}
+		}
+		memcpy(prev, payload, sizeof(prev));
+	}
+
+	printf("  %u lists, %u buffer checks, %u referenced, %u mismatches\n",
+		lists, checks, refs, mismatches);
+	CHECK(!mismatches, "slots disagree with the payload scan");
+}
+
+static void timing(u32 lists, unsigned int seed)
+{
+	static u32 payload[MAX_DPB_LIST_ARRAY_SIZE];
+	static u32 prev[MAX_DPB_LIST_ARRAY_SIZE];
+	struct msm_vidc_dpb_slots slots = { 0 };
+	DECLARE_BITMAP(dropped, MAX_DPB_SLOTS);
+	u64 start, scan_ns = 0, update_ns = 0, find_ns = 0;
+	volatile u32 sink = 0;
+	u32 n, k;
+
+	memset(prev, 0, sizeof(prev));
+	for (n = 0; n < lists; n++) {
+		next_list(payload, prev, &seed);
+
+		start = ktime_get_ns();
+		for (k = 0; k < RO_BUFS; k++)
+			sink += scan_referenced(payload, &bufs[k]);
+		scan_ns += ktime_get_ns() - start;
+
+		start = ktime_get_ns();
+		msm_vidc_dpb_slots_update(&slots, payload, dropped);
+		update_ns += ktime_get_ns() - start;
+
+		start = ktime_get_ns();
+		for (k = 0; k < RO_BUFS; k++) {
+			bufs[k].dpb_slot = msm_vidc_dpb_slots_find(&slots,
+				bufs[k].dpb_slot, bufs[k].device_addr,
+				bufs[k].data_offset);
+			sink += bufs[k].dpb_slot;
+		}
+		find_ns += ktime_get_ns() - start;
+		memcpy(prev, payload, sizeof(prev));
+	}
+
+	printf("  ns to classify %u buffers: payload scan %.0f, slots %.0f\n",
+		RO_BUFS, scan_ns / (double)lists, find_ns / (double)lists);
+	printf("  ns to update the slots per list: %.0f\n",
+		update_ns / (double)lists);
+}
+
+int main(int argc, char **argv)
+{
+	u32 lists = 20000;
+
+	if (argc > 1)
+		lists = max_t(u32, strtoul(argv[1], NULL, 0), 1);
+
+	init_bufs();
+	printf("dpb list replay\n");
+	replay(lists, 1);
+	timing(lists, 2);
+
+	if (failed)
+		printf("FAIL\n");
+
+	return failed;
+}
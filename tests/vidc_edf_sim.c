@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Multi-session clock aggregation replay.
+ *
+ *   vidc_edf_sim
+ *
+ * Replays a few session mixes on one core and compares the sum policy
+ * (lowest table rate covering the sum of per-session model rates) with
+ * the EDF policy (msm_vidc_edf_demand() over each session's deadline
+ * slack). The core rate is picked again at every frame start, the way
+ * every qbuf does in the driver, and firmware runs frames to completion
+ * earliest deadline first.
+ *
+ * Decoders keep DEC_BUFFERS output buffers: a frame can start once one is
+ * free, is due when it is displayed, and frames done ahead of display are
+ * the slack, read back through the same nominal dcvs threshold the driver
+ * uses. Realtime encoders get a frame per period, due one period later.
+ * Actual frame cycles vary below the model's per-frame estimate.
+ *
+ * Buffer count dcvs steps are left out of both policies. Exits non-zero
+ * when EDF misses more deadlines or runs faster on average than sum.
+ */
+
+#include <stdlib.h>
+
+#include "msm_vidc_power.h"
+
+#define SIM_SECONDS     10
+#define DEC_BUFFERS     8
+#define DEC_NOM         6
+#define DEC_PREROLL     3
+#define MAX_SESSIONS    4
+
+enum sim_policy {
+	SIM_SUM,
+	SIM_EDF,
+};
+
+struct sim_session {
+	u32 fps;
+	u64 frame_cycles;
+	bool decoder;
+};
+
+struct sim_mix {
+	const char *name;
+	u32 count;
+	struct sim_session s[MAX_SESSIONS];
+};
+
+struct sim_state {
+	u64 period;
+	u64 offset;
+	u32 next;
+	u32 done;
+};
+
+struct sim_result {
+	u32 frames;
+	u32 misses;
+	u64 avg_freq;
+	u64 rates[8];
+};
+
+/* qcm6490 sku0 */
+static struct frequency_table freq_tbl[] = {
+	{460000048}, {424000000}, {335000000}, {240000000}, {133333000},
+};
+
+static const struct sim_mix mixes[] = {
+	{ "dec 1080p30 + 1080p60 + 720p120", 3, {
+		{  30, 3000000, true  },
+		{  60, 2600000, true  },
+		{ 120, 1200000, true  },
+	} },
+	{ "dec 4k30 + enc 1080p30", 2, {
+		{  30, 7600000, true  },
+		{  30, 3200000, false },
+	} },
+	{ "dec 4x 1080p30", 4, {
+		{  30, 2900000, true  },
+		{  30, 2900000, true  },
+		{  30, 2900000, true  },
+		{  30, 2900000, true  },
+	} },
+	{ "dec 1080p60 + 720p30", 2, {
+		{  60, 2600000, true  },
+		{  30, 1300000, true  },
+	} },
+};
+
+static u32 seed;
+
+/* actual cycles are 80..100% of the model's estimate */
+static u64 actual_cycles(u64 model)
+{
+	seed = seed * 1103515245 + 12345;
+	return model * (80 + (seed >> 16) % 21) / 100;
+}
+
+static u64 release_time(const struct sim_session *s,
+	const struct sim_state *st, u32 k)
+{
+	if (!s->decoder)
+		return st->offset + (u64)k * st->period;
+	/*
+	 * one buffer on display, the rest free for decoding ahead. A buffer
+	 * comes back when the next frame replaces it on display.
+	 */
+	if (k < DEC_BUFFERS - 1)
+		return st->offset;
+	return st->offset +
+		(u64)(k - (DEC_BUFFERS - 1) + 1 + DEC_PREROLL) * st->period;
+}
+
+static u64 deadline(const struct sim_session *s,
+	const struct sim_state *st, u32 k)
+{
+	if (!s->decoder)
+		return st->offset + (u64)(k + 1) * st->period;
+	return st->offset + (u64)(k + DEC_PREROLL) * st->period;
+}
+
+static u32 slack_frames(const struct sim_session *s,
+	const struct sim_state *st, u64 now)
+{
+	u32 displayed = 0, ready;
+	int bufs_with_fw;
+
+	if (!s->decoder)
+		return 0;
+	if (now >= st->offset + DEC_PREROLL * st->period)
+		displayed = (now - st->offset) / st->period - DEC_PREROLL + 1;
+	ready = st->done > displayed ? st->done - displayed : 0;
+	/*
+	 * client holds the ready frames and the one on display, plus one
+	 * as msm_vidc_bufs_with_fw() counts the buffer being queued
+	 */
+	bufs_with_fw = DEC_BUFFERS - (int)ready;
+
+	return bufs_with_fw < DEC_NOM ? DEC_NOM - bufs_with_fw : 0;
+}
+
+static u64 pick_rate(enum sim_policy policy, const struct sim_mix *mix,
+	const struct sim_state *st, u64 now)
+{
+	u64 demand = 0;
+	u32 i;
+
+	for (i = 0; i < mix->count; i++) {
+		const struct sim_session *s = &mix->s[i];
+
+		if (policy == SIM_SUM)
+			demand += s->frame_cycles * s->fps;
+		else
+			demand += msm_vidc_edf_demand(s->frame_cycles, s->fps,
+				slack_frames(s, &st[i], now), 0);
+	}
+
+	return msm_vidc_table_rate(freq_tbl, ARRAY_SIZE(freq_tbl), demand);
+}
+
+static void run(enum sim_policy policy, const struct sim_mix *mix,
+	struct sim_result *res)
+{
+	struct sim_state st[MAX_SESSIONS];
+	u64 end = SIM_SECONDS * NSEC_PER_SEC;
+	u64 now = 0, rate, t, best_dl, dl, freq_time = 0, busy = 0;
+	int best;
+	u32 i, r;
+
+	memset(res, 0, sizeof(*res));
+	seed = 1;
+	for (i = 0; i < mix->count; i++) {
+		st[i].period = NSEC_PER_SEC / mix->s[i].fps;
+		st[i].offset = i * NSEC_PER_MSEC;
+		st[i].next = 0;
+		st[i].done = 0;
+	}
+
+	while (now < end) {
+		/* earliest deadline among released frames */
+		best = -1;
+		best_dl = 0;
+		for (i = 0; i < mix->count; i++) {
+			if (release_time(&mix->s[i], &st[i], st[i].next) > now)
+				continue;
+			dl = deadline(&mix->s[i], &st[i], st[i].next);
+			if (best < 0 || dl < best_dl) {
+				best = i;
+				best_dl = dl;
+			}
+		}
+		if (best < 0) {
+			/* idle until the next release */
+			t = end;
+			for (i = 0; i < mix->count; i++)
+				t = min(t, release_time(&mix->s[i], &st[i], st[i].next));
+			now = t;
+			continue;
+		}
+
+		rate = pick_rate(policy, mix, st, now);
+		for (r = 0; r < ARRAY_SIZE(freq_tbl); r++)
+			if (freq_tbl[r].freq == rate)
+				res->rates[r]++;
+		t = DIV_ROUND_UP(actual_cycles(mix->s[best].frame_cycles) *
+			NSEC_PER_SEC, rate);
+		freq_time += t * (rate / 1000000);
+		busy += t;
+		now += t;
+		if (now > best_dl)
+			res->misses++;
+		st[best].next++;
+		st[best].done++;
+		res->frames++;
+	}
+	res->avg_freq = busy ? freq_time / busy : 0;
+}
+
+int main(void)
+{
+	struct sim_result res[2];
+	int ret = 0;
+	u32 m, r;
+
+	for (m = 0; m < ARRAY_SIZE(mixes); m++) {
+		printf("%s\n", mixes[m].name);
+		printf("  %-6s %7s %7s %8s  frames at", "policy", "frames",
+			"misses", "busy MHz");
+		for (r = 0; r < ARRAY_SIZE(freq_tbl); r++)
+			printf(" %4llu", freq_tbl[r].freq / 1000000);
+		printf("\n");
+
+		run(SIM_SUM, &mixes[m], &res[SIM_SUM]);
+		run(SIM_EDF, &mixes[m], &res[SIM_EDF]);
+		for (r = 0; r < 2; r++) {
+			u32 k;
+
+			printf("  %-6s %7u %7u %8llu %10s", r ? "edf" : "sum",
+				res[r].frames, res[r].misses, res[r].avg_freq, "");
+			for (k = 0; k < ARRAY_SIZE(freq_tbl); k++)
+				printf(" %4llu", res[r].rates[k]);
+			printf("\n");
+		}
+
+		if (res[SIM_EDF].misses > res[SIM_SUM].misses ||
+		    res[SIM_EDF].avg_freq > res[SIM_SUM].avg_freq) {
+			printf("  FAIL\n");
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Session open/close rate and session work ordering.
+ *
+ *   vidc_inst_bench [cycles]
+ *
+ * Runs vidc/src/msm_vidc_inst.c unmodified on the shim workqueue. An
+ * open/close cycle takes a shell with msm_vidc_get_inst_shell(), posts the
+ * deferred debugfs and the stats work the way msm_vidc_open() and streamon
+ * do, then cancels the session work and frees the shell as close does.
+ * Prints cycles per second with the shell cache warm, with it emptied
+ * before every open, and with an ordered workqueue allocated and destroyed
+ * per session on top of the cold open, as every session used to pay.
+ * The warm cycle includes the refill it queues whenever the workers share
+ * the CPU with the opener, and a shim shell is a malloc(), not a
+ * vzalloc(): the cache pays off in the kernel, not here.
+ *
+ * Then POSTERS threads post random session work to SESSIONS sessions on
+ * the shared workqueue. Checks that no two work passes of one session ever
+ * overlap, that passes of different sessions do, and that every posted
+ * event is seen by a later pass. Rates are informational.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "msm_vidc_inst.h"
+#include "msm_vidc_core.h"
+#include "msm_vidc_driver.h"
+
+#define SESSIONS 16
+#define POSTERS  4
+#define POSTS    5000
+#define PASS_US  20
+
+struct session_track {
+	int running;
+	u32 posted[MSM_VIDC_INST_WORK_STATS + 1];
+	u32 seen[MSM_VIDC_INST_WORK_STATS + 1];
+};
+
+static struct msm_vidc_core core;
+static struct msm_vidc_inst *sessions[SESSIONS];
+static struct session_track track[SESSIONS];
+static bool tracking;
+static int overlaps, running, max_running;
+static int failed;
+
+#define CHECK(cond, fmt, ...) \
+	do { \
+		if (!(cond)) { \
+			printf("  FAIL: " fmt "\n", ##__VA_ARGS__); \
+			failed = 1; \
+		} \
+	} while (0)
+
+static struct session_track *inst_track(struct msm_vidc_inst *inst)
+{
+	int i;
+
+	for (i = 0; i < SESSIONS; i++)
+		if (sessions[i] == inst)
+			return &track[i];
+
+	return NULL;
+}
+
+/* one work pass of a session, checked against the others */
+static void session_work(struct msm_vidc_inst *inst,
+	enum msm_vidc_inst_work type)
+{
+	struct session_track *t;
+	int now, prev;
+
+	t = tracking ? inst_track(inst) : NULL;
+	if (!t)
+		return;
+
+	if (__atomic_exchange_n(&t->running, 1, __ATOMIC_ACQ_REL))
+		__atomic_add_fetch(&overlaps, 1, __ATOMIC_RELAXED);
+	now = __atomic_add_fetch(&running, 1, __ATOMIC_RELAXED);
+	prev = __atomic_load_n(&max_running, __ATOMIC_RELAXED);
+	while (now > prev &&
+	       !__atomic_compare_exchange_n(&max_running, &prev, now, false,
+			__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+
+	/* a posted event is only seen once its bit was consumed */
+	t->seen[type] = __atomic_load_n(&t->posted[type], __ATOMIC_ACQUIRE);
+	/* stands in for waiting on inst->lock */
+	usleep(PASS_US);
+
+	__atomic_sub_fetch(&running, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&t->running, 0, __ATOMIC_RELEASE);
+}
+
+void msm_vidc_debugfs_work(struct msm_vidc_inst *inst)
+{
+	session_work(inst, MSM_VIDC_INST_WORK_DEBUGFS);
+}
+
+void msm_vidc_input_fence_work(struct msm_vidc_inst *inst)
+{
+	session_work(inst, MSM_VIDC_INST_WORK_INPUT_FENCE);
+}
+
+void msm_vidc_stats_work(struct msm_vidc_inst *inst)
+{
+	session_work(inst, MSM_VIDC_INST_WORK_STATS);
+}
+
+void msm_vidc_stats_handler(struct work_struct *work)
+{
+	struct msm_vidc_inst *inst;
+
+	inst = container_of(work, struct msm_vidc_inst, stats_work.work);
+	msm_vidc_queue_inst_work(inst, MSM_VIDC_INST_WORK_STATS);
+}
+
+void msm_vidc_stability_handler(struct work_struct *work)
+{
+}
+
+enum open_mode {
+	OPEN_WARM,
+	OPEN_COLD,
+	OPEN_SESSION_WORKQ,
+};
+
+static void open_close(enum open_mode mode, u32 cycles)
+{
+	static const char * const name[] = {
+		[OPEN_WARM] = "warm shell cache",
+		[OPEN_COLD] = "empty shell cache",
+		[OPEN_SESSION_WORKQ] = "empty cache, per-session workqueue",
+	};
+	struct workqueue_struct *workq;
+	struct msm_vidc_inst *inst;
+	u32 i, hits = 0;
+	u64 start, ns = 0;
+
+	msm_vidc_inst_cache_deinit(&core);
+	if (mode == OPEN_WARM) {
+		queue_work(core.inst_workq, &core.inst_cache_work);
+		flush_workqueue(core.inst_workq);
+	}
+
+	for (i = 0; i < cycles; i++) {
+		if (mode != OPEN_WARM)
+			msm_vidc_inst_cache_deinit(&core);
+		else
+			hits += !!core.inst_cache_count;
+
+		start = ktime_get_ns();
+		workq = NULL;
+		if (mode == OPEN_SESSION_WORKQ)
+			workq = alloc_ordered_workqueue("vidc_session_workq",
+				WQ_HIGHPRI);
+		inst = msm_vidc_get_inst_shell(&core);
+		CHECK(inst, "no shell");
+		if (!inst)
+			return;
+		inst->core = &core;
+		msm_vidc_queue_inst_work(inst, MSM_VIDC_INST_WORK_DEBUGFS);
+		mod_delayed_work(core.inst_workq, &inst->stats_work, 0);
+
+		msm_vidc_cancel_inst_work(inst);
+		msm_vidc_free_inst_shell(inst);
+		if (workq)
+			destroy_workqueue(workq);
+		ns += ktime_get_ns() - start;
+
+		/* the refill competes with the next open, as it would */
+		if (mode == OPEN_WARM)
+			flush_workqueue(core.inst_workq);
+	}
+
+	printf("  %-36s %9.0f cycles/s", name[mode],
+		cycles / (ns / (double)NSEC_PER_SEC));
+	if (mode == OPEN_WARM)
+		printf(", %u/%u from the cache", hits, cycles);
+	printf("\n");
+}
+
+static void *poster(void *arg)
+{
+	unsigned int seed = (uintptr_t)arg;
+	struct session_track *t;
+	u32 i, s, type;
+
+	for (i = 0; i < POSTS; i++) {
+		s = rand_r(&seed) % SESSIONS;
+		type = rand_r(&seed) % (MSM_VIDC_INST_WORK_STATS + 1);
+		t = &track[s];
+		__atomic_add_fetch(&t->posted[type], 1, __ATOMIC_RELEASE);
+		if (type == MSM_VIDC_INST_WORK_STATS)
+			mod_delayed_work(core.inst_workq,
+				&sessions[s]->stats_work, 0);
+		else
+			msm_vidc_queue_inst_work(sessions[s], type);
+	}
+
+	return NULL;
+}
+
+static void ordering(void)
+{
+	pthread_t post_t[POSTERS];
+	u32 lost = 0, s, type;
+	uintptr_t i;
+
+	printf("%d sessions, %d posters\n", SESSIONS, POSTERS);
+	for (s = 0; s < SESSIONS; s++) {
+		sessions[s] = msm_vidc_get_inst_shell(&core);
+		sessions[s]->core = &core;
+	}
+	tracking = true;
+
+	for (i = 0; i < POSTERS; i++)
+		pthread_create(&post_t[i], NULL, poster, (void *)(i + 1));
+	for (i = 0; i < POSTERS; i++)
+		pthread_join(post_t[i], NULL);
+	flush_workqueue(core.inst_workq);
+
+	for (s = 0; s < SESSIONS; s++)
+		for (type = 0; type <= MSM_VIDC_INST_WORK_STATS; type++)
+			lost += track[s].seen[type] != track[s].posted[type];
+	printf("  %d posts, %d overlapping passes, %d sessions in parallel, "
+		"%u unseen events\n", POSTERS * POSTS, overlaps, max_running,
+		lost);
+
+	CHECK(!overlaps, "work of one session overlapped");
+	CHECK(max_running > 1, "sessions were serialized against each other");
+	CHECK(!lost, "posted events never handled");
+
+	tracking = false;
+	for (s = 0; s < SESSIONS; s++) {
+		msm_vidc_cancel_inst_work(sessions[s]);
+		msm_vidc_free_inst_shell(sessions[s]);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	u32 cycles = 20000;
+
+	if (argc > 1)
+		cycles = max_t(u32, strtoul(argv[1], NULL, 0), 1);
+
+	core.inst_workq = alloc_workqueue("vidc_inst_workq",
+		WQ_UNBOUND | WQ_HIGHPRI, 0);
+	INIT_LIST_HEAD(&core.inst_cache);
+	spin_lock_init(&core.inst_cache_lock);
+	INIT_WORK(&core.inst_cache_work, msm_vidc_inst_cache_handler);
+
+	printf("open/close, %u cycles\n", cycles);
+	open_close(OPEN_WARM, cycles);
+	open_close(OPEN_COLD, cycles);
+	open_close(OPEN_SESSION_WORKQ, cycles);
+
+	ordering();
+
+	msm_vidc_inst_cache_deinit(&core);
+	destroy_workqueue(core.inst_workq);
+
+	if (failed)
+		printf("FAIL\n");
+
+	return failed;
+}
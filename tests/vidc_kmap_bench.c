@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Kernel mapping cost of internal buffers.
+ *
+ *   vidc_kmap_bench [repeat]
+ *
+ * Sizes the internal buffers of 4K decode sessions with the variant
+ * calculators and allocates them from a dummy device: a memfd whose pages
+ * are populated through one shared mapping, the device's view. A kernel
+ * mapping, as dma_alloc_attrs() builds without DMA_ATTR_NO_KERNEL_MAPPING,
+ * is a second populated mapping of the same pages. Compares mapping every
+ * internal buffer, as before, with msm_vidc_buffer_map_kernel(), and
+ * prints the mapped bytes and the allocation time of each.
+ *
+ * Exits non-zero when any internal buffer type still gets a kernel
+ * mapping or msm_vidc_mem_kvaddr() hands out the cookie of an unmapped
+ * allocation. Timings are informational.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "msm_vidc_driver.h"
+#include "msm_vidc_memory.h"
+#include "vidc_test_session.h"
+
+enum bench_policy {
+	BENCH_MAP_ALL,
+	BENCH_MAP_TABLE,
+};
+
+struct bench_result {
+	u64 mapped;
+	u64 total;
+	u64 ns;
+};
+
+static bool is_internal(enum msm_vidc_buffer_type type)
+{
+	return type >= MSM_VIDC_BUF_BIN;
+}
+
+/* dummy device: pages plus an optional second, kernel, mapping */
+static void alloc_free(u32 size, bool map_kernel)
+{
+	void *dev, *kva = NULL;
+	int fd;
+
+	fd = memfd_create("vidc", 0);
+	if (fd < 0 || ftruncate(fd, size)) {
+		perror("memfd");
+		exit(2);
+	}
+	dev = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, fd, 0);
+	if (map_kernel)
+		kva = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, 0);
+	if (dev == MAP_FAILED || kva == MAP_FAILED) {
+		perror("mmap");
+		exit(2);
+	}
+	if (kva)
+		munmap(kva, size);
+	munmap(dev, size);
+	close(fd);
+}
+
+static void run(enum bench_policy policy, struct vidc_test_session *s,
+	const struct vidc_test_config *cfg, u32 repeat,
+	struct bench_result *res)
+{
+	u64 start;
+	u32 i, k, r;
+
+	memset(res, 0, sizeof(*res));
+	start = ktime_get_ns();
+	for (r = 0; r < repeat; r++) {
+		for (i = 0; i < vidc_test_buf_type_count; i++) {
+			enum msm_vidc_buffer_type type = vidc_test_buf_types[i];
+			u32 size, count;
+			bool map;
+
+			if (!is_internal(type) ||
+			    !vidc_test_buf_applies(cfg, type))
+				continue;
+			size = ALIGN(cfg->variant->size(&s->inst, type), SZ_4K);
+			count = cfg->variant->min_count(&s->inst, type);
+			map = policy == BENCH_MAP_ALL ||
+				msm_vidc_buffer_map_kernel(type);
+			for (k = 0; k < count && size; k++) {
+				alloc_free(size, map);
+				if (r)
+					continue;
+				res->total += size;
+				res->mapped += map ? size : 0;
+			}
+		}
+	}
+	res->ns = (ktime_get_ns() - start) / repeat;
+}
+
+static int check_kvaddr(void)
+{
+	struct msm_vidc_mem mem = { .kvaddr = (void *)0x1000 };
+	int failed = 0;
+	u32 i;
+
+	for (i = 0; i < vidc_test_buf_type_count; i++) {
+		if (is_internal(vidc_test_buf_types[i]) &&
+		    msm_vidc_buffer_map_kernel(vidc_test_buf_types[i])) {
+			printf("%s gets a kernel mapping\n",
+				buf_name(vidc_test_buf_types[i]));
+			failed = 1;
+		}
+	}
+
+	mem.map_kernel = msm_vidc_buffer_map_kernel(MSM_VIDC_BUF_DPB);
+	if (msm_vidc_mem_kvaddr(&mem)) {
+		printf("unmapped kvaddr handed out\n");
+		failed = 1;
+	}
+	mem.map_kernel = msm_vidc_buffer_map_kernel(MSM_VIDC_BUF_INTERFACE_QUEUE);
+	if (msm_vidc_mem_kvaddr(&mem) != mem.kvaddr) {
+		printf("interface queue not mapped\n");
+		failed = 1;
+	}
+
+	return failed;
+}
+
+int main(int argc, char **argv)
+{
+	static const enum msm_vidc_codec_type codecs[] = {
+		MSM_VIDC_H264, MSM_VIDC_HEVC, MSM_VIDC_VP9, MSM_VIDC_AV1,
+	};
+	static struct vidc_test_session s;
+	struct bench_result res[2];
+	u32 repeat = 3, v, c;
+
+	if (argc > 1)
+		repeat = max_t(u32, strtoul(argv[1], NULL, 0), 1);
+
+	printf("%-8s %-5s %10s %12s %12s %10s %10s\n", "variant", "codec",
+		"internal", "mapped all", "mapped now", "ms all", "ms now");
+	for (v = 0; v < vidc_test_variant_count; v++) {
+		for (c = 0; c < ARRAY_SIZE(codecs); c++) {
+			struct vidc_test_config cfg = {
+				.variant = &vidc_test_variants[v],
+				.domain = MSM_VIDC_DECODER,
+				.codec = codecs[c],
+				.width = 3840,
+				.height = 2160,
+				.bitdepth = 8,
+				.pipes = 4,
+				.stage = MSM_VIDC_STAGE_2,
+			};
+
+			if (!(cfg.variant->codecs & cfg.codec))
+				continue;
+			vidc_test_session_init(&s, &cfg);
+			run(BENCH_MAP_ALL, &s, &cfg, repeat, &res[BENCH_MAP_ALL]);
+			run(BENCH_MAP_TABLE, &s, &cfg, repeat,
+				&res[BENCH_MAP_TABLE]);
+			printf("%-8s %-5s %9lluM %11lluM %11lluM %10.2f %10.2f\n",
+				cfg.variant->name, vidc_test_codec_name(cfg.codec),
+				res[0].total >> 20, res[0].mapped >> 20,
+				res[1].mapped >> 20, res[0].ns / 1e6,
+				res[1].ns / 1e6);
+		}
+	}
+
+	if (check_kvaddr()) {
+		printf("FAIL\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Input done fast path against qbuf and s_ctrl.
+ *
+ *   vidc_lock_stress
+ *
+ * One thread stands in for the input buffer done path in
+ * venus_hfi_response.c, which only takes buffer_lock(), and refills the
+ * input buffers' filled length through msm_vidc_update_input_size(). A
+ * second thread stands in for qbuf and msm_vidc_scale_power() under
+ * inst_lock() and checks msm_vidc_input_size() against a walk of the input
+ * list. A third one takes ctrl_lock() the way s_ctrl does and only touches
+ * the capabilities.
+ *
+ * Checks that no lockdep_assert_held() fires while the threads race, that
+ * the cached max never disagrees with the list, and that reading the max
+ * under ctrl_lock() alone does trip the assertion.
+ */
+
+#include <stdlib.h>
+
+#include "msm_vidc_inst.h"
+#include "msm_vidc_driver.h"
+#include "msm_vidc_power.h"
+
+#define INPUT_BUFFERS 32
+#define ITERATIONS    200000
+
+static struct msm_vidc_inst inst;
+static struct msm_vidc_buffer bufs[INPUT_BUFFERS];
+static volatile bool stop;
+static u32 mismatches, reads;
+
+static u32 next_size(unsigned int *seed)
+{
+	return rand_r(seed) % (4 << 20);
+}
+
+static void *input_done(void *arg)
+{
+	unsigned int seed = 1;
+	struct msm_vidc_buffer *buf;
+
+	while (!stop) {
+		buffer_lock(&inst, __func__);
+		buf = &bufs[rand_r(&seed) % INPUT_BUFFERS];
+		buf->data_size = next_size(&seed);
+		msm_vidc_update_input_size(&inst, buf);
+		buffer_unlock(&inst, __func__);
+	}
+
+	return NULL;
+}
+
+static void *s_ctrl(void *arg)
+{
+	unsigned int seed = 3;
+
+	while (!stop) {
+		ctrl_lock(&inst, __func__);
+		inst.capabilities[FRAME_RATE].value = rand_r(&seed);
+		ctrl_unlock(&inst, __func__);
+	}
+
+	return NULL;
+}
+
+static void qbuf(unsigned int *seed)
+{
+	struct msm_vidc_buffer *buf;
+	u32 max = 0;
+
+	inst_lock(&inst, __func__);
+	buf = &bufs[rand_r(seed) % INPUT_BUFFERS];
+	buf->data_size = next_size(seed);
+	msm_vidc_update_input_size(&inst, buf);
+
+	list_for_each_entry(buf, &inst.buffers.input.list, list)
+		max = max(max, buf->data_size);
+	if (msm_vidc_input_size(&inst) != max)
+		mismatches++;
+	reads++;
+	inst_unlock(&inst, __func__);
+}
+
+int main(void)
+{
+	pthread_t done_t, ctrl_t;
+	unsigned int seed = 2;
+	int failed = 0, i;
+
+	mutex_init(&inst.lock);
+	mutex_init(&inst.buffer_lock);
+	INIT_LIST_HEAD(&inst.buffers.input.list);
+	for (i = 0; i < INPUT_BUFFERS; i++) {
+		bufs[i].type = MSM_VIDC_BUF_INPUT;
+		bufs[i].index = i;
+		list_add_tail(&bufs[i].list, &inst.buffers.input.list);
+	}
+
+	pthread_create(&done_t, NULL, input_done, NULL);
+	pthread_create(&ctrl_t, NULL, s_ctrl, NULL);
+	for (i = 0; i < ITERATIONS; i++)
+		qbuf(&seed);
+	stop = true;
+	pthread_join(done_t, NULL);
+	pthread_join(ctrl_t, NULL);
+
+	printf("%u input size reads, %u mismatches, %d lockdep warnings\n",
+		reads, mismatches, lockdep_warnings);
+	if (mismatches || lockdep_warnings)
+		failed = 1;
+
+	/* s_ctrl must not read the buffer_lock protected fields */
+	ctrl_lock(&inst, __func__);
+	msm_vidc_input_size(&inst);
+	ctrl_unlock(&inst, __func__);
+	if (lockdep_warnings != 1) {
+		printf("read under ctrl_lock only not caught\n");
+		failed = 1;
+	}
+
+	if (failed)
+		printf("FAIL\n");
+
+	return failed;
+}
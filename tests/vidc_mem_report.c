@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Per-session memory report for a given session configuration.
+ *
+ *   vidc_mem_report <variant> <dec|enc> <codec> <WxH> [bitdepth] [pipes] [stage]
+ *                   [--budget-mb N]
+ *
+ * Internal buffers are counted at min_count, input/output at
+ * min_count + extra_count, which is what the driver allocates before the
+ * client asks for more. With --budget-mb the number of identical
+ * concurrent sessions that fit the budget is printed as well.
+ */
+
+#include <stdlib.h>
+
+#include "msm_vidc_driver.h"
+#include "vidc_test_session.h"
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s <iris2|iris3|iris33> <dec|enc> <h264|hevc|vp9|av1> <WxH>\n"
+		"          [bitdepth=8] [pipes=1] [stage=2] [--budget-mb N]\n", prog);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	static struct vidc_test_session s;
+	struct vidc_test_config cfg = {
+		.bitdepth = 8,
+		.pipes = 1,
+		.stage = MSM_VIDC_STAGE_2,
+	};
+	const char *pos[7];
+	u32 npos = 0, budget_mb = 0, i;
+	u64 total = 0;
+
+	for (i = 1; i < (u32)argc; i++) {
+		if (!strcmp(argv[i], "--budget-mb") && i + 1 < (u32)argc)
+			budget_mb = strtoul(argv[++i], NULL, 0);
+		else if (npos < ARRAY_SIZE(pos))
+			pos[npos++] = argv[i];
+		else
+			usage(argv[0]);
+	}
+	if (npos < 4)
+		usage(argv[0]);
+
+	cfg.variant = vidc_test_find_variant(pos[0]);
+	cfg.domain = !strcmp(pos[1], "dec") ? MSM_VIDC_DECODER : MSM_VIDC_ENCODER;
+	cfg.codec = vidc_test_codec_from_name(pos[2]);
+	if (!cfg.variant || !cfg.codec ||
+		sscanf(pos[3], "%ux%u", &cfg.width, &cfg.height) != 2)
+		usage(argv[0]);
+	if (npos > 4)
+		cfg.bitdepth = strtoul(pos[4], NULL, 0);
+	if (npos > 5)
+		cfg.pipes = strtoul(pos[5], NULL, 0);
+	if (npos > 6)
+		cfg.stage = strtoul(pos[6], NULL, 0);
+
+	vidc_test_session_init(&s, &cfg);
+
+	printf("%s %s %s %ux%u %u-bit, %u pipe(s), stage %u\n\n",
+		cfg.variant->name, vidc_test_domain_name(cfg.domain),
+		vidc_test_codec_name(cfg.codec), cfg.width, cfg.height,
+		cfg.bitdepth, cfg.pipes, cfg.stage);
+	printf("%-14s %12s %6s %14s\n", "buffer", "size", "count", "total");
+
+	for (i = 0; i < vidc_test_buf_type_count; i++) {
+		enum msm_vidc_buffer_type type = vidc_test_buf_types[i];
+		u32 size, count;
+
+		if (!vidc_test_buf_applies(&cfg, type))
+			continue;
+		size = cfg.variant->size(&s.inst, type);
+		count = cfg.variant->min_count(&s.inst, type);
+		if (type == MSM_VIDC_BUF_INPUT || type == MSM_VIDC_BUF_OUTPUT)
+			count += cfg.variant->extra_count(&s.inst, type);
+		if (!size || !count)
+			continue;
+
+		printf("%-14s %12u %6u %14llu\n", buf_name(type), size, count,
+			(u64)size * count);
+		total += (u64)size * count;
+	}
+
+	printf("\n%-14s %12s %6s %14llu (%.1f MiB)\n", "session", "", "",
+		total, total / (1024.0 * 1024.0));
+	if (budget_mb && total)
+		printf("%-14s %llu concurrent sessions in %u MiB\n", "fits",
+			((u64)budget_mb << 20) / total, budget_mb);
+
+	return 0;
+}
@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Request property arena growth.
+ *
+ *   vidc_pending_pkts_test
+ *
+ * Appends property packets to a pending arena the way
+ * venus_hfi_cache_packet() does, sizing it with
+ * msm_vidc_pending_pkts_capacity(), until the arena is full. Checks that
+ * the arena doubles from PENDING_PKTS_MIN_SIZE, that it never grows past
+ * PENDING_PKTS_MAX_SIZE, that the append that would cross it is refused
+ * with the arena left intact, and that the largest inst->packet this can
+ * lead to still fits in the command queue.
+ */
+
+#include <stdlib.h>
+
+#include "msm_vidc_internal.h"
+#include "venus_hfi_queue.h"
+
+static int failed;
+
+#define CHECK(cond, fmt, ...) \
+	do { \
+		if (!(cond)) { \
+			printf("  FAIL: " fmt "\n", ##__VA_ARGS__); \
+			failed = 1; \
+		} \
+	} while (0)
+
+struct arena {
+	u8 *data;
+	u32 size;
+	u32 capacity;
+	u32 grows;
+};
+
+/* mirrors venus_hfi_cache_packet() */
+static int append(struct arena *a, u32 payload_size, u8 fill)
+{
+	u32 capacity;
+	u8 *data;
+
+	capacity = msm_vidc_pending_pkts_capacity(a->capacity,
+		a->size + payload_size);
+	if (!capacity)
+		return -ENOMEM;
+	if (capacity > a->capacity) {
+		data = realloc(a->data, capacity);
+		if (!data)
+			return -ENOMEM;
+		a->data = data;
+		a->capacity = capacity;
+		a->grows++;
+	}
+	memset(a->data + a->size, fill, payload_size);
+	a->size += payload_size;
+
+	return 0;
+}
+
+static bool intact(const struct arena *a, const u32 *sizes, u32 count)
+{
+	u32 i, j, off = 0;
+
+	for (i = 0; i < count; i++)
+		for (j = 0; j < sizes[i]; j++)
+			if (a->data[off++] != (u8)i)
+				return false;
+
+	return off == a->size;
+}
+
+static void fill_to_max(void)
+{
+	/* hfi_packet plus a u32, u64 or small struct payload */
+	static const u32 prop_sizes[] = { 28, 32, 40, 56 };
+	static u32 sizes[PENDING_PKTS_MAX_SIZE / 28 + 1];
+	struct arena a = { 0 };
+	u32 count = 0, expect, size, last_capacity = 0;
+	int rc;
+
+	printf("fill with property packets\n");
+	for (;;) {
+		size = prop_sizes[count % ARRAY_SIZE(prop_sizes)];
+		rc = append(&a, size, count);
+		if (rc)
+			break;
+		if (a.capacity != last_capacity) {
+			expect = last_capacity ?
+				last_capacity * 2 : PENDING_PKTS_MIN_SIZE;
+			CHECK(a.capacity == expect,
+				"grew %u -> %u, expected %u",
+				last_capacity, a.capacity, expect);
+			last_capacity = a.capacity;
+		}
+		sizes[count++] = size;
+	}
+	printf("  %u packets, %u bytes, capacity %u after %u grows, rc %d\n",
+		count, a.size, a.capacity, a.grows, rc);
+
+	CHECK(rc == -ENOMEM, "append failed with %d", rc);
+	CHECK(a.capacity == PENDING_PKTS_MAX_SIZE, "capacity %u", a.capacity);
+	CHECK(a.size + size > PENDING_PKTS_MAX_SIZE,
+		"refused with %u bytes free", PENDING_PKTS_MAX_SIZE - a.size);
+	CHECK(intact(&a, sizes, count), "arena corrupted");
+
+	/* the next frame drains it and the same capacity is reused */
+	a.size = 0;
+	a.grows = 0;
+	CHECK(!append(&a, 32, 0) && !a.grows, "reuse regrew the arena");
+	free(a.data);
+}
+
+static void large_payload(void)
+{
+	struct arena a = { 0 };
+	int rc;
+
+	printf("single large payloads\n");
+	rc = append(&a, 5000, 0);
+	CHECK(!rc && a.capacity == 5000, "5000 bytes: rc %d capacity %u",
+		rc, a.capacity);
+	rc = append(&a, 20000, 1);
+	CHECK(!rc && a.capacity == 25000, "25000 bytes: rc %d capacity %u",
+		rc, a.capacity);
+	rc = append(&a, PENDING_PKTS_MAX_SIZE, 2);
+	CHECK(rc == -ENOMEM && a.capacity == 25000,
+		"oversized payload: rc %d capacity %u", rc, a.capacity);
+	free(a.data);
+
+	CHECK(!msm_vidc_pending_pkts_capacity(0, U32_MAX),
+		"U32_MAX accepted");
+}
+
+int main(void)
+{
+	fill_to_max();
+	large_payload();
+
+	CHECK(PENDING_PKTS_MAX_SIZE + MSM_VIDC_SESSION_PACKET_SIZE <=
+		VIDC_IFACEQ_QUEUE_SIZE,
+		"largest inst->packet does not fit the command queue");
+
+	if (failed)
+		printf("FAIL\n");
+
+	return failed;
+}
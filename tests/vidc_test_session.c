@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Userspace session fixture for the buffer calculators.
+ */
+
+#include "v4l2_vidc_extensions.h"
+#include "msm_vidc_buffer_iris2.h"
+#include "msm_vidc_buffer_iris3.h"
+#include "msm_vidc_buffer_iris33.h"
+#include "hfi_property.h"
+#include "vidc_test_session.h"
+
+#define DEC_CODECS_IRIS2 (MSM_VIDC_H264 | MSM_VIDC_HEVC | MSM_VIDC_VP9)
+#define DEC_CODECS_IRIS3 (DEC_CODECS_IRIS2 | MSM_VIDC_AV1)
+
+const struct vidc_test_variant vidc_test_variants[] = {
+	{ "iris2",  DEC_CODECS_IRIS2, false, msm_buffer_size_iris2,
+		msm_buffer_min_count_iris2, msm_buffer_extra_count_iris2 },
+	{ "iris3",  DEC_CODECS_IRIS3, true, msm_buffer_size_iris3,
+		msm_buffer_min_count_iris3, msm_buffer_extra_count_iris3 },
+	{ "iris33", DEC_CODECS_IRIS3, true, msm_buffer_size_iris33,
+		msm_buffer_min_count_iris33, msm_buffer_extra_count_iris33 },
+};
+const u32 vidc_test_variant_count = ARRAY_SIZE(vidc_test_variants);
+
+const enum msm_vidc_buffer_type vidc_test_buf_types[] = {
+	MSM_VIDC_BUF_INPUT,
+	MSM_VIDC_BUF_OUTPUT,
+	MSM_VIDC_BUF_BIN,
+	MSM_VIDC_BUF_COMV,
+	MSM_VIDC_BUF_NON_COMV,
+	MSM_VIDC_BUF_LINE,
+	MSM_VIDC_BUF_PERSIST,
+	MSM_VIDC_BUF_DPB,
+	MSM_VIDC_BUF_ARP,
+	MSM_VIDC_BUF_VPSS,
+	MSM_VIDC_BUF_PARTIAL_DATA,
+};
+const u32 vidc_test_buf_type_count = ARRAY_SIZE(vidc_test_buf_types);
+
+/* mirrors the sa8775p/qcs8300 format tables */
+static struct codec_info test_codec_info[] = {
+	{ V4L2_PIX_FMT_H264, MSM_VIDC_H264, "AVC"  },
+	{ V4L2_PIX_FMT_HEVC, MSM_VIDC_HEVC, "HEVC" },
+	{ V4L2_PIX_FMT_VP9,  MSM_VIDC_VP9,  "VP9"  },
+	{ V4L2_PIX_FMT_AV1,  MSM_VIDC_AV1,  "AV1"  },
+};
+
+static struct color_format_info test_color_format_info[] = {
+	{ V4L2_PIX_FMT_NV12,   MSM_VIDC_FMT_NV12,     "NV12"  },
+	{ V4L2_PIX_FMT_NV21,   MSM_VIDC_FMT_NV21,     "NV21"  },
+	{ V4L2_PIX_FMT_QC08C,  MSM_VIDC_FMT_NV12C,    "NV12C" },
+	{ V4L2_PIX_FMT_QC10C,  MSM_VIDC_FMT_TP10C,    "TP10C" },
+	{ V4L2_PIX_FMT_RGBA32, MSM_VIDC_FMT_RGBA8888, "RGBA"  },
+	{ V4L2_PIX_FMT_P010,   MSM_VIDC_FMT_P010,     "P010"  },
+};
+
+static struct msm_vidc_format_capability test_format_data = {
+	.codec_info = test_codec_info,
+	.codec_info_size = ARRAY_SIZE(test_codec_info),
+	.color_format_info = test_color_format_info,
+	.color_format_info_size = ARRAY_SIZE(test_color_format_info),
+};
+
+static const char * const codec_names[] = {
+	"h264", "hevc", "vp9", "heic", "av1",
+};
+
+/* the internal buffer types msm_vdec.c/msm_venc.c actually allocate */
+bool vidc_test_buf_applies(const struct vidc_test_config *cfg,
+	enum msm_vidc_buffer_type type)
+{
+	switch (type) {
+	case MSM_VIDC_BUF_ARP:
+	case MSM_VIDC_BUF_VPSS:
+		return cfg->domain == MSM_VIDC_ENCODER;
+	case MSM_VIDC_BUF_PERSIST:
+		return cfg->domain == MSM_VIDC_DECODER;
+	case MSM_VIDC_BUF_PARTIAL_DATA:
+		return cfg->domain == MSM_VIDC_DECODER &&
+			cfg->variant->partial_data;
+	default:
+		return true;
+	}
+}
+
+const struct vidc_test_variant *vidc_test_find_variant(const char *name)
+{
+	u32 i;
+
+	for (i = 0; i < vidc_test_variant_count; i++) {
+		if (!strcmp(vidc_test_variants[i].name, name))
+			return &vidc_test_variants[i];
+	}
+	return NULL;
+}
+
+const char *vidc_test_codec_name(enum msm_vidc_codec_type codec)
+{
+	u32 i;
+
+	for (i = 0; i < ARRAY_SIZE(codec_names); i++) {
+		if (codec == BIT(i))
+			return codec_names[i];
+	}
+	return "unknown";
+}
+
+enum msm_vidc_codec_type vidc_test_codec_from_name(const char *name)
+{
+	u32 i;
+
+	for (i = 0; i < ARRAY_SIZE(codec_names); i++) {
+		if (!strcmp(codec_names[i], name))
+			return BIT(i);
+	}
+	return 0;
+}
+
+const char *vidc_test_domain_name(enum msm_vidc_domain_type domain)
+{
+	return domain == MSM_VIDC_DECODER ? "dec" : "enc";
+}
+
+static u32 test_v4l2_codec(enum msm_vidc_codec_type codec)
+{
+	u32 i;
+
+	for (i = 0; i < ARRAY_SIZE(test_codec_info); i++) {
+		if (test_codec_info[i].vidc_codec == codec)
+			return test_codec_info[i].v4l2_codec;
+	}
+	return 0;
+}
+
+static void test_set_fmt(struct v4l2_format *f, u32 pixelformat,
+	u32 width, u32 height)
+{
+	f->fmt.pix_mp.pixelformat = pixelformat;
+	f->fmt.pix_mp.width = width;
+	f->fmt.pix_mp.height = height;
+}
+
+void vidc_test_session_init(struct vidc_test_session *s,
+	const struct vidc_test_config *cfg)
+{
+	struct msm_vidc_core *core = &s->core;
+	struct msm_vidc_inst *inst = &s->inst;
+	struct msm_vidc_inst_cap_state *caps = inst->capabilities;
+	u32 v4l2_codec, v4l2_raw;
+	bool tenbit = cfg->bitdepth == 10;
+
+	memset(s, 0, sizeof(*s));
+
+	s->platform.data.format_data = &test_format_data;
+	core->platform = &s->platform;
+	core->capabilities[NUM_VPP_PIPE].value = cfg->pipes;
+	core->capabilities[DCVS].value = 1;
+	INIT_LIST_HEAD(&core->instances);
+
+	inst->core = core;
+	inst->domain = cfg->domain;
+	inst->codec = cfg->codec;
+	inst->crop.width = cfg->width;
+	inst->crop.height = cfg->height;
+	inst->hfi_rc_type = HFI_RC_VBR_CFR;
+	inst->hfi_layer_type = HFI_HIER_P_SLIDING_WINDOW;
+	list_add_tail(&inst->list, &core->instances);
+
+	v4l2_codec = test_v4l2_codec(cfg->codec);
+	v4l2_raw = tenbit ? V4L2_PIX_FMT_QC10C : V4L2_PIX_FMT_QC08C;
+	if (cfg->domain == MSM_VIDC_DECODER) {
+		test_set_fmt(&inst->fmts[INPUT_PORT], v4l2_codec,
+			cfg->width, cfg->height);
+		test_set_fmt(&inst->fmts[OUTPUT_PORT], v4l2_raw,
+			cfg->width, cfg->height);
+	} else {
+		test_set_fmt(&inst->fmts[INPUT_PORT], v4l2_raw,
+			cfg->width, cfg->height);
+		test_set_fmt(&inst->fmts[OUTPUT_PORT], v4l2_codec,
+			cfg->width, cfg->height);
+	}
+
+	caps[PIX_FMTS].value = tenbit ? MSM_VIDC_FMT_TP10C : MSM_VIDC_FMT_NV12C;
+	caps[STAGE].value = cfg->stage;
+	caps[PIPE].value = cfg->pipes;
+	caps[CODED_FRAMES].value = CODED_FRAMES_PROGRESSIVE;
+	caps[FRAME_WIDTH].max = 8192;
+	caps[FRAME_HEIGHT].max = 8192;
+	caps[MBPF].value = NUM_MBS_PER_FRAME(4352, 8192);
+	caps[BITRATE_MODE].value = V4L2_MPEG_VIDEO_BITRATE_MODE_VBR;
+	caps[FRAME_RC_ENABLE].value = 1;
+	caps[BLUR_TYPES].value = MSM_VIDC_BLUR_NONE;
+	if (cfg->codec == MSM_VIDC_H264)
+		caps[PROFILE].value = V4L2_MPEG_VIDEO_H264_PROFILE_HIGH;
+	else if (cfg->codec == MSM_VIDC_HEVC)
+		caps[PROFILE].value = tenbit ?
+			V4L2_MPEG_VIDEO_HEVC_PROFILE_MAIN_10 :
+			V4L2_MPEG_VIDEO_HEVC_PROFILE_MAIN;
+
+	/* the driver derives the counts before it asks for sizes */
+	inst->fw_min_count = cfg->fw_min_count;
+	inst->buffers.input.min_count =
+		cfg->variant->min_count(inst, MSM_VIDC_BUF_INPUT);
+	inst->buffers.output.min_count =
+		cfg->variant->min_count(inst, MSM_VIDC_BUF_OUTPUT);
+}
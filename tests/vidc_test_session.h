@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Userspace session fixture for the buffer calculators: a core and an
+ * instance populated the way the driver does it after S_FMT and
+ * streamon, without firmware.
+ */
+
+#ifndef _VIDC_TEST_SESSION_H_
+#define _VIDC_TEST_SESSION_H_
+
+#include "msm_vidc_internal.h"
+#include "msm_vidc_inst.h"
+#include "msm_vidc_core.h"
+#include "msm_vidc_platform.h"
+
+struct vidc_test_variant {
+	const char *name;
+	u32 codecs;
+	bool partial_data;
+	int (*size)(struct msm_vidc_inst *inst,
+		enum msm_vidc_buffer_type buffer_type);
+	int (*min_count)(struct msm_vidc_inst *inst,
+		enum msm_vidc_buffer_type buffer_type);
+	int (*extra_count)(struct msm_vidc_inst *inst,
+		enum msm_vidc_buffer_type buffer_type);
+};
+
+struct vidc_test_config {
+	const struct vidc_test_variant *variant;
+	enum msm_vidc_domain_type domain;
+	enum msm_vidc_codec_type codec;
+	u32 width;
+	u32 height;
+	u32 bitdepth;
+	u32 pipes;
+	enum msm_vidc_stage_type stage;
+	/* decoder only, 0 until the firmware subscription arrives */
+	u32 fw_min_count;
+};
+
+struct vidc_test_session {
+	struct msm_vidc_core core;
+	struct msm_vidc_inst inst;
+	struct msm_vidc_platform platform;
+};
+
+extern const struct vidc_test_variant vidc_test_variants[];
+extern const u32 vidc_test_variant_count;
+
+/* buffer types reported by the tests, in column order */
+extern const enum msm_vidc_buffer_type vidc_test_buf_types[];
+extern const u32 vidc_test_buf_type_count;
+
+bool vidc_test_buf_applies(const struct vidc_test_config *cfg,
+	enum msm_vidc_buffer_type type);
+const struct vidc_test_variant *vidc_test_find_variant(const char *name);
+const char *vidc_test_codec_name(enum msm_vidc_codec_type codec);
+enum msm_vidc_codec_type vidc_test_codec_from_name(const char *name);
+const char *vidc_test_domain_name(enum msm_vidc_domain_type domain);
+
+void vidc_test_session_init(struct vidc_test_session *s,
+	const struct vidc_test_config *cfg);
+
+#endif /* _VIDC_TEST_SESSION_H_ */
@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Out-of-line driver and platform helpers the buffer calculators and the
+ * control paths link against. These mirror vidc/src/msm_vidc_driver.c and
+ * platform/common/src/msm_vidc_platform.c; keep them in sync when the
+ * originals change.
+ */
+
+#include "msm_vidc_internal.h"
+#include "msm_vidc_inst.h"
+#include "msm_vidc_core.h"
+#include "msm_vidc_driver.h"
+#include "msm_vidc_platform.h"
+#include "msm_vidc_debug.h"
+#include "hfi_property.h"
+
+unsigned int msm_vidc_debug = VIDC_ERR;
+int lockdep_warnings;
+
+DEFINE_STATIC_KEY_TRUE(msm_vidc_log_err);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_high);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_low);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_perf);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_pkt);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_bus);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_stat);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_buf_trace);
+
+static const char * const cap_name_arr[] =
+	FOREACH_CAP(GENERATE_STRING);
+
+const char *cap_name(enum msm_vidc_inst_capability_type cap_id)
+{
+	const char *name = "UNKNOWN CAP";
+
+	if (cap_id >= ARRAY_SIZE(cap_name_arr))
+		goto exit;
+
+	name = cap_name_arr[cap_id];
+
+exit:
+	return name;
+}
+
+static const char * const buf_type_name_arr[] =
+	FOREACH_BUF_TYPE(GENERATE_STRING);
+
+const char *buf_name(enum msm_vidc_buffer_type type)
+{
+	const char *name = "UNKNOWN BUF";
+
+	if (type >= ARRAY_SIZE(buf_type_name_arr))
+		goto exit;
+
+	name = buf_type_name_arr[type];
+
+exit:
+	return name;
+}
+
+bool res_is_greater_than(u32 width, u32 height,
+	u32 ref_width, u32 ref_height)
+{
+	u32 num_mbs = NUM_MBS_PER_FRAME(height, width);
+	u32 max_side = max(ref_width, ref_height);
+
+	if (num_mbs > NUM_MBS_PER_FRAME(ref_height, ref_width) ||
+		width > max_side ||
+		height > max_side)
+		return true;
+	else
+		return false;
+}
+
+bool res_is_less_than_or_equal_to(u32 width, u32 height,
+	u32 ref_width, u32 ref_height)
+{
+	u32 num_mbs = NUM_MBS_PER_FRAME(height, width);
+	u32 max_side = max(ref_width, ref_height);
+
+	if (num_mbs <= NUM_MBS_PER_FRAME(ref_height, ref_width) &&
+		width <= max_side &&
+		height <= max_side)
+		return true;
+	else
+		return false;
+}
+
+int msm_vidc_get_mbs_per_frame(struct msm_vidc_inst *inst)
+{
+	int height = 0, width = 0;
+	struct v4l2_format *inp_f;
+
+	if (is_decode_session(inst)) {
+		inp_f = &inst->fmts[INPUT_PORT];
+		width = max(inp_f->fmt.pix_mp.width, inst->crop.width);
+		height = max(inp_f->fmt.pix_mp.height, inst->crop.height);
+	} else if (is_encode_session(inst)) {
+		width = inst->crop.width;
+		height = inst->crop.height;
+	}
+
+	return NUM_MBS_PER_FRAME(height, width);
+}
+
+enum msm_vidc_codec_type v4l2_codec_to_driver(struct msm_vidc_inst *inst,
+	u32 v4l2_codec, const char *func)
+{
+	struct msm_vidc_core *core;
+	const struct codec_info *codec_info;
+	u32 i, size;
+	enum msm_vidc_codec_type codec = 0;
+
+	core = inst->core;
+	codec_info = core->platform->data.format_data->codec_info;
+	size = core->platform->data.format_data->codec_info_size;
+
+	for (i = 0; i < size; i++) {
+		if (codec_info[i].v4l2_codec == v4l2_codec)
+			return codec_info[i].vidc_codec;
+	}
+
+	d_vpr_h("%s: invalid v4l2 codec %#x\n", func, v4l2_codec);
+	return codec;
+}
+
+enum msm_vidc_colorformat_type v4l2_colorformat_to_driver(
+	struct msm_vidc_inst *inst,
+	u32 v4l2_colorformat, const char *func)
+{
+	struct msm_vidc_core *core;
+	const struct color_format_info *color_format_info;
+	u32 i, size;
+	enum msm_vidc_colorformat_type colorformat = 0;
+
+	core = inst->core;
+	color_format_info = core->platform->data.format_data->color_format_info;
+	size = core->platform->data.format_data->color_format_info_size;
+
+	for (i = 0; i < size; i++) {
+		if (color_format_info[i].v4l2_color_format == v4l2_colorformat)
+			return color_format_info[i].vidc_color_format;
+	}
+
+	d_vpr_e("%s: invalid v4l2 color format %#x\n", func, v4l2_colorformat);
+	return colorformat;
+}
+
+enum msm_vidc_inst_capability_type msm_vidc_get_cap_id(struct msm_vidc_inst *inst, u32 id)
+{
+	if (!inst->codec_caps)
+		return INST_CAP_NONE;
+
+	return msm_vidc_cid_map_lookup(inst->codec_caps, id);
+}
+
+/* the calculators only ever adjust plain (non-metadata) caps */
+int msm_vidc_update_cap_value(struct msm_vidc_inst *inst, u32 cap_id,
+			      s32 adjusted_val, const char *func)
+{
+	inst->capabilities[cap_id].value = adjusted_val;
+	return 0;
+}
+
+/* ROTATION is the only cap the calculators translate */
+int msm_vidc_v4l2_to_hfi_enum(struct msm_vidc_inst *inst,
+			      enum msm_vidc_inst_capability_type cap_id, u32 *value)
+{
+	if (cap_id != ROTATION)
+		return -EINVAL;
+
+	switch (inst->capabilities[cap_id].value) {
+	case 90:
+		*value = HFI_ROTATION_90;
+		break;
+	case 180:
+		*value = HFI_ROTATION_180;
+		break;
+	case 270:
+		*value = HFI_ROTATION_270;
+		break;
+	default:
+		*value = HFI_ROTATION_NONE;
+		break;
+	}
+	return 0;
+}
+
+void inst_lock(struct msm_vidc_inst *inst, const char *function)
+{
+	mutex_lock(&inst->lock);
+	mutex_lock(&inst->buffer_lock);
+}
+
+void inst_unlock(struct msm_vidc_inst *inst, const char *function)
+{
+	mutex_unlock(&inst->buffer_lock);
+	mutex_unlock(&inst->lock);
+}
+
+void ctrl_lock(struct msm_vidc_inst *inst, const char *function)
+{
+	mutex_lock(&inst->lock);
+}
+
+void ctrl_unlock(struct msm_vidc_inst *inst, const char *function)
+{
+	mutex_unlock(&inst->lock);
+}
+
+void buffer_lock(struct msm_vidc_inst *inst, const char *function)
+{
+	mutex_lock(&inst->buffer_lock);
+}
+
+void buffer_unlock(struct msm_vidc_inst *inst, const char *function)
+{
+	mutex_unlock(&inst->buffer_lock);
+}
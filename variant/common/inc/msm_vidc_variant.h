@@ -10,6 +10,10 @@
 #include <linux/types.h>
 
 struct msm_vidc_core;
+struct msm_vidc_inst;
+struct api_calculation_input;
+struct api_calculation_freq_output;
+struct api_calculation_bw_output;
 
 int __write_register_masked(struct msm_vidc_core *core, u32 reg, u32 value,
 		u32 mask);
@@ -18,5 +22,11 @@ int __read_register(struct msm_vidc_core *core, u32 reg, u32 *value);
 int __read_register_with_poll_timeout(struct msm_vidc_core *core, u32 reg,
 		u32 mask, u32 exp_val, u32 sleep_us, u32 timeout_us);
 int __set_registers(struct msm_vidc_core *core);
+int msm_vidc_calculate_frequency_cached(struct msm_vidc_inst *inst,
+		struct api_calculation_input *codec_input,
+		struct api_calculation_freq_output *codec_output);
+int msm_vidc_calculate_bandwidth_cached(struct msm_vidc_inst *inst,
+		struct api_calculation_input *codec_input,
+		struct api_calculation_bw_output *codec_output);
 
 #endif
@@ -8,6 +8,7 @@
 #include <linux/iopoll.h>
 
 #include "msm_vidc_core.h"
+#include "msm_vidc_inst.h"
 #include "msm_vidc_driver.h"
 #include "msm_vidc_state.h"
 #include "msm_vidc_debug.h"
@@ -159,3 +160,62 @@ int __set_registers(struct msm_vidc_core *core)
 
 	return rc;
 }
+
+/*
+ * evaluate the static perf model only when its input changed since the
+ * last call; bitrate is quantized to Mbps in the input so small filled
+ * length variations between frames still hit the cached result
+ */
+int msm_vidc_calculate_frequency_cached(struct msm_vidc_inst *inst,
+	struct api_calculation_input *codec_input,
+	struct api_calculation_freq_output *codec_output)
+{
+	struct msm_vidc_power_cache *cache = &inst->power_cache;
+	int ret = 0;
+
+	if (cache->freq_valid &&
+		!memcmp(&cache->freq_input, codec_input, sizeof(*codec_input))) {
+		cache->freq_hits++;
+		*codec_output = cache->freq_output;
+		return 0;
+	}
+
+	cache->freq_evals++;
+	cache->freq_valid = false;
+	ret = msm_vidc_calculate_frequency(*codec_input, codec_output);
+	if (ret)
+		return ret;
+
+	cache->freq_input = *codec_input;
+	cache->freq_output = *codec_output;
+	cache->freq_valid = true;
+
+	return 0;
+}
+
+int msm_vidc_calculate_bandwidth_cached(struct msm_vidc_inst *inst,
+	struct api_calculation_input *codec_input,
+	struct api_calculation_bw_output *codec_output)
+{
+	struct msm_vidc_power_cache *cache = &inst->power_cache;
+	int ret = 0;
+
+	if (cache->bw_valid &&
+		!memcmp(&cache->bw_input, codec_input, sizeof(*codec_input))) {
+		cache->bw_hits++;
+		*codec_output = cache->bw_output;
+		return 0;
+	}
+
+	cache->bw_evals++;
+	cache->bw_valid = false;
+	ret = msm_vidc_calculate_bandwidth(*codec_input, codec_output);
+	if (ret)
+		return ret;
+
+	cache->bw_input = *codec_input;
+	cache->bw_output = *codec_output;
+	cache->bw_valid = true;
+
+	return 0;
+}
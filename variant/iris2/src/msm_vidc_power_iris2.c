@@ -346,7 +346,7 @@ static u64 __calculate_decoder(struct vidc_bus_vote_data *d)
 	}
 
 	/* Dump all the variables for easier debugging */
-	if (msm_vidc_debug & VIDC_BUS) {
+	if (msm_vidc_log_on(VIDC_BUS)) {
 		struct dump dump[] = {
 		{"DECODER PARAMETERS", "", DUMP_HEADER_MAGIC},
 		{"lcu size", "%d", lcu_size},
@@ -609,7 +609,7 @@ static u64 __calculate_encoder(struct vidc_bus_vote_data *d)
 	ddr.total = fp_mult(ddr.total, qsmmu_bw_overhead_factor);
 	llc.total = llc.ref_read_crcb + llc.line_buffer + ddr.total;
 
-	if (msm_vidc_debug & VIDC_BUS) {
+	if (msm_vidc_log_on(VIDC_BUS)) {
 		struct dump dump[] = {
 		{"ENCODER PARAMETERS", "", DUMP_HEADER_MAGIC},
 		{"width", "%d", width},
@@ -695,12 +695,28 @@ static u64 __calculate(struct msm_vidc_inst *inst, struct vidc_bus_vote_data *d)
 int msm_vidc_calc_bw_iris2(struct msm_vidc_inst *inst,
 		struct vidc_bus_vote_data *vidc_data)
 {
+	struct msm_vidc_power_cache *cache = &inst->power_cache;
+	struct vidc_bus_vote_data key;
 	int value = 0;
 
 	if (!vidc_data)
 		return value;
 
+	/* bus model is a pure function of the vote data, skip it if unchanged */
+	memcpy(&key, vidc_data, sizeof(key));
+	key.calc_bw_ddr = cache->bus_vote.calc_bw_ddr;
+	key.calc_bw_llcc = cache->bus_vote.calc_bw_llcc;
+	if (cache->bus_valid && !memcmp(&key, &cache->bus_vote, sizeof(key))) {
+		cache->bw_hits++;
+		vidc_data->calc_bw_ddr = cache->bus_vote.calc_bw_ddr;
+		vidc_data->calc_bw_llcc = cache->bus_vote.calc_bw_llcc;
+		return value;
+	}
+
+	cache->bw_evals++;
 	value = __calculate(inst, vidc_data);
+	memcpy(&cache->bus_vote, vidc_data, sizeof(cache->bus_vote));
+	cache->bus_valid = true;
 
 	return value;
 }
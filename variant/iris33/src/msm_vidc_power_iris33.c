@@ -12,6 +12,7 @@
 #include "msm_vidc_debug.h"
 #include "perf_static_model.h"
 #include "msm_vidc_power.h"
+#include "msm_vidc_variant.h"
 
 #define VPP_MIN_FREQ_MARGIN_PERCENT                   5 /* to be tuned */
 
@@ -331,7 +332,7 @@ static int msm_vidc_init_codec_input_bus(struct msm_vidc_inst *inst, struct vidc
 	codec_input->vpu_ver = core->platform->data.vpu_ver;
 
 	/* Dump all the variables for easier debugging */
-	if (msm_vidc_debug & VIDC_BUS) {
+	if (msm_vidc_log_on(VIDC_BUS)) {
 		struct dump dump[] = {
 		{"complexity_factor_int", "%d", complexity_factor_int},
 		{"complexity_factor_frac", "%d", complexity_factor_frac},
@@ -434,7 +435,8 @@ static u64 msm_vidc_calc_freq_iris33_new(struct msm_vidc_inst *inst, u32 data_si
 	ret = msm_vidc_init_codec_input_freq(inst, data_size, &codec_input);
 	if (ret)
 		return freq;
-	ret = msm_vidc_calculate_frequency(codec_input, &codec_output);
+	ret = msm_vidc_calculate_frequency_cached(inst, &codec_input,
+		&codec_output);
 	if (ret)
 		return freq;
 
@@ -499,7 +501,8 @@ static int msm_vidc_calc_bw_iris33_new(struct msm_vidc_inst *inst,
 	ret = msm_vidc_init_codec_input_bus(inst, vidc_data, &codec_input);
 	if (ret)
 		return ret;
-	ret = msm_vidc_calculate_bandwidth(codec_input, &codec_output);
+	ret = msm_vidc_calculate_bandwidth_cached(inst, &codec_input,
+		&codec_output);
 	if (ret)
 		return ret;
 
@@ -950,7 +953,7 @@ static u64 __calculate_decoder(struct vidc_bus_vote_data *d)
 	}
 
 	/* Dump all the variables for easier debugging */
-	if (msm_vidc_debug & VIDC_BUS) {
+	if (msm_vidc_log_on(VIDC_BUS)) {
 		struct dump dump[] = {
 		{"DECODER PARAMETERS", "", DUMP_HEADER_MAGIC},
 		{"lcu size", "%d", lcu_size},
@@ -1223,7 +1226,7 @@ static u64 __calculate_encoder(struct vidc_bus_vote_data *d)
 	ddr.total = fp_mult(ddr.total, qsmmu_bw_overhead_factor);
 	llc.total = llc.ref_read_crcb + llc.line_buffer + ddr.total;
 
-	if (msm_vidc_debug & VIDC_BUS) {
+	if (msm_vidc_log_on(VIDC_BUS)) {
 		struct dump dump[] = {
 		{"ENCODER PARAMETERS", "", DUMP_HEADER_MAGIC},
 		{"width", "%d", width},
@@ -1346,7 +1349,8 @@ int msm_vidc_ring_buf_count_iris33(struct msm_vidc_inst *inst, u32 data_size)
 	rc = msm_vidc_init_codec_input_freq(inst, data_size, &codec_input);
 	if (rc)
 		return rc;
-	rc = msm_vidc_calculate_frequency(codec_input, &codec_output);
+	rc = msm_vidc_calculate_frequency_cached(inst, &codec_input,
+		&codec_output);
 	if (rc)
 		return rc;
 
@@ -30,6 +30,7 @@ int msm_vdec_input_port_settings_change(struct msm_vidc_inst *inst);
 int msm_vdec_output_port_settings_change(struct msm_vidc_inst *inst);
 int msm_vdec_stop_cmd(struct msm_vidc_inst *inst);
 int msm_vdec_start_cmd(struct msm_vidc_inst *inst);
+void msm_vdec_update_dpb_slots(struct msm_vidc_inst *inst);
 int msm_vdec_handle_release_buffer(struct msm_vidc_inst *inst,
 				   struct msm_vidc_buffer *buf);
 int msm_vdec_set_num_comv(struct msm_vidc_inst *inst);
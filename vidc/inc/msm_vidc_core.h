@@ -15,6 +15,7 @@
 #include "resources.h"
 
 struct msm_vidc_core;
+struct thermal_cooling_device;
 
 #define MAX_EVENTS   30
 
@@ -59,6 +60,25 @@ struct msm_video_device {
 	struct v4l2_m2m_dev                   *m2m_dev;
 };
 
+#define VIDC_PC_IDLE_HISTORY 8
+
+struct msm_vidc_pc_stats {
+	u64 last_activity_ns;
+	u64 collapse_ns;
+	u64 idle_history[VIDC_PC_IDLE_HISTORY];
+	u32 idle_index;
+	u32 idle_samples;
+	u64 predicted_idle_ns;
+	u64 actual_idle_ns;
+	u64 collapsed_ns;
+	u64 collapsed_start_ns; /* current collapse, not yet in collapsed_ns */
+	u64 resume_cost_ns;
+	u32 delay_ms;
+	u32 collapse_count;
+	u32 resume_count;
+	u32 early_resume_count;
+};
+
 struct msm_vidc_core_power {
 	u64 clk_freq;
 	u64 bw_ddr;
@@ -100,16 +120,31 @@ struct msm_vidc_core {
 	struct msm_vidc_iface_q_info           iface_queues[VIDC_IFACEQ_NUMQ];
 	struct delayed_work                    pm_work;
 	struct workqueue_struct               *pm_workq;
+	struct work_struct                     clk_work;
+	u64                                    clk_req_freq; /* clk_req_lock */
+	spinlock_t                             clk_req_lock;
+	struct thermal_cooling_device         *cdev;
+	unsigned long                          thermal_state;
 	struct workqueue_struct               *batch_workq;
+	struct workqueue_struct               *inst_workq;
+	struct list_head                       inst_cache; /* struct msm_vidc_inst */
+	u32                                    inst_cache_count;
+	spinlock_t                             inst_cache_lock;
+	struct work_struct                     inst_cache_work;
 	struct delayed_work                    fw_unload_work;
+	struct work_struct                     init_work;
+	struct completion                      init_done;
+	bool                                   fw_booting;
 	struct work_struct                     ssr_work;
 	struct msm_vidc_core_power             power;
 	struct msm_vidc_ssr                    ssr;
 	u32                                    skip_pc_count;
+	struct msm_vidc_pc_stats               pc_stats;
 	u32                                    last_packet_type;
 	u8                                    *packet;
 	u32                                    packet_size;
 	u8                                    *response_packet;
+	struct msm_vidc_hfi_dispatch           response_dispatch;
 	struct v4l2_file_operations           *v4l2_file_ops;
 	struct v4l2_ioctl_ops                 *v4l2_ioctl_ops_enc;
 	struct v4l2_ioctl_ops                 *v4l2_ioctl_ops_dec;
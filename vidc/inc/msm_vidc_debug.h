@@ -13,6 +13,7 @@
 #include <linux/delay.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
+#include <linux/jump_label.h>
 
 struct msm_vidc_core;
 struct msm_vidc_inst;
@@ -44,6 +45,13 @@ extern int msm_vidc_llc_bw;
 extern bool msm_vidc_fw_dump;
 extern unsigned int msm_vidc_enable_bugon;
 extern bool msm_vidc_synx_fence_enable;
+extern bool msm_vidc_adaptive_pc;
+extern unsigned int msm_vidc_dcvs_policy;
+extern unsigned int msm_vidc_dcvs_headroom;
+extern unsigned int msm_vidc_dcvs_hysteresis;
+extern unsigned int msm_vidc_clock_aggregation;
+extern unsigned int msm_vidc_edf_margin;
+extern unsigned int msm_vidc_bw_half_life_ms;
 
 /* do not modify the log message as it is used in test scripts */
 #define FMT_STRING_SET_CTRL \
@@ -102,8 +110,36 @@ enum vidc_msg_prio_fw {
 #define FW_LOGSHIFT    (0)
 #define FW_LOGMASK     (0x0FFFFFFF)
 
+/*
+ * Each driver log level is backed by a static key kept in sync with
+ * msm_vidc_debug by the module parameter, so disabled levels cost a
+ * patched-out branch instead of a load and test on every call.
+ */
+DECLARE_STATIC_KEY_TRUE(msm_vidc_log_err);
+DECLARE_STATIC_KEY_FALSE(msm_vidc_log_high);
+DECLARE_STATIC_KEY_FALSE(msm_vidc_log_low);
+DECLARE_STATIC_KEY_FALSE(msm_vidc_log_perf);
+DECLARE_STATIC_KEY_FALSE(msm_vidc_log_pkt);
+DECLARE_STATIC_KEY_FALSE(msm_vidc_log_bus);
+DECLARE_STATIC_KEY_FALSE(msm_vidc_log_stat);
+DECLARE_STATIC_KEY_FALSE(msm_vidc_buf_trace);
+
+#define msm_vidc_log_on(__level) \
+	((((__level) & VIDC_ERR) && static_branch_likely(&msm_vidc_log_err)) || \
+	 (((__level) & VIDC_HIGH) && static_branch_unlikely(&msm_vidc_log_high)) || \
+	 (((__level) & VIDC_LOW) && static_branch_unlikely(&msm_vidc_log_low)) || \
+	 (((__level) & VIDC_PERF) && static_branch_unlikely(&msm_vidc_log_perf)) || \
+	 (((__level) & VIDC_PKT) && static_branch_unlikely(&msm_vidc_log_pkt)) || \
+	 (((__level) & VIDC_BUS) && static_branch_unlikely(&msm_vidc_log_bus)) || \
+	 (((__level) & VIDC_STAT) && static_branch_unlikely(&msm_vidc_log_stat)))
+
+int msm_vidc_buf_trace_reg(void);
+void msm_vidc_buf_trace_unreg(void);
+
 #define dprintk_inst(__level, __level_str, inst, __fmt, ...) \
 	do { \
+		if (!msm_vidc_log_on(__level)) \
+			break; \
 		if (msm_vidc_debug & VIDC_FTRACE) { \
 			if (inst && (msm_vidc_debug & (__level))) { \
 				trace_printk(VIDC_DBG_TAG_INST __fmt, \
@@ -137,6 +173,8 @@ enum vidc_msg_prio_fw {
 
 #define dprintk_core(__level, __level_str, __fmt, ...) \
 	do { \
+		if (!msm_vidc_log_on(__level)) \
+			break; \
 		if (msm_vidc_debug & VIDC_FTRACE) { \
 			if (msm_vidc_debug & (__level)) { \
 				trace_printk(VIDC_DBG_TAG_CORE __fmt, \
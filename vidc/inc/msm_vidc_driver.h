@@ -12,6 +12,7 @@
 #include "msm_vidc_internal.h"
 #include "msm_vidc_core.h"
 #include "msm_vidc_inst.h"
+#include "msm_vidc_debug.h"
 
 #define MSM_VIDC_SESSION_INACTIVE_THRESHOLD_MS 1000
 
@@ -414,8 +415,16 @@ static inline bool is_enc_slice_delivery_mode(struct msm_vidc_inst *inst)
 const char *cap_name(enum msm_vidc_inst_capability_type cap_id);
 const char *v4l2_pixelfmt_name(struct msm_vidc_inst *inst, u32 pixelfmt);
 const char *v4l2_type_name(u32 port);
-void print_vidc_buffer(u32 tag, const char *tag_str, const char *str,
-		       struct msm_vidc_inst *inst, struct msm_vidc_buffer *vbuf);
+void __print_vidc_buffer(u32 tag, const char *tag_str, const char *str,
+			 struct msm_vidc_inst *inst, struct msm_vidc_buffer *vbuf);
+
+/* skip formatting entirely unless the level or buffer tracing is on */
+#define print_vidc_buffer(tag, tag_str, str, inst, vbuf) \
+	do { \
+		if (msm_vidc_log_on(tag) || \
+		    static_branch_unlikely(&msm_vidc_buf_trace)) \
+			__print_vidc_buffer(tag, tag_str, str, inst, vbuf); \
+	} while (0)
 void print_vb2_buffer(const char *str, struct msm_vidc_inst *inst,
 		      struct vb2_buffer *vb2);
 enum msm_vidc_codec_type v4l2_codec_to_driver(struct msm_vidc_inst *inst,
@@ -443,13 +452,14 @@ int v4l2_type_to_driver_port(struct msm_vidc_inst *inst, u32 type,
 			     const char *func);
 const char *allow_name(enum msm_vidc_allow allow);
 int msm_vidc_create_internal_buffer(struct msm_vidc_inst *inst,
-				    enum msm_vidc_buffer_type buffer_type, u32 index);
+				    enum msm_vidc_buffer_type buffer_type);
 int msm_vidc_get_internal_buffers(struct msm_vidc_inst *inst,
 				  enum msm_vidc_buffer_type buffer_type);
 int msm_vidc_create_internal_buffers(struct msm_vidc_inst *inst,
 				     enum msm_vidc_buffer_type buffer_type);
 int msm_vidc_queue_internal_buffers(struct msm_vidc_inst *inst,
 				    enum msm_vidc_buffer_type buffer_type);
+void msm_vidc_free_oversized_internal_buffers(struct msm_vidc_inst *inst);
 int msm_vidc_alloc_and_queue_session_internal_buffers(struct msm_vidc_inst *inst,
 						      enum msm_vidc_buffer_type buffer_type);
 int msm_vidc_release_internal_buffers(struct msm_vidc_inst *inst,
@@ -496,6 +506,7 @@ int msm_vidc_trigger_stability(struct msm_vidc_core *core,
 void msm_vidc_stability_handler(struct work_struct *work);
 int cancel_stability_work_sync(struct msm_vidc_inst *inst);
 void msm_vidc_fw_unload_handler(struct work_struct *work);
+void msm_vidc_core_init_handler(struct work_struct *work);
 int msm_vidc_suspend(struct msm_vidc_core *core);
 void msm_vidc_batch_handler(struct work_struct *work);
 int msm_vidc_v4l2_fh_init(struct msm_vidc_inst *inst);
@@ -519,8 +530,19 @@ void msm_vidc_update_stats(struct msm_vidc_inst *inst,
 			   struct msm_vidc_buffer *buf,
 			   enum msm_vidc_debugfs_event etype);
 void msm_vidc_stats_handler(struct work_struct *work);
+void msm_vidc_stats_work(struct msm_vidc_inst *inst);
+void msm_vidc_debugfs_work(struct msm_vidc_inst *inst);
+void msm_vidc_input_fence_work(struct msm_vidc_inst *inst);
+void msm_vidc_flush_input_fences(struct msm_vidc_inst *inst);
+void msm_vidc_queue_inst_work(struct msm_vidc_inst *inst,
+			      enum msm_vidc_inst_work type);
+void msm_vidc_inst_work_handler(struct work_struct *work);
+void msm_vidc_cancel_inst_work(struct msm_vidc_inst *inst);
+struct msm_vidc_inst *msm_vidc_get_inst_shell(struct msm_vidc_core *core);
+void msm_vidc_free_inst_shell(struct msm_vidc_inst *inst);
+void msm_vidc_inst_cache_handler(struct work_struct *work);
+void msm_vidc_inst_cache_deinit(struct msm_vidc_core *core);
 int schedule_stats_work(struct msm_vidc_inst *inst);
-int cancel_stats_work_sync(struct msm_vidc_inst *inst);
 void msm_vidc_print_stats(struct msm_vidc_inst *inst);
 void msm_vidc_print_memory_stats(struct msm_vidc_inst *inst);
 enum msm_vidc_buffer_type v4l2_type_to_driver(u32 type, const char *func);
@@ -583,6 +605,10 @@ void inst_lock(struct msm_vidc_inst *inst, const char *function);
 void inst_unlock(struct msm_vidc_inst *inst, const char *function);
 void client_lock(struct msm_vidc_inst *inst, const char *function);
 void client_unlock(struct msm_vidc_inst *inst, const char *function);
+void ctrl_lock(struct msm_vidc_inst *inst, const char *function);
+void ctrl_unlock(struct msm_vidc_inst *inst, const char *function);
+void buffer_lock(struct msm_vidc_inst *inst, const char *function);
+void buffer_unlock(struct msm_vidc_inst *inst, const char *function);
 int msm_vidc_update_bitstream_buffer_size(struct msm_vidc_inst *inst);
 int msm_vidc_update_meta_port_settings(struct msm_vidc_inst *inst);
 int msm_vidc_update_buffer_count(struct msm_vidc_inst *inst, u32 port);
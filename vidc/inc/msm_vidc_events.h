@@ -17,6 +17,8 @@
 #include <linux/tracepoint.h>
 
 #include "msm_vidc_inst.h"
+#include "msm_vidc_core.h"
+#include "msm_vidc_debug.h"
 
 DECLARE_EVENT_CLASS(msm_v4l2_vidc_inst,
 
@@ -51,6 +53,39 @@ DEFINE_EVENT(msm_v4l2_vidc_inst, msm_v4l2_vidc_close,
 	TP_ARGS(dummy, inst)
 );
 
+DECLARE_EVENT_CLASS(msm_v4l2_vidc_latency,
+
+	TP_PROTO(u32 session_id, u64 latency_us),
+
+	TP_ARGS(session_id, latency_us),
+
+	TP_STRUCT__entry(
+		__field(u32, session_id)
+		__field(u64, latency_us)
+	),
+
+	TP_fast_assign(
+		__entry->session_id = session_id;
+		__entry->latency_us = latency_us;
+	),
+
+	TP_printk("session %#x: %llu us\n", __entry->session_id, __entry->latency_us)
+);
+
+DEFINE_EVENT(msm_v4l2_vidc_latency, msm_v4l2_vidc_open_latency,
+
+	TP_PROTO(u32 session_id, u64 latency_us),
+
+	TP_ARGS(session_id, latency_us)
+);
+
+DEFINE_EVENT(msm_v4l2_vidc_latency, msm_v4l2_vidc_close_latency,
+
+	TP_PROTO(u32 session_id, u64 latency_us),
+
+	TP_ARGS(session_id, latency_us)
+);
+
 DECLARE_EVENT_CLASS(msm_v4l2_vidc_fw_load,
 
 	TP_PROTO(char *dummy),
@@ -75,6 +110,13 @@ DEFINE_EVENT(msm_v4l2_vidc_fw_load, msm_v4l2_vidc_fw_load,
 	TP_ARGS(dummy)
 );
 
+DEFINE_EVENT(msm_v4l2_vidc_fw_load, msm_v4l2_vidc_core_init,
+
+	TP_PROTO(char *dummy),
+
+	TP_ARGS(dummy)
+);
+
 DECLARE_EVENT_CLASS(msm_vidc_driver,
 
 	TP_PROTO(struct msm_vidc_inst *inst, const char *func,
@@ -205,12 +247,14 @@ DECLARE_EVENT_CLASS(msm_v4l2_vidc_buffer_events,
 		__entry->attr, __entry->etb, __entry->ebd, __entry->ftb, __entry->fbd)
 );
 
-DEFINE_EVENT(msm_v4l2_vidc_buffer_events, msm_v4l2_vidc_buffer_event_log,
+DEFINE_EVENT_FN(msm_v4l2_vidc_buffer_events, msm_v4l2_vidc_buffer_event_log,
 
 	TP_PROTO(struct msm_vidc_inst *inst, const char *str, const char *buf_type,
 		struct msm_vidc_buffer *vbuf, unsigned long inode, long ref_count),
 
-	TP_ARGS(inst, str, buf_type, vbuf, inode, ref_count)
+	TP_ARGS(inst, str, buf_type, vbuf, inode, ref_count),
+
+	msm_vidc_buf_trace_reg, msm_vidc_buf_trace_unreg
 );
 
 DECLARE_EVENT_CLASS(msm_vidc_perf,
@@ -294,6 +338,70 @@ DEFINE_EVENT(msm_vidc_buffer_dma_ops, msm_vidc_dma_buffer,
 	TP_ARGS(buffer_op, dmabuf, size, kvaddr, buf_name, secure, region)
 );
 
+TRACE_DEFINE_ENUM(MSM_VIDC_BUF_STAGE_QBUF);
+TRACE_DEFINE_ENUM(MSM_VIDC_BUF_STAGE_SUBMIT);
+TRACE_DEFINE_ENUM(MSM_VIDC_BUF_STAGE_FW_DONE);
+TRACE_DEFINE_ENUM(MSM_VIDC_BUF_STAGE_VB2_DONE);
+TRACE_DEFINE_ENUM(MSM_VIDC_BUF_STAGE_DQBUF);
+TRACE_DEFINE_ENUM(MSM_VIDC_BUF_INPUT);
+TRACE_DEFINE_ENUM(MSM_VIDC_BUF_OUTPUT);
+TRACE_DEFINE_ENUM(MSM_VIDC_BUF_INPUT_META);
+TRACE_DEFINE_ENUM(MSM_VIDC_BUF_OUTPUT_META);
+
+DECLARE_EVENT_CLASS(msm_vidc_buffer_lifecycle,
+
+	TP_PROTO(struct msm_vidc_inst *inst, u32 stage, u32 type, u32 index,
+		u64 device_addr, u64 timestamp, u32 packet_id),
+
+	TP_ARGS(inst, stage, type, index, device_addr, timestamp, packet_id),
+
+	TP_STRUCT__entry(
+		__field(u32, session_id)
+		__field(u32, stage)
+		__field(u32, type)
+		__field(u32, index)
+		__field(u64, device_addr)
+		__field(u64, timestamp)
+		__field(u32, packet_id)
+		__field(u64, clk_freq)
+	),
+
+	TP_fast_assign(
+		__entry->session_id = inst->session_id;
+		__entry->stage = stage;
+		__entry->type = type;
+		__entry->index = index;
+		__entry->device_addr = device_addr;
+		__entry->timestamp = timestamp;
+		__entry->packet_id = packet_id;
+		__entry->clk_freq = inst->core ? inst->core->power.clk_freq : 0;
+	),
+
+	TP_printk("sid %#x stage %s type %s idx %u daddr %#llx ts %llu pkt %u clk %llu",
+		__entry->session_id,
+		__print_symbolic(__entry->stage,
+			{ MSM_VIDC_BUF_STAGE_QBUF,     "qbuf" },
+			{ MSM_VIDC_BUF_STAGE_SUBMIT,   "submit" },
+			{ MSM_VIDC_BUF_STAGE_FW_DONE,  "fw_done" },
+			{ MSM_VIDC_BUF_STAGE_VB2_DONE, "vb2_done" },
+			{ MSM_VIDC_BUF_STAGE_DQBUF,    "dqbuf" }),
+		__print_symbolic(__entry->type,
+			{ MSM_VIDC_BUF_INPUT,       "INPUT" },
+			{ MSM_VIDC_BUF_OUTPUT,      "OUTPUT" },
+			{ MSM_VIDC_BUF_INPUT_META,  "INPUT_META" },
+			{ MSM_VIDC_BUF_OUTPUT_META, "OUTPUT_META" }),
+		__entry->index, __entry->device_addr, __entry->timestamp,
+		__entry->packet_id, __entry->clk_freq)
+);
+
+DEFINE_EVENT(msm_vidc_buffer_lifecycle, msm_vidc_buffer_stage,
+
+	TP_PROTO(struct msm_vidc_inst *inst, u32 stage, u32 type, u32 index,
+		u64 device_addr, u64 timestamp, u32 packet_id),
+
+	TP_ARGS(inst, stage, type, index, device_addr, timestamp, packet_id)
+);
+
 #endif
 
 /* This part must be outside protection */
@@ -11,6 +11,7 @@
 #include "msm_vidc_memory.h"
 #include "msm_vidc_state.h"
 #include "hfi_property.h"
+#include "perf_static_model.h"
 
 struct msm_vidc_inst;
 
@@ -31,6 +32,25 @@ struct msm_vidc_session_ops {
 	int (*ring_buf_count)(struct msm_vidc_inst *inst, u32 data_size);
 };
 
+/*
+ * last inputs handed to the variant power models along with their results;
+ * a model is re-evaluated only when its input differs from the cached one
+ */
+struct msm_vidc_power_cache {
+	struct api_calculation_input       freq_input;
+	struct api_calculation_freq_output freq_output;
+	struct api_calculation_input       bw_input;
+	struct api_calculation_bw_output   bw_output;
+	struct vidc_bus_vote_data          bus_vote;
+	bool                               freq_valid;
+	bool                               bw_valid;
+	bool                               bus_valid;
+	u32                                freq_evals;
+	u32                                freq_hits;
+	u32                                bw_evals;
+	u32                                bw_hits;
+};
+
 struct msm_vidc_mem_list_info {
 	struct msm_vidc_mem_list        bin;
 	struct msm_vidc_mem_list        arp;
@@ -60,13 +80,40 @@ struct msm_vidc_buffers_info {
 	struct msm_vidc_buffers        partial_data;
 };
 
+/* session work posted through msm_vidc_queue_inst_work() */
+enum msm_vidc_inst_work {
+	MSM_VIDC_INST_WORK_DEBUGFS,
+	MSM_VIDC_INST_WORK_INPUT_FENCE,
+	MSM_VIDC_INST_WORK_STATS,
+};
+
 struct buf_queue {
 	struct vb2_queue *vb2q;
 };
 
+/*
+ * Instance lock ordering:
+ *   client_lock -> lock -> buffer_lock -> core->lock
+ *
+ * lock serializes state, formats, capabilities and buffer counts.
+ * buffer_lock serializes the buffer lists (struct msm_vidc_buffers_info),
+ * timestamps and fences. inst_lock() takes both, so only the paths that
+ * explicitly use ctrl_lock() (controls, g_fmt) or buffer_lock() (dqbuf and
+ * input buffer done while streaming) run concurrently with each other.
+ *
+ * Every state and sub_state change goes through inst_lock(), i.e. with
+ * both mutexes held. Holding either one is therefore enough to read
+ * inst->state, which is what the buffer_lock() only paths rely on.
+ *
+ * The input buffer done path also updates power.input_size_*, stats and
+ * debug_count, so those are buffer_lock protected as well: ctrl_lock()
+ * alone is not enough to read them. msm_vidc_update_input_size(),
+ * msm_vidc_input_size() and msm_vidc_update_stats() assert it.
+ */
 struct msm_vidc_inst {
 	struct list_head                   list;
 	struct mutex                       lock;
+	struct mutex                       buffer_lock;
 	struct mutex                       ctx_q_lock;
 	struct mutex                       client_lock;
 	enum msm_vidc_state                state;
@@ -83,6 +130,9 @@ struct msm_vidc_inst {
 	u8                                 debug_str[24];
 	void                              *packet;
 	u32                                packet_size;
+	bool                               prop_batch;
+	u32                                prop_batch_count;
+	u32                                prop_batch_sent;
 	struct v4l2_format                 fmts[MAX_PORT];
 	struct v4l2_ctrl_handler           ctrl_handler;
 	struct v4l2_fh                     fh;
@@ -107,17 +157,24 @@ struct msm_vidc_inst {
 	struct msm_vidc_decode_batch       decode_batch;
 	struct msm_vidc_decode_vpp_delay   decode_vpp_delay;
 	struct msm_vidc_session_idle       session_idle;
+	struct work_struct                 work; /* on core->inst_workq */
+	unsigned long                      work_pending; /* BIT(enum msm_vidc_inst_work) */
 	struct delayed_work                stats_work;
 	struct work_struct                 stability_work;
+	struct list_head                   input_fence_list; /* list of struct msm_vidc_input_fence */
+	bool                               drain_deferred; /* until input_fence_list drains */
 	struct msm_vidc_stability          stability;
-	struct workqueue_struct           *workq;
-	struct list_head                   enc_input_crs;
+	struct msm_vidc_input_cr_data      enc_input_crs;
 	struct list_head                   dmabuf_tracker; /* struct msm_memory_dmabuf */
 	struct list_head                   input_timer_list; /* struct msm_vidc_input_timer */
 	struct list_head                   caps_list;
-	struct list_head                   children_list; /* struct msm_vidc_inst_cap_entry */
-	struct list_head                   firmware_list; /* struct msm_vidc_inst_cap_entry */
-	struct list_head                   pending_pkts; /* struct hfi_pending_packet */
+	/* caps_list flattened: cap ids in order and each cap's position */
+	u16                                cap_order[INST_CAP_MAX];
+	u16                                cap_order_pos[INST_CAP_MAX];
+	u32                                cap_order_count;
+	DECLARE_BITMAP(firmware_pending, INST_CAP_MAX);
+	struct msm_vidc_pending_pkts       pending_pkts;
+	struct msm_vidc_buf_reuse_stats    buf_reuse;
 	struct list_head                   fence_list; /* struct msm_vidc_fence */
 	struct list_head                   buffer_stats_list; /* struct msm_vidc_buffer_stats */
 	bool                               once_per_session_set;
@@ -128,14 +185,18 @@ struct msm_vidc_inst {
 	struct msm_vidc_debug              debug;
 	struct debug_buf_count             debug_count;
 	struct msm_vidc_statistics         stats;
-	struct msm_vidc_inst_cap           capabilities[INST_CAP_MAX + 1];
+	const struct msm_vidc_inst_capability *codec_caps;
+	const struct msm_vidc_inst_cap     *cap_table;
+	struct msm_vidc_inst_cap_state     capabilities[INST_CAP_MAX + 1];
 	struct completion                  completions[MAX_SIGNAL];
 	struct msm_vidc_fence_context      fence_context;
 	bool                               active;
 	u64                                last_qbuf_time_ns;
 	u64                                initial_time_us;
 	u32                                max_input_data_size;
+	struct msm_vidc_power_cache        power_cache;
 	u32                                dpb_list_payload[MAX_DPB_LIST_ARRAY_SIZE];
+	struct msm_vidc_dpb_slots          dpb_slots;
 	bool                               input_dpb_list_enabled;
 	bool                               output_dpb_list_enabled;
 	u32                                auto_framerate;
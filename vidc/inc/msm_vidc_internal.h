@@ -10,6 +10,7 @@
 #include <linux/vmalloc.h>
 #include <linux/version.h>
 #include <linux/bits.h>
+#include <linux/bitmap.h>
 #include <linux/workqueue.h>
 #include <linux/spinlock.h>
 #include <linux/sync_file.h>
@@ -142,6 +143,7 @@ enum msm_vidc_metadata_bits {
 #define HEIC_GRID_WIDTH                     512
 
 #define DCVS_WINDOW 16
+#define MSM_VIDC_THERMAL_MIN_RATE_PCT 10
 #define ENC_FPS_WINDOW 3
 #define DEC_FPS_WINDOW 10
 #define INPUT_TIMER_LIST_SIZE 30
@@ -213,6 +215,7 @@ enum msm_vidc_metadata_bits {
   */
 #define MAX_DPB_LIST_ARRAY_SIZE (16 * 4)
 #define MAX_DPB_LIST_PAYLOAD_SIZE (16 * 4 * 4)
+#define MAX_DPB_SLOTS (MAX_DPB_LIST_ARRAY_SIZE / 4)
 
 #define GENERATE_ENUM(ENUM) ENUM,
 #define GENERATE_STRING(STRING) (#STRING),
@@ -295,6 +298,7 @@ enum msm_vidc_metadata_bits {
 	CAP(OUTBUF_FENCE_TYPE)                    \
 	CAP(INBUF_FENCE_DIRECTION)                \
 	CAP(OUTBUF_FENCE_DIRECTION)               \
+	CAP(INBUF_FENCE_FD)                       \
 	CAP(PROFILE)                              \
 	CAP(ENH_LAYER_COUNT)                      \
 	CAP(BIT_RATE)                             \
@@ -474,6 +478,15 @@ enum msm_vidc_colorformat_type {
 
 enum msm_vidc_buffer_type FOREACH_BUF_TYPE(GENERATE_MSM_VIDC_BUF_ENUM);
 
+/* stages traced by msm_vidc_buffer_stage, in the order a buffer visits them */
+enum msm_vidc_buffer_stage {
+	MSM_VIDC_BUF_STAGE_QBUF,
+	MSM_VIDC_BUF_STAGE_SUBMIT,
+	MSM_VIDC_BUF_STAGE_FW_DONE,
+	MSM_VIDC_BUF_STAGE_VB2_DONE,
+	MSM_VIDC_BUF_STAGE_DQBUF,
+};
+
 /* always match with v4l2 flags V4L2_BUF_FLAG_* */
 enum msm_vidc_buffer_flags {
 	MSM_VIDC_BUF_FLAG_KEYFRAME         = 0x00000008,
@@ -495,6 +508,8 @@ enum msm_vidc_buffer_attributes {
 	MSM_VIDC_ATTR_DEQUEUED                  = BIT(4),
 	MSM_VIDC_ATTR_BUFFER_DONE               = BIT(5),
 	MSM_VIDC_ATTR_RELEASE_ELIGIBLE          = BIT(6),
+	MSM_VIDC_ATTR_REUSE                     = BIT(7),
+	MSM_VIDC_ATTR_FENCE_WAIT                = BIT(8),
 };
 
 enum msm_vidc_buffer_region {
@@ -680,11 +695,52 @@ struct msm_vidc_inst_cap {
 		   enum msm_vidc_inst_capability_type cap_id);
 };
 
+/*
+ * Per-instance, mutable part of a capability. Everything else (ids,
+ * children, adjust/set ops) is shared from core->inst_caps and reached
+ * through inst->cap_table.
+ */
+struct msm_vidc_inst_cap_state {
+	s32 min;
+	s32 max;
+	u32 step_or_mask;
+	s32 value;
+	enum msm_vidc_inst_capability_flags flags;
+};
+
+struct msm_vidc_cid_map {
+	u32 v4l2_id;
+	enum msm_vidc_inst_capability_type cap_id;
+};
+
 struct msm_vidc_inst_capability {
 	enum msm_vidc_domain_type domain;
 	enum msm_vidc_codec_type codec;
 	struct msm_vidc_inst_cap cap[INST_CAP_MAX + 1];
-};
+	/* caps with a v4l2 control, sorted by (v4l2_id, cap_id) */
+	struct msm_vidc_cid_map cid_map[INST_CAP_MAX];
+	u32 cid_map_count;
+};
+
+static inline enum msm_vidc_inst_capability_type
+msm_vidc_cid_map_lookup(const struct msm_vidc_inst_capability *caps, u32 id)
+{
+	const struct msm_vidc_cid_map *map = caps->cid_map;
+	u32 lo = 0, hi = caps->cid_map_count, mid;
+
+	/* leftmost match, so duplicate cids resolve to the lowest cap id */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (map[mid].v4l2_id < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < caps->cid_map_count && map[lo].v4l2_id == id)
+		return map[lo].cap_id;
+
+	return INST_CAP_NONE;
+}
 
 struct msm_vidc_core_capability {
 	enum msm_vidc_core_capability_type type;
@@ -715,12 +771,36 @@ struct debug_buf_count {
 	u64 ebd;
 };
 
+/* one slot per second; the extra slot is the one being filled */
+#define MSM_VIDC_BW_WINDOW_SLOTS 11
+
+struct msm_vidc_bw_window {
+	u64                                slot_start_ns;
+	u64                                last_ns;
+	u32                                last_bw_ddr;
+	u32                                last_bw_llcc;
+	u32                                slot;
+	u64                                ddr_sum[MSM_VIDC_BW_WINDOW_SLOTS]; /* kbps * us */
+	u64                                llcc_sum[MSM_VIDC_BW_WINDOW_SLOTS];
+	u32                                ddr_peak[MSM_VIDC_BW_WINDOW_SLOTS];
+	u32                                llcc_peak[MSM_VIDC_BW_WINDOW_SLOTS];
+};
+
+struct msm_vidc_bw_window_stats {
+	u32                                avg_ddr;
+	u32                                peak_ddr;
+	u32                                avg_llcc;
+	u32                                peak_llcc;
+};
+
 struct msm_vidc_statistics {
 	struct debug_buf_count             count;
 	u64                                data_size;
 	u64                                time_ms;
 	u32                                avg_bw_llcc;
 	u32                                avg_bw_ddr;
+	u64                                bw_update_ns;
+	struct msm_vidc_bw_window          bw_window;
 };
 
 enum efuse_purpose {
@@ -787,10 +867,165 @@ struct msm_vidc_debug {
 	u32                    samples;
 };
 
-struct msm_vidc_input_cr_data {
+/*
+ * Property packets set for a request, appended back to back and spliced
+ * into the next queue_buffer packet. The buffer grows on demand and is
+ * reused for every request.
+ */
+struct msm_vidc_pending_pkts {
+	u8                    *data;
+	u32                    size;
+	u32                    capacity;
+	u32                    num_packets;
+	u32                    last_frame_bytes;
+	u32                    max_frame_bytes;
+};
+
+/* inst->packet as msm_vidc_session_open() allocates it, one frame's worth */
+#define MSM_VIDC_SESSION_PACKET_SIZE   4096
+
+/*
+ * The pending arena starts at PENDING_PKTS_MIN_SIZE and doubles. Requests
+ * carry a handful of properties each; a client piling up more than
+ * PENDING_PKTS_MAX_SIZE without queueing a frame gets -ENOMEM instead of
+ * an unbounded vzalloc() of inst->packet.
+ */
+#define PENDING_PKTS_MIN_SIZE          1024
+#define PENDING_PKTS_MAX_SIZE          (64 * 1024)
+
+/*
+ * Arena capacity needed to hold @needed bytes, or 0 when that is above
+ * PENDING_PKTS_MAX_SIZE. Returns @capacity when it is already enough.
+ */
+static inline u32 msm_vidc_pending_pkts_capacity(u32 capacity, u32 needed)
+{
+	if (needed > PENDING_PKTS_MAX_SIZE)
+		return 0;
+	if (needed <= capacity)
+		return capacity;
+
+	capacity = max_t(u32, capacity * 2, PENDING_PKTS_MIN_SIZE);
+	capacity = max_t(u32, capacity, needed);
+
+	return min_t(u32, capacity, PENDING_PKTS_MAX_SIZE);
+}
+
+/*
+ * DPB entries reported by firmware, keyed by <base_address, data_offset>.
+ * A slot keeps its id for as long as the entry stays in consecutive DPB
+ * lists, and ref holds the slots referenced by the latest list.
+ */
+struct msm_vidc_dpb_slots {
+	u32                    device_addr[MAX_DPB_SLOTS];
+	u32                    data_offset[MAX_DPB_SLOTS];
+	DECLARE_BITMAP(ref, MAX_DPB_SLOTS);
+};
+
+static inline bool msm_vidc_dpb_slot_match(const struct msm_vidc_dpb_slots *slots,
+	u32 slot, u64 device_addr, u32 data_offset)
+{
+	return slots->device_addr[slot] == device_addr &&
+		slots->data_offset[slot] == data_offset;
+}
+
+/*
+ * Convert a dpb list payload into the set of referenced slots and return
+ * the slots it no longer references in @dropped.
+ * dpb list payload details:
+ * payload[0-1]           : 64 bits base_address of DPB-1
+ * payload[2]             : 32 bits addr_offset  of DPB-1
+ * payload[3]             : 32 bits data_offset  of DPB-1
+ * Entries still referenced keep their slot, slots dropped from the list
+ * (previous & ~current) are recycled for the new entries.
+ */
+static inline void msm_vidc_dpb_slots_update(struct msm_vidc_dpb_slots *slots,
+	const u32 *payload, unsigned long *dropped)
+{
+	DECLARE_BITMAP(cur, MAX_DPB_SLOTS);
+	u32 i, slot;
+
+	bitmap_zero(cur, MAX_DPB_SLOTS);
+	for (i = 0; (i + 3) < MAX_DPB_LIST_ARRAY_SIZE; i += 4) {
+		/* unused entries are zero */
+		if (!payload[i])
+			continue;
+		for_each_set_bit(slot, slots->ref, MAX_DPB_SLOTS) {
+			if (msm_vidc_dpb_slot_match(slots, slot, payload[i], payload[i + 3])) {
+				__set_bit(slot, cur);
+				break;
+			}
+		}
+	}
+
+	bitmap_andnot(dropped, slots->ref, cur, MAX_DPB_SLOTS);
+	bitmap_copy(slots->ref, cur, MAX_DPB_SLOTS);
+
+	for (i = 0; (i + 3) < MAX_DPB_LIST_ARRAY_SIZE; i += 4) {
+		if (!payload[i])
+			continue;
+		for_each_set_bit(slot, cur, MAX_DPB_SLOTS) {
+			if (msm_vidc_dpb_slot_match(slots, slot, payload[i], payload[i + 3]))
+				break;
+		}
+		/* already referenced, including duplicate entries */
+		if (slot < MAX_DPB_SLOTS)
+			continue;
+
+		slot = find_first_zero_bit(slots->ref, MAX_DPB_SLOTS);
+		if (slot >= MAX_DPB_SLOTS)
+			break;
+		slots->device_addr[slot] = payload[i];
+		slots->data_offset[slot] = payload[i + 3];
+		__set_bit(slot, slots->ref);
+		__set_bit(slot, cur);
+	}
+}
+
+/*
+ * Slot of <device_addr, data_offset> in the latest dpb list, or
+ * MAX_DPB_SLOTS when it is not referenced. @hint, the slot found last
+ * time, is tried first, so an entry which stays referenced costs a single
+ * bit test.
+ */
+static inline u32 msm_vidc_dpb_slots_find(const struct msm_vidc_dpb_slots *slots,
+	u32 hint, u64 device_addr, u32 data_offset)
+{
+	u32 slot;
+
+	if (hint < MAX_DPB_SLOTS && test_bit(hint, slots->ref) &&
+	    msm_vidc_dpb_slot_match(slots, hint, device_addr, data_offset))
+		return hint;
+
+	for_each_set_bit(slot, slots->ref, MAX_DPB_SLOTS) {
+		if (msm_vidc_dpb_slot_match(slots, slot, device_addr, data_offset))
+			return slot;
+	}
+
+	return MAX_DPB_SLOTS;
+}
+
+/*
+ * Input buffer waiting for its producer fence before being queued.
+ * Waiters are kept in qbuf order, and a buffer without a fence queued
+ * behind a waiting one is held as well so that firmware sees the input
+ * in order.
+ */
+struct msm_vidc_input_fence {
 	struct list_head       list;
-	u32                    index;
-	u32                    input_cr;
+	struct msm_vidc_inst  *inst;
+	struct msm_vidc_buffer *buf;
+	struct dma_fence      *fence;
+	struct dma_fence_cb    cb;
+};
+
+/* sized from the input vb2 queue's max_num_buffers */
+struct msm_vidc_input_cr_data {
+	unsigned long         *valid;
+	u32                   *input_cr;
+	u32                    count;
+	u32                    min_cr;
+	u32                    min_index;
+	bool                   stale;
 };
 
 struct msm_vidc_session_idle {
@@ -842,6 +1077,28 @@ struct msm_vidc_hfi_frame_info {
 	bool                   av1_non_uniform_tile_spacing;
 };
 
+/*
+ * response packets are at least sizeof(struct hfi_packet) i.e 32 bytes,
+ * so a single response header can never carry more packets than this.
+ */
+#define HFI_RESPONSE_MAX_PACKETS (VIDC_IFACEQ_VAR_HUGE_PKT_SIZE / 32)
+
+/* session packet classes, listed in the order they must be handled */
+enum msm_vidc_hfi_packet_class {
+	HFI_PKT_CLASS_NONE = 0,
+	HFI_PKT_CLASS_SESSION_ERROR,
+	HFI_PKT_CLASS_INFORMATION,
+	HFI_PKT_CLASS_PROPERTY,
+	HFI_PKT_CLASS_COMMAND,
+	HFI_PKT_CLASS_MAX,
+};
+
+struct msm_vidc_hfi_dispatch {
+	u16                    offset[HFI_PKT_CLASS_MAX][HFI_RESPONSE_MAX_PACKETS];
+	u32                    count[HFI_PKT_CLASS_MAX];
+	bool                   found_ipsc;
+};
+
 struct msm_vidc_decode_vpp_delay {
 	bool                   enable;
 	u32                    size;
@@ -882,6 +1139,14 @@ struct vidc_bus_vote_data {
 	bool vpss_preprocessing_enabled;
 };
 
+/* ETB times, matched to FBD by the firmware timestamp */
+#define MSM_VIDC_ETB_TIME_SLOTS 32
+
+struct msm_vidc_etb_time {
+	u64                    timestamp;
+	u64                    submit_ns;
+};
+
 struct msm_vidc_power {
 	enum msm_vidc_power_mode power_mode;
 	u32                    buffer_counter;
@@ -899,6 +1164,31 @@ struct msm_vidc_power {
 	u32                    fw_cf;
 	u32                    fw_av1_tile_rows;
 	u32                    fw_av1_tile_columns;
+	u64                    last_done_ns;
+	u64                    avg_frame_cycles;
+	u32                    frame_samples;
+	u64                    closed_loop_freq;
+	u32                    deadline_misses;
+	struct msm_vidc_etb_time etb_time[MSM_VIDC_ETB_TIME_SLOTS];
+	u32                    etb_time_idx;
+	u64                    frame_cycles;
+	u32                    cycles_margin;
+	u32                    slack_frames;
+	u32                    req_rate;
+	u32                    thermal_pct;
+	u32                    input_size_max;
+	u32                    input_size_index;
+	bool                   input_size_stale;
+};
+
+enum msm_vidc_dcvs_policy {
+	MSM_VIDC_DCVS_POLICY_BUFFER_COUNT   = 0,
+	MSM_VIDC_DCVS_POLICY_CLOSED_LOOP    = 1,
+};
+
+enum msm_vidc_clock_aggregation {
+	MSM_VIDC_CLOCK_AGGR_SUM             = 0,
+	MSM_VIDC_CLOCK_AGGR_EDF             = 1,
 };
 
 enum msm_vidc_fence_type {
@@ -947,7 +1237,7 @@ struct msm_vidc_mem {
 #elif (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 15, 0))
 	struct dma_buf_map          dmabuf_map;
 #endif
-	void                       *kvaddr;
+	void                       *kvaddr; /* cookie only, if !map_kernel */
 	dma_addr_t                  device_addr;
 	unsigned long               attrs;
 	u32                         refcount;
@@ -974,6 +1264,7 @@ struct msm_vidc_buffer {
 	u64                                device_addr;
 	u32                                flags;
 	u64                                timestamp;
+	u64                                submit_time_ns;
 	enum msm_vidc_buffer_attributes    attr;
 	void                              *dmabuf;
 	struct sg_table                   *sg_table;
@@ -983,6 +1274,7 @@ struct msm_vidc_buffer {
 	unsigned long                      dma_attrs;
 	void                              *kvaddr;
 	u32                                dbuf_get:1;
+	u8                                 dpb_slot;
 	u64                                fence_id;
 	u32                                start_time_ms;
 	u32                                end_time_ms;
@@ -995,6 +1287,22 @@ struct msm_vidc_buffers {
 	u32                    actual_count;
 	u32                    size;
 	bool                   reuse;
+	u64                    oversize_since_ns;
+};
+
+/*
+ * Internal buffers kept across reconfigurations (DRC, seek) are retained
+ * while they still fit the new requirement. Retained buffers at least
+ * INTERNAL_BUF_OVERSIZE_RATIO times the required size are freed once they
+ * stayed oversized for INTERNAL_BUF_SHRINK_DELAY_MS, or at streamoff.
+ */
+#define INTERNAL_BUF_OVERSIZE_RATIO   2
+#define INTERNAL_BUF_SHRINK_DELAY_MS  10000
+
+struct msm_vidc_buf_reuse_stats {
+	u32                    reused;
+	u32                    allocated;
+	u32                    shrunk;
 };
 
 struct msm_vidc_buffer_stats {
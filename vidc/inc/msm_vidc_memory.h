@@ -12,8 +12,6 @@
 struct msm_vidc_core;
 struct msm_vidc_inst;
 
-#define MSM_MEM_POOL_PACKET_SIZE 1024
-
 struct msm_memory_dmabuf {
 	struct list_head       list;
 	struct dma_buf        *dmabuf;
@@ -25,7 +23,6 @@ enum msm_memory_pool_type {
 	MSM_MEM_POOL_ALLOC_MAP,
 	MSM_MEM_POOL_TIMESTAMP,
 	MSM_MEM_POOL_DMABUF,
-	MSM_MEM_POOL_PACKET,
 	MSM_MEM_POOL_BUF_TIMER,
 	MSM_MEM_POOL_BUF_STATS,
 	MSM_MEM_POOL_MAX,
@@ -57,6 +54,41 @@ void msm_vidc_pool_free(struct msm_vidc_inst *inst, void *vidc_buf);
 int msm_vidc_pools_init(struct msm_vidc_inst *inst);
 void msm_vidc_pools_deinit(struct msm_vidc_inst *inst);
 
+/*
+ * Buffer types the driver reads or writes through kvaddr, next to the
+ * buffer_region op that decides where each type is mapped for firmware.
+ * Every other type msm_vidc_memory_alloc_map() allocates is device only
+ * and gets DMA_ATTR_NO_KERNEL_MAPPING.
+ */
+static inline bool msm_vidc_buffer_map_kernel(enum msm_vidc_buffer_type type)
+{
+	switch (type) {
+	case MSM_VIDC_BUF_INTERFACE_QUEUE:
+		/* queues, sfr and HFI_MMAP_ADDR payload */
+		return true;
+	case MSM_VIDC_BUF_BIN:
+	case MSM_VIDC_BUF_ARP:
+	case MSM_VIDC_BUF_COMV:
+	case MSM_VIDC_BUF_NON_COMV:
+	case MSM_VIDC_BUF_LINE:
+	case MSM_VIDC_BUF_DPB:
+	case MSM_VIDC_BUF_PERSIST:
+	case MSM_VIDC_BUF_VPSS:
+	case MSM_VIDC_BUF_PARTIAL_DATA:
+	default:
+		return false;
+	}
+}
+
+/* kernel address of @mem; NULL, with a warning, if it was not mapped */
+static inline void *msm_vidc_mem_kvaddr(struct msm_vidc_mem *mem)
+{
+	if (WARN_ON(!mem->map_kernel))
+		return NULL;
+
+	return mem->kvaddr;
+}
+
 #define call_mem_op(c, op, ...)                  \
 	(((c) && (c)->mem_ops && (c)->mem_ops->op) ? \
 	((c)->mem_ops->op(__VA_ARGS__)) : 0)
@@ -11,6 +11,7 @@
 #include "msm_vidc_debug.h"
 #include "msm_vidc_internal.h"
 #include "msm_vidc_inst.h"
+#include "resources.h"
 
 #define COMPRESSION_RATIO_MAX 5
 
@@ -250,8 +251,149 @@ static inline int __bpp(enum msm_vidc_colorformat_type f)
 	}
 }
 
+/*
+ * firmware starts a frame only once its input (ETB) and output (FTB) are
+ * both queued and the previous frame is done. The sample is capped at one
+ * frame period so a stall reads as a deadline miss, not as a slow frame.
+ */
+static inline u64 msm_vidc_frame_proc_ns(u64 etb_ns, u64 ftb_ns,
+	u64 last_done_ns, u64 done_ns, u32 fps)
+{
+	u64 start = max3(etb_ns, ftb_ns, last_done_ns);
+	u64 proc_ns;
+
+	if (done_ns <= start)
+		return 0;
+
+	proc_ns = done_ns - start;
+	if (fps)
+		proc_ns = min_t(u64, proc_ns, div_u64(NSEC_PER_SEC, fps));
+
+	return proc_ns;
+}
+
+/* 1/8 weight EWMA of cycles per frame, seeded by the first sample */
+static inline u64 msm_vidc_frame_cycles_avg(u64 avg, u32 samples, u64 cycles)
+{
+	if (!samples)
+		return cycles;
+
+	return (avg * 7 + cycles) >> 3;
+}
+
+/*
+ * lowest rate of a descending freq_tbl that fits cycles x fps with
+ * headroom percent margin. A lower rate than prev_rate is taken only when
+ * it still fits with hysteresis percent on top.
+ */
+static inline u64 msm_vidc_closed_loop_rate(struct frequency_table *freq_tbl,
+	u32 count, u64 cycles, u32 fps, u64 prev_rate,
+	u32 headroom, u32 hysteresis)
+{
+	u64 required, rate = 0;
+	int i;
+
+	required = div_u64(cycles * fps * (100 + headroom), 100);
+	for (i = count - 1; i >= 0; i--) {
+		rate = freq_tbl[i].freq;
+		if (rate >= required)
+			break;
+	}
+
+	if (rate < prev_rate &&
+	    div_u64(required * (100 + hysteresis), 100) > rate)
+		rate = prev_rate;
+
+	return rate;
+}
+
+/* lowest rate of a descending freq_tbl that is at least required */
+static inline u64 msm_vidc_table_rate(struct frequency_table *freq_tbl,
+	u32 count, u64 required)
+{
+	u64 rate = 0;
+	int i;
+
+	for (i = count - 1; i >= 0; i--) {
+		rate = freq_tbl[i].freq;
+		if (rate >= required)
+			break;
+	}
+
+	return rate;
+}
+
+/*
+ * EDF processor demand of one session over the next second: every frame
+ * due in that window needs frame_cycles, except the first slack_frames,
+ * whose deadlines are already covered by work done ahead. margin percent
+ * is added on top for measured, not modelled, cycles.
+ */
+static inline u64 msm_vidc_edf_demand(u64 frame_cycles, u32 fps,
+	u32 slack_frames, u32 margin)
+{
+	u64 demand;
+
+	if (slack_frames >= fps)
+		return 0;
+
+	demand = frame_cycles * (fps - slack_frames);
+	margin = min_t(u32, margin, 90);
+
+	return div_u64(demand * 100, 100 - margin);
+}
+
+/*
+ * keep power.input_size_max equal to the largest filled length in the
+ * input buffer list without walking the list on every qbuf. Only a shrink
+ * of the buffer currently holding the max forces a rescan. The input
+ * buffer done path updates this under buffer_lock alone.
+ */
+static inline void msm_vidc_update_input_size(struct msm_vidc_inst *inst,
+	struct msm_vidc_buffer *buf)
+{
+	struct msm_vidc_power *power = &inst->power;
+
+	lockdep_assert_held(&inst->buffer_lock);
+
+	if (buf->type != MSM_VIDC_BUF_INPUT)
+		return;
+
+	if (buf->data_size >= power->input_size_max) {
+		power->input_size_max = buf->data_size;
+		power->input_size_index = buf->index;
+	} else if (buf->index == power->input_size_index) {
+		power->input_size_stale = true;
+	}
+}
+
+/* largest filled length among the input buffers, rescanned when stale */
+static inline u32 msm_vidc_input_size(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_buffer *vbuf;
+
+	lockdep_assert_held(&inst->buffer_lock);
+
+	if (inst->power.input_size_stale) {
+		inst->power.input_size_max = 0;
+		list_for_each_entry(vbuf, &inst->buffers.input.list, list)
+			msm_vidc_update_input_size(inst, vbuf);
+		inst->power.input_size_stale = false;
+	}
+
+	return inst->power.input_size_max;
+}
+
 u64 msm_vidc_max_freq(struct msm_vidc_inst *inst);
 int msm_vidc_scale_power(struct msm_vidc_inst *inst, bool scale_buses);
+void msm_vidc_record_frame_submit(struct msm_vidc_inst *inst,
+	struct msm_vidc_buffer *buf, u64 timestamp);
+void msm_vidc_update_frame_time(struct msm_vidc_inst *inst,
+	struct msm_vidc_buffer *buf, u64 timestamp);
 void msm_vidc_power_data_reset(struct msm_vidc_inst *inst);
+u64 msm_vidc_thermal_max_freq(struct msm_vidc_core *core);
+void msm_vidc_advance_bw_window(struct msm_vidc_inst *inst, u64 now);
+void msm_vidc_get_bw_window(struct msm_vidc_inst *inst, u32 secs,
+	struct msm_vidc_bw_window_stats *ws);
 
 #endif
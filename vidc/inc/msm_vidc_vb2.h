@@ -13,6 +13,7 @@
 
 struct vb2_queue *msm_vidc_get_vb2q(struct msm_vidc_inst *inst,
 				    u32 type, const char *func);
+bool msm_vidc_is_queue_streaming(struct msm_vidc_inst *inst, u32 type);
 
 /* vb2_mem_ops */
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 15, 0))
@@ -14,6 +14,7 @@ struct reset_control;
 struct llcc_slice_desc;
 struct iommu_domain;
 struct device;
+struct firmware;
 struct msm_vidc_core;
 
 /*
@@ -110,11 +111,21 @@ enum msm_vidc_branch_mem_flags {
 	MSM_VIDC_CLKFLAG_PERIPH_OFF_CLEAR,
 };
 
+/* bucket 0 is no vote, the rest split (0, max_kbps] evenly */
+#define BW_RESIDENCY_BUCKETS 8
+
+struct bus_residency {
+	u64                        total_time_ns[BW_RESIDENCY_BUCKETS];
+	u64                        start_time_ns;
+	u32                        bucket;
+};
+
 struct bus_info {
 	struct icc_path           *icc;
 	const char                *name;
 	u32                        min_kbps;
 	u32                        max_kbps;
+	struct bus_residency       residency;
 };
 
 struct bus_set {
@@ -144,10 +155,8 @@ struct power_domain_set {
 };
 
 struct clock_residency {
-	struct list_head           list;
 	u64                        rate;
-	u64                        start_time_us;
-	u64                        total_time_us;
+	u64                        total_time_ns;
 };
 
 struct clock_info {
@@ -159,7 +168,11 @@ struct clock_info {
 #ifdef CONFIG_MSM_MMRM
 	struct mmrm_client        *mmrm_client;
 #endif
-	struct list_head           residency_list;  /* list of struct clock_residency */
+	/* indexed by freq_tbl position, last entry counts off-table rates */
+	struct clock_residency    *residency;
+	u32                        residency_count;
+	int                        residency_idx; /* -1 while clock is off */
+	u64                        residency_start_ns;
 };
 
 struct clock_set {
@@ -234,6 +247,16 @@ struct device_region_set {
 	u32                         count;
 };
 
+struct clock_scaling_stats {
+	u64                        requested;
+	u64                        coalesced;
+	u64                        clk_applied;
+	u64                        opp_applied;
+	u64                        opp_skipped;
+	u64                        clk_time_ns;
+	u64                        opp_time_ns;
+};
+
 struct msm_vidc_resource {
 	u8 __iomem                *register_base_addr;
 	u32                        irq;
@@ -247,6 +270,12 @@ struct msm_vidc_resource {
 	struct freq_set            freq_set;
 	struct device_region_set   device_region_set;
 	int                        fw_cookie;
+	/* firmware image and its carveout, kept across unload/reload */
+	const struct firmware     *fw_image;
+	phys_addr_t                fw_phys;
+	size_t                     fw_region_size;
+	unsigned long              opp_rate;
+	struct clock_scaling_stats scaling_stats;
 };
 
 #define call_res_op(c, op, ...)                  \
@@ -18,6 +18,12 @@
 
 #define VIDC_MAX_PC_SKIP_COUNT	10
 
+/* adaptive power collapse tunables */
+#define VIDC_PC_DEFAULT_RESUME_COST_MS	20
+#define VIDC_PC_BREAK_EVEN_FACTOR	10
+#define VIDC_PC_MIN_DELAY_DIV		4
+#define VIDC_PC_MAX_DELAY_MUL		2
+
 struct vidc_buffer_addr_info {
 	enum msm_vidc_buffer_type buffer_type;
 	u32 buffer_size;
@@ -28,17 +34,15 @@ struct vidc_buffer_addr_info {
 	u32 response_required;
 };
 
-struct hfi_pending_packet {
-	struct list_head       list;
-	void                  *data;
-};
-
 int __strict_check(struct msm_vidc_core *core,
 		   const char *function);
 int venus_hfi_session_property(struct msm_vidc_inst *inst,
 			       u32 pkt_type, u32 flags, u32 port,
 			       u32 payload_type, void *payload,
 			       u32 payload_size);
+void venus_hfi_session_property_batch_begin(struct msm_vidc_inst *inst);
+int venus_hfi_session_property_batch_end(struct msm_vidc_inst *inst,
+					 bool discard, u32 *sent);
 int venus_hfi_session_command(struct msm_vidc_inst *inst,
 			      u32 cmd, enum msm_vidc_port_type port,
 			      u32 payload_type,
@@ -61,6 +65,7 @@ int venus_hfi_session_resume(struct msm_vidc_inst *inst,
 int venus_hfi_session_drain(struct msm_vidc_inst *inst, enum msm_vidc_port_type port);
 int venus_hfi_session_set_codec(struct msm_vidc_inst *inst);
 int venus_hfi_session_set_secure_mode(struct msm_vidc_inst *inst);
+int venus_hfi_core_power_on(struct msm_vidc_core *core);
 int venus_hfi_core_init(struct msm_vidc_core *core);
 int venus_hfi_core_deinit(struct msm_vidc_core *core, bool force);
 int venus_hfi_noc_error_info(struct msm_vidc_core *core);
@@ -71,10 +76,12 @@ int venus_hfi_trigger_stability(struct msm_vidc_inst *inst, u32 type,
 				u32 client_id, u32 val);
 int venus_hfi_reserve_hardware(struct msm_vidc_inst *inst, u32 duration);
 int venus_hfi_scale_clocks(struct msm_vidc_inst *inst, u64 freq);
+int venus_hfi_reapply_clocks(struct msm_vidc_core *core);
 int venus_hfi_scale_buses(struct msm_vidc_inst *inst, u64 bw_ddr, u64 bw_llcc);
 int venus_hfi_set_ir_period(struct msm_vidc_inst *inst, u32 ir_type,
 			    enum msm_vidc_inst_capability_type cap_id);
 void venus_hfi_pm_work_handler(struct work_struct *work);
+void venus_hfi_clk_work_handler(struct work_struct *work);
 irqreturn_t venus_hfi_isr(int irq, void *data);
 irqreturn_t venus_hfi_isr_handler(int irq, void *data);
 int __prepare_pc(struct msm_vidc_core *core);
@@ -73,39 +73,26 @@ static int protect_cp_mem(struct msm_vidc_core *core)
 	return rc;
 }
 
-static int __load_fw_to_memory(struct platform_device *pdev,
-			       const char *fw_name)
+/*
+ * Request the image and look up the carveout once. Firmware is unloaded
+ * whenever the core goes idle, and redoing this on every reload costs a
+ * filesystem lookup and a full read of the image.
+ */
+static int __get_fw_image(struct msm_vidc_core *core,
+			  const char *firmware_name)
 {
-	int rc = 0;
+	struct msm_vidc_resource *res = core->resource;
+	struct platform_device *pdev = core->pdev;
 	const struct firmware *firmware = NULL;
-	struct msm_vidc_core *core;
-	char firmware_name[MAX_FIRMWARE_NAME_SIZE] = { 0 };
 	struct device_node *node = NULL;
-	struct resource res = { 0 };
-	phys_addr_t phys = 0;
-	size_t res_size = 0;
+	struct resource mem = { 0 };
 	ssize_t fw_size = 0;
-	void *virt = NULL;
-	int pas_id = 0;
-
-	if (!fw_name || !(*fw_name) || !pdev) {
-		d_vpr_e("%s: Invalid inputs\n", __func__);
-		return -EINVAL;
-	}
-	if (strlen(fw_name) >= MAX_FIRMWARE_NAME_SIZE - 4) {
-		d_vpr_e("%s: Invalid fw name\n", __func__);
-		return -EINVAL;
-	}
+	int rc = 0;
 
-	core = dev_get_drvdata(&pdev->dev);
-	if (!core) {
-		d_vpr_e("%s: core not found in device %s",
-			__func__, dev_name(&pdev->dev));
-		return -EINVAL;
+	if (res->fw_image) {
+		trace_msm_v4l2_vidc_core_init("FW_IMAGE_CACHED");
+		return 0;
 	}
-	scnprintf(firmware_name, ARRAY_SIZE(firmware_name), "%s.mbn", fw_name);
-
-	pas_id = core->platform->data.pas_id;
 
 	node = of_parse_phandle(pdev->dev.of_node, "memory-region", 0);
 	if (!node) {
@@ -114,66 +101,106 @@ static int __load_fw_to_memory(struct platform_device *pdev,
 		return -EINVAL;
 	}
 
-	rc = of_address_to_resource(node, 0, &res);
+	rc = of_address_to_resource(node, 0, &mem);
+	of_node_put(node);
 	if (rc) {
 		d_vpr_e("%s: failed to read \"memory-region\", error %d\n",
 			__func__, rc);
-		goto exit;
+		return rc;
 	}
-	phys = res.start;
-	res_size = (size_t)resource_size(&res);
 
 	rc = request_firmware(&firmware, firmware_name, &pdev->dev);
 	if (rc) {
 		d_vpr_e("%s: failed to request fw \"%s\", error %d\n",
 			__func__, firmware_name, rc);
-		goto exit;
+		return rc;
 	}
 
 	fw_size = qcom_mdt_get_size(firmware);
-	if (fw_size < 0 || res_size < (size_t)fw_size) {
-		rc = -EINVAL;
+	if (fw_size < 0 || (size_t)resource_size(&mem) < (size_t)fw_size) {
 		d_vpr_e("%s: out of bound fw image fw size: %ld, res_size: %lu",
-			__func__, fw_size, res_size);
-		goto exit;
+			__func__, fw_size, (size_t)resource_size(&mem));
+		release_firmware(firmware);
+		return -EINVAL;
+	}
+
+	res->fw_image = firmware;
+	res->fw_phys = mem.start;
+	res->fw_region_size = (size_t)resource_size(&mem);
+	trace_msm_v4l2_vidc_core_init("FW_IMAGE_REQUESTED");
+
+	return 0;
+}
+
+static int __load_fw_to_memory(struct platform_device *pdev,
+			       const char *fw_name)
+{
+	int rc = 0;
+	struct msm_vidc_core *core;
+	struct msm_vidc_resource *res;
+	char firmware_name[MAX_FIRMWARE_NAME_SIZE] = { 0 };
+	void *virt = NULL;
+	int pas_id = 0;
+
+	if (!fw_name || !(*fw_name) || !pdev) {
+		d_vpr_e("%s: Invalid inputs\n", __func__);
+		return -EINVAL;
+	}
+	if (strlen(fw_name) >= MAX_FIRMWARE_NAME_SIZE - 4) {
+		d_vpr_e("%s: Invalid fw name\n", __func__);
+		return -EINVAL;
+	}
+
+	core = dev_get_drvdata(&pdev->dev);
+	if (!core) {
+		d_vpr_e("%s: core not found in device %s",
+			__func__, dev_name(&pdev->dev));
+		return -EINVAL;
 	}
+	scnprintf(firmware_name, ARRAY_SIZE(firmware_name), "%s.mbn", fw_name);
 
-	virt = memremap(phys, res_size, MEMREMAP_WC);
+	pas_id = core->platform->data.pas_id;
+	res = core->resource;
+
+	rc = __get_fw_image(core, firmware_name);
+	if (rc)
+		return rc;
+
+	virt = memremap(res->fw_phys, res->fw_region_size, MEMREMAP_WC);
 	if (!virt) {
 		d_vpr_e("%s: failed to remap fw memory phys %pa[p]\n",
-			__func__, &phys);
+			__func__, &res->fw_phys);
 		return -ENOMEM;
 	}
 
 	/* prevent system suspend during fw_load */
 	pm_stay_awake(pdev->dev.parent);
-	rc = qcom_mdt_load(&pdev->dev, firmware, firmware_name,
-			   pas_id, virt, phys, res_size, NULL);
+	rc = qcom_mdt_load(&pdev->dev, res->fw_image, firmware_name,
+			   pas_id, virt, res->fw_phys, res->fw_region_size, NULL);
 	pm_relax(pdev->dev.parent);
 	if (rc) {
 		d_vpr_e("%s: error %d loading fw \"%s\"\n",
 			__func__, rc, firmware_name);
 		goto exit;
 	}
+	trace_msm_v4l2_vidc_core_init("FW_IMAGE_LOADED");
+
 	rc = qcom_scm_pas_auth_and_reset(pas_id);
 	if (rc) {
 		d_vpr_e("%s: error %d authenticating fw \"%s\"\n",
 			__func__, rc, firmware_name);
 		goto exit;
 	}
+	trace_msm_v4l2_vidc_core_init("FW_AUTHENTICATED");
 
 	memunmap(virt);
-	release_firmware(firmware);
 	d_vpr_h("%s: firmware \"%s\" loaded successfully\n",
 		__func__, firmware_name);
 
 	return pas_id;
 
 exit:
-	if (virt)
-		memunmap(virt);
-	if (firmware)
-		release_firmware(firmware);
+	memunmap(virt);
 
 	return rc;
 }
@@ -224,6 +251,15 @@ int fw_unload(struct msm_vidc_core *core)
 	return ret;
 }
 
+void fw_release(struct msm_vidc_core *core)
+{
+	if (!core->resource || !core->resource->fw_image)
+		return;
+
+	release_firmware(core->resource->fw_image);
+	core->resource->fw_image = NULL;
+}
+
 int fw_suspend(struct msm_vidc_core *core)
 {
 	return qcom_scm_set_remote_state(TZBSP_VIDEO_STATE_SUSPEND, 0);
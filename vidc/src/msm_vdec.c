@@ -804,6 +804,9 @@ static int msm_vdec_destroy_internal_buffers(struct msm_vidc_inst *inst,
 			 */
 			if (buf->attr & MSM_VIDC_ATTR_QUEUED)
 				continue;
+			/* keep buffers which still fit the new requirement */
+			if (buf->attr & MSM_VIDC_ATTR_REUSE)
+				continue;
 
 			i_vpr_h(inst,
 				"%s: destroying internal buffer: type %d idx %d fd %d addr %#llx size %d\n",
@@ -1085,7 +1088,7 @@ int msm_vdec_subscribe_metadata(struct msm_vidc_inst *inst,
 						__func__, count, sizeof(payload) / sizeof(u32));
 					return -EINVAL;
 				}
-				payload[count + 1] = inst->capabilities[i].hfi_id;
+				payload[count + 1] = inst->cap_table[i].hfi_id;
 				count++;
 			}
 		}
@@ -1100,7 +1103,7 @@ int msm_vdec_subscribe_metadata(struct msm_vidc_inst *inst,
 						__func__, count, sizeof(payload) / sizeof(u32));
 					return -EINVAL;
 				}
-				payload[count + 1] = inst->capabilities[i].hfi_id;
+				payload[count + 1] = inst->cap_table[i].hfi_id;
 				count++;
 			}
 		}
@@ -1141,7 +1144,7 @@ static int msm_vdec_set_delivery_mode_metadata(struct msm_vidc_inst *inst,
 						__func__, count, sizeof(payload) / sizeof(u32));
 					return -EINVAL;
 				}
-				payload[count + 1] = inst->capabilities[i].hfi_id;
+				payload[count + 1] = inst->cap_table[i].hfi_id;
 				count++;
 			}
 		}
@@ -1156,7 +1159,7 @@ static int msm_vdec_set_delivery_mode_metadata(struct msm_vidc_inst *inst,
 						__func__, count, sizeof(payload) / sizeof(u32));
 					return -EINVAL;
 				}
-				payload[count + 1] = inst->capabilities[i].hfi_id;
+				payload[count + 1] = inst->cap_table[i].hfi_id;
 				count++;
 			}
 		}
@@ -1937,52 +1940,52 @@ static int msm_vdec_release_eligible_buffers(struct msm_vidc_inst *inst)
 	return rc;
 }
 
+/* refresh the referenced slots from the latest dpb_list_payload */
+void msm_vdec_update_dpb_slots(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_dpb_slots *slots = &inst->dpb_slots;
+	DECLARE_BITMAP(dropped, MAX_DPB_SLOTS);
+
+	msm_vidc_dpb_slots_update(slots, inst->dpb_list_payload, dropped);
+
+	i_vpr_l(inst, "%s: dpb slots ref %*pb, dropped %*pb\n",
+		__func__, MAX_DPB_SLOTS, slots->ref, MAX_DPB_SLOTS, dropped);
+}
+
+/* check whether the read only buffer is part of the latest dpb list */
+static bool msm_vdec_is_dpb_referenced(struct msm_vidc_inst *inst,
+	struct msm_vidc_buffer *buf)
+{
+	buf->dpb_slot = msm_vidc_dpb_slots_find(&inst->dpb_slots, buf->dpb_slot,
+		buf->device_addr, buf->data_offset);
+
+	return buf->dpb_slot < MAX_DPB_SLOTS;
+}
+
 static int msm_vdec_release_nonref_buffers(struct msm_vidc_inst *inst)
 {
 	int rc = 0;
 	u32 fw_ro_count = 0, nonref_ro_count = 0;
 	struct msm_vidc_buffer *ro_buf;
-	int i = 0;
-	bool found = false;
-
-	/* count read_only buffers which are not pending release in read_only list */
-	list_for_each_entry(ro_buf, &inst->buffers.read_only.list, list) {
-		if (!(ro_buf->attr & MSM_VIDC_ATTR_READ_ONLY))
-			continue;
-		if (ro_buf->attr & MSM_VIDC_ATTR_PENDING_RELEASE)
-			continue;
-		fw_ro_count++;
-	}
-
-	if (fw_ro_count <= MAX_DPB_COUNT)
-		return 0;
 
 	/*
-	 * Mark those read only buffers present in read_only list as
-	 * non-reference if that buffer is not part of dpb_list_payload.
-	 * count such non-ref read only buffers as nonref_ro_count.
-	 * dpb_list_payload details:
-	 * payload[0-1]           : 64 bits base_address of DPB-1
-	 * payload[2]             : 32 bits addr_offset  of DPB-1
-	 * payload[3]             : 32 bits data_offset  of DPB-1
+	 * count read_only buffers which are not pending release in read_only
+	 * list, and among them the ones not part of the latest dpb list as
+	 * nonref_ro_count. The verdict is cached in ro_buf->dpb_slot for the
+	 * release walk below.
 	 */
 	list_for_each_entry(ro_buf, &inst->buffers.read_only.list, list) {
-		found = false;
 		if (!(ro_buf->attr & MSM_VIDC_ATTR_READ_ONLY))
 			continue;
 		if (ro_buf->attr & MSM_VIDC_ATTR_PENDING_RELEASE)
 			continue;
-		for (i = 0; (i + 3) < MAX_DPB_LIST_ARRAY_SIZE; i = i + 4) {
-			if (ro_buf->device_addr == inst->dpb_list_payload[i] &&
-				ro_buf->data_offset == inst->dpb_list_payload[i + 3]) {
-				found = true;
-				break;
-			}
-		}
-		if (!found)
+		fw_ro_count++;
+		if (!msm_vdec_is_dpb_referenced(inst, ro_buf))
 			nonref_ro_count++;
 	}
 
+	if (fw_ro_count <= MAX_DPB_COUNT)
+		return 0;
 
 	if (nonref_ro_count <= inst->buffers.output.min_count)
 		return 0;
@@ -1992,25 +1995,18 @@ static int msm_vdec_release_nonref_buffers(struct msm_vidc_inst *inst)
 
 	/* release the eligible buffers as per above condition */
 	list_for_each_entry(ro_buf, &inst->buffers.read_only.list, list) {
-		found = false;
 		if (!(ro_buf->attr & MSM_VIDC_ATTR_READ_ONLY))
 			continue;
 		if (ro_buf->attr & MSM_VIDC_ATTR_PENDING_RELEASE)
 			continue;
-		for (i = 0; (i + 3) < MAX_DPB_LIST_ARRAY_SIZE; i = i + 4) {
-			if (ro_buf->device_addr == inst->dpb_list_payload[i] &&
-				ro_buf->data_offset == inst->dpb_list_payload[i + 3]) {
-				found = true;
-				break;
-			}
-		}
-		if (!found) {
-			ro_buf->attr |= MSM_VIDC_ATTR_PENDING_RELEASE;
-			print_vidc_buffer(VIDC_LOW, "low ", "release buf", inst, ro_buf);
-			rc = venus_hfi_release_buffer(inst, ro_buf);
-			if (rc)
-				return rc;
-		}
+		if (ro_buf->dpb_slot < MAX_DPB_SLOTS)
+			continue;
+
+		ro_buf->attr |= MSM_VIDC_ATTR_PENDING_RELEASE;
+		print_vidc_buffer(VIDC_LOW, "low ", "release buf", inst, ro_buf);
+		rc = venus_hfi_release_buffer(inst, ro_buf);
+		if (rc)
+			return rc;
 	}
 
 	return rc;
@@ -2083,7 +2079,7 @@ static int msm_vdec_alloc_and_queue_additional_dpb_buffers(struct msm_vidc_inst
 
 	/* allocate additional DPB buffers */
 	for (i = cur_min_count; i < buffers->min_count; i++) {
-		rc = msm_vidc_create_internal_buffer(inst, MSM_VIDC_BUF_DPB, i);
+		rc = msm_vidc_create_internal_buffer(inst, MSM_VIDC_BUF_DPB);
 		if (rc)
 			return rc;
 	}
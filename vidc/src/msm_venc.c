@@ -444,9 +444,9 @@ static int msm_venc_set_quality_mode(struct msm_vidc_inst *inst)
 static int msm_venc_set_ring_buffer_count(struct msm_vidc_inst *inst)
 {
 	int rc = 0;
-	struct msm_vidc_inst_cap *cap;
+	const struct msm_vidc_inst_cap *cap;
 
-	cap = &inst->capabilities[ENC_RING_BUFFER_COUNT];
+	cap = &inst->cap_table[ENC_RING_BUFFER_COUNT];
 
 	if (!cap->set)
 		return 0;
@@ -584,6 +584,10 @@ static int msm_venc_destroy_internal_buffers(struct msm_vidc_inst *inst,
 		}
 
 		list_for_each_entry_safe(buf, dummy, &buffers->list, list) {
+			/* keep buffers which still fit the new requirement */
+			if (buf->attr & MSM_VIDC_ATTR_REUSE)
+				continue;
+
 			i_vpr_h(inst,
 				"%s: destroying internal buffer: type %d idx %d fd %d addr %#llx size %d\n",
 				__func__, buf->type, buf->index, buf->fd,
@@ -726,7 +730,7 @@ static int msm_venc_metadata_delivery(struct msm_vidc_inst *inst,
 						__func__, count, sizeof(payload) / sizeof(u32));
 					return -EINVAL;
 				}
-				payload[count + 1] = inst->capabilities[i].hfi_id;
+				payload[count + 1] = inst->cap_table[i].hfi_id;
 				count++;
 			}
 		}
@@ -739,7 +743,7 @@ static int msm_venc_metadata_delivery(struct msm_vidc_inst *inst,
 						__func__, count, sizeof(payload) / sizeof(u32));
 					return -EINVAL;
 				}
-				payload[count + 1] = inst->capabilities[i].hfi_id;
+				payload[count + 1] = inst->cap_table[i].hfi_id;
 				count++;
 			}
 		}
@@ -784,7 +788,7 @@ static int msm_venc_dynamic_metadata_delivery(struct msm_vidc_inst *inst,
 					__func__, count, sizeof(payload) / sizeof(u32));
 				return -EINVAL;
 			}
-			payload[count + 1] = inst->capabilities[i].hfi_id;
+			payload[count + 1] = inst->cap_table[i].hfi_id;
 			count++;
 		}
 	}
@@ -821,7 +825,7 @@ static int msm_venc_metadata_subscription(struct msm_vidc_inst *inst,
 						__func__, count, sizeof(payload) / sizeof(u32));
 					return -EINVAL;
 				}
-				payload[count + 1] = inst->capabilities[i].hfi_id;
+				payload[count + 1] = inst->cap_table[i].hfi_id;
 				count++;
 			}
 		}
@@ -834,7 +838,7 @@ static int msm_venc_metadata_subscription(struct msm_vidc_inst *inst,
 						__func__, count, sizeof(payload) / sizeof(u32));
 					return -EINVAL;
 				}
-				payload[count + 1] = inst->capabilities[i].hfi_id;
+				payload[count + 1] = inst->cap_table[i].hfi_id;
 				count++;
 			}
 		}
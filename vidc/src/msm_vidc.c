@@ -22,6 +22,7 @@
 #include "msm_vidc_memory.h"
 #include "venus_hfi_response.h"
 #include "msm_vidc.h"
+#include "msm_vidc_events.h"
 
 extern const char video_banner[];
 
@@ -444,6 +445,9 @@ int msm_vidc_dqbuf(struct msm_vidc_inst *inst, struct v4l2_buffer *b)
 		i_vpr_l(inst, "%s: failed with %d\n", __func__, rc);
 		goto exit;
 	}
+	trace_msm_vidc_buffer_stage(inst, MSM_VIDC_BUF_STAGE_DQBUF,
+		v4l2_type_to_driver(b->type, __func__), b->index, 0,
+		v4l2_buffer_get_timestamp(b), 0);
 
 exit:
 	return rc;
@@ -701,7 +705,6 @@ void *msm_vidc_open(struct msm_vidc_core *core, u32 session_type)
 {
 	int rc = 0;
 	struct msm_vidc_inst *inst = NULL;
-	int i = 0;
 
 	d_vpr_h("%s: %s\n", __func__, video_banner);
 
@@ -720,7 +723,7 @@ void *msm_vidc_open(struct msm_vidc_core *core, u32 session_type)
 	if (rc)
 		return NULL;
 
-	inst = vzalloc(sizeof(*inst));
+	inst = msm_vidc_get_inst_shell(core);
 	if (!inst) {
 		d_vpr_e("%s: allocation failed\n", __func__);
 		return NULL;
@@ -742,9 +745,6 @@ void *msm_vidc_open(struct msm_vidc_core *core, u32 session_type)
 	inst->auto_framerate = DEFAULT_FPS << 16;
 	inst->initial_time_us = ktime_get_ns() / 1000;
 	kref_init(&inst->kref);
-	mutex_init(&inst->lock);
-	mutex_init(&inst->ctx_q_lock);
-	mutex_init(&inst->client_lock);
 	msm_vidc_update_debug_str(inst);
 	i_vpr_h(inst, "Opening video instance: %d\n", session_type);
 
@@ -759,51 +759,6 @@ void *msm_vidc_open(struct msm_vidc_core *core, u32 session_type)
 		i_vpr_e(inst, "%s: failed to init pool buffers\n", __func__);
 		goto fail_pools_init;
 	}
-	INIT_LIST_HEAD(&inst->caps_list);
-	INIT_LIST_HEAD(&inst->timestamps.list);
-	INIT_LIST_HEAD(&inst->ts_reorder.list);
-	INIT_LIST_HEAD(&inst->buffers.input.list);
-	INIT_LIST_HEAD(&inst->buffers.input_meta.list);
-	INIT_LIST_HEAD(&inst->buffers.output.list);
-	INIT_LIST_HEAD(&inst->buffers.output_meta.list);
-	INIT_LIST_HEAD(&inst->buffers.read_only.list);
-	INIT_LIST_HEAD(&inst->buffers.bin.list);
-	INIT_LIST_HEAD(&inst->buffers.arp.list);
-	INIT_LIST_HEAD(&inst->buffers.comv.list);
-	INIT_LIST_HEAD(&inst->buffers.non_comv.list);
-	INIT_LIST_HEAD(&inst->buffers.line.list);
-	INIT_LIST_HEAD(&inst->buffers.dpb.list);
-	INIT_LIST_HEAD(&inst->buffers.persist.list);
-	INIT_LIST_HEAD(&inst->buffers.vpss.list);
-	INIT_LIST_HEAD(&inst->buffers.partial_data.list);
-	INIT_LIST_HEAD(&inst->mem_info.bin.list);
-	INIT_LIST_HEAD(&inst->mem_info.arp.list);
-	INIT_LIST_HEAD(&inst->mem_info.comv.list);
-	INIT_LIST_HEAD(&inst->mem_info.non_comv.list);
-	INIT_LIST_HEAD(&inst->mem_info.line.list);
-	INIT_LIST_HEAD(&inst->mem_info.dpb.list);
-	INIT_LIST_HEAD(&inst->mem_info.persist.list);
-	INIT_LIST_HEAD(&inst->mem_info.vpss.list);
-	INIT_LIST_HEAD(&inst->mem_info.partial_data.list);
-	INIT_LIST_HEAD(&inst->children_list);
-	INIT_LIST_HEAD(&inst->firmware_list);
-	INIT_LIST_HEAD(&inst->enc_input_crs);
-	INIT_LIST_HEAD(&inst->dmabuf_tracker);
-	INIT_LIST_HEAD(&inst->input_timer_list);
-	INIT_LIST_HEAD(&inst->pending_pkts);
-	INIT_LIST_HEAD(&inst->fence_list);
-	INIT_LIST_HEAD(&inst->buffer_stats_list);
-	for (i = 0; i < MAX_SIGNAL; i++)
-		init_completion(&inst->completions[i]);
-
-	inst->workq = create_singlethread_workqueue("workq");
-	if (!inst->workq) {
-		i_vpr_e(inst, "%s: create workq failed\n", __func__);
-		goto fail_create_workq;
-	}
-
-	INIT_DELAYED_WORK(&inst->stats_work, msm_vidc_stats_handler);
-	INIT_WORK(&inst->stability_work, msm_vidc_stability_handler);
 
 	rc = msm_vidc_v4l2_fh_init(inst);
 	if (rc)
@@ -824,9 +779,6 @@ void *msm_vidc_open(struct msm_vidc_core *core, u32 session_type)
 	if (rc)
 		goto fail_fence_init;
 
-	/* reset clock residency stats */
-	msm_vidc_reset_residency_stats(core);
-
 	msm_vidc_scale_power(inst, true);
 
 	rc = msm_vidc_session_open(inst);
@@ -835,10 +787,8 @@ void *msm_vidc_open(struct msm_vidc_core *core, u32 session_type)
 		goto fail_session_open;
 	}
 
-	inst->debugfs_root =
-		msm_vidc_debugfs_init_inst(inst, core->debugfs_root);
-	if (!inst->debugfs_root)
-		i_vpr_h(inst, "%s: debugfs not available\n", __func__);
+	/* debugfs is not needed to stream, create it off the open path */
+	msm_vidc_queue_inst_work(inst, MSM_VIDC_INST_WORK_DEBUGFS);
 
 	return inst;
 
@@ -854,17 +804,12 @@ fail_inst_init:
 fail_vb2q_init:
 	msm_vidc_v4l2_fh_deinit(inst);
 fail_eventq_init:
-	destroy_workqueue(inst->workq);
-fail_create_workq:
 	msm_vidc_pools_deinit(inst);
 fail_pools_init:
 	msm_vidc_remove_session(inst);
 	msm_vidc_remove_dangling_session(inst);
 fail_add_session:
-	mutex_destroy(&inst->client_lock);
-	mutex_destroy(&inst->ctx_q_lock);
-	mutex_destroy(&inst->lock);
-	vfree(inst);
+	msm_vidc_free_inst_shell(inst);
 	return NULL;
 }
 
@@ -882,6 +827,7 @@ int msm_vidc_close(struct msm_vidc_inst *inst)
 	msm_vidc_print_stats(inst);
 	/* print internal buffer memory usage stats */
 	msm_vidc_print_memory_stats(inst);
+	msm_vidc_flush_input_fences(inst);
 	msm_vidc_print_residency_stats(core);
 	msm_vidc_session_close(inst);
 	msm_vidc_change_state(inst, MSM_VIDC_CLOSE, __func__);
@@ -890,7 +836,7 @@ int msm_vidc_close(struct msm_vidc_inst *inst)
 	inst_unlock(inst, __func__);
 	client_unlock(inst, __func__);
 	cancel_stability_work_sync(inst);
-	cancel_stats_work_sync(inst);
+	msm_vidc_cancel_inst_work(inst);
 	msm_vidc_show_stats(inst);
 	put_inst(inst);
 	msm_vidc_schedule_core_deinit(core);
@@ -10,6 +10,7 @@
 #include "msm_vidc_control.h"
 #include "msm_vidc_platform.h"
 #include "msm_vidc_internal.h"
+#include "venus_hfi.h"
 
 extern struct msm_vidc_core *g_core;
 
@@ -138,12 +139,12 @@ static const char * const *msm_vidc_get_qmenu_type(
 	}
 }
 
-static inline bool has_children(struct msm_vidc_inst_cap *cap)
+static inline bool has_children(const struct msm_vidc_inst_cap *cap)
 {
 	return !!cap->children[0];
 }
 
-static inline bool is_leaf(struct msm_vidc_inst_cap *cap)
+static inline bool is_leaf(const struct msm_vidc_inst_cap *cap)
 {
 	return !has_children(cap);
 }
@@ -159,11 +160,11 @@ bool is_valid_cap(struct msm_vidc_inst *inst,
 	if (cap_id <= INST_CAP_NONE || cap_id >= INST_CAP_MAX)
 		return false;
 
-	return !!inst->capabilities[cap_id].cap_id;
+	return inst->cap_table && !!inst->cap_table[cap_id].cap_id;
 }
 
 static inline bool is_all_childrens_visited(
-	struct msm_vidc_inst_cap *cap, bool lookup[INST_CAP_MAX]) {
+	const struct msm_vidc_inst_cap *cap, bool lookup[INST_CAP_MAX]) {
 	bool found = true;
 	int i;
 
@@ -198,7 +199,7 @@ static int add_node_list(struct list_head *list, enum msm_vidc_inst_capability_t
 }
 
 static int add_node(
-	struct list_head *list, struct msm_vidc_inst_cap *lcap, bool lookup[INST_CAP_MAX])
+	struct list_head *list, const struct msm_vidc_inst_cap *lcap, bool lookup[INST_CAP_MAX])
 {
 	int rc = 0;
 
@@ -215,36 +216,13 @@ static int add_node(
 
 
 
-static int msm_vidc_add_capid_to_fw_list(struct msm_vidc_inst *inst,
-	enum msm_vidc_inst_capability_type cap_id)
-{
-	struct msm_vidc_inst_cap_entry *entry = NULL;
-	int rc = 0;
-
-	/* skip adding if cap_id already present in firmware list */
-	list_for_each_entry(entry, &inst->firmware_list, list) {
-		if (entry->cap_id == cap_id) {
-			i_vpr_l(inst,
-				"%s: cap[%d] %s already present in fw list\n",
-				__func__, cap_id, cap_name(cap_id));
-			return 0;
-		}
-	}
-
-	rc = add_node_list(&inst->firmware_list, cap_id);
-	if (rc)
-		return rc;
-
-	return 0;
-}
-
-static int msm_vidc_add_children(struct msm_vidc_inst *inst,
-	enum msm_vidc_inst_capability_type cap_id)
+static void msm_vidc_add_children(struct msm_vidc_inst *inst,
+	enum msm_vidc_inst_capability_type cap_id, unsigned long *pending)
 {
-	struct msm_vidc_inst_cap *cap;
-	int i, rc = 0;
+	const struct msm_vidc_inst_cap *cap;
+	int i;
 
-	cap = &inst->capabilities[cap_id];
+	cap = &inst->cap_table[cap_id];
 
 	for (i = 0; i < MAX_CAP_CHILDREN; i++) {
 		if (!cap->children[i])
@@ -253,19 +231,15 @@ static int msm_vidc_add_children(struct msm_vidc_inst *inst,
 		if (!is_valid_cap_id(cap->children[i]))
 			continue;
 
-		rc = add_node_list(&inst->children_list, cap->children[i]);
-		if (rc)
-			return rc;
+		set_bit(cap->children[i], pending);
 	}
-
-	return rc;
 }
 
 static int msm_vidc_adjust_cap(struct msm_vidc_inst *inst,
 	enum msm_vidc_inst_capability_type cap_id,
 	struct v4l2_ctrl *ctrl, const char *func)
 {
-	struct msm_vidc_inst_cap *cap;
+	const struct msm_vidc_inst_cap *cap;
 	int rc = 0;
 
 	/* validate cap_id */
@@ -273,7 +247,7 @@ static int msm_vidc_adjust_cap(struct msm_vidc_inst *inst,
 		return 0;
 
 	/* validate cap */
-	cap = &inst->capabilities[cap_id];
+	cap = &inst->cap_table[cap_id];
 	if (!is_valid_cap(inst, cap->cap_id))
 		return 0;
 
@@ -298,7 +272,7 @@ static int msm_vidc_set_cap(struct msm_vidc_inst *inst,
 	enum msm_vidc_inst_capability_type cap_id,
 	const char *func)
 {
-	struct msm_vidc_inst_cap *cap;
+	const struct msm_vidc_inst_cap *cap;
 	int rc = 0;
 
 	/* validate cap_id */
@@ -306,7 +280,7 @@ static int msm_vidc_set_cap(struct msm_vidc_inst *inst,
 		return 0;
 
 	/* validate cap */
-	cap = &inst->capabilities[cap_id];
+	cap = &inst->cap_table[cap_id];
 	if (!is_valid_cap(inst, cap->cap_id))
 		return 0;
 
@@ -324,12 +298,19 @@ static int msm_vidc_set_cap(struct msm_vidc_inst *inst,
 	return rc;
 }
 
+/*
+ * Children of a modified cap are marked in a bitmap and adjusted in
+ * caps_list order, which has every parent ahead of its children, so a
+ * single forward walk from cap_id reaches the whole affected subgraph.
+ */
 static int msm_vidc_adjust_dynamic_property(struct msm_vidc_inst *inst,
 	enum msm_vidc_inst_capability_type cap_id, struct v4l2_ctrl *ctrl)
 {
-	struct msm_vidc_inst_cap_entry *entry = NULL, *temp = NULL;
-	struct msm_vidc_inst_cap *cap;
+	DECLARE_BITMAP(pending, INST_CAP_MAX);
+	struct msm_vidc_inst_cap_state *cap;
+	enum msm_vidc_inst_capability_type child;
 	s32 prev_value;
+	u32 pos;
 	int rc = 0;
 
 	cap = &inst->capabilities[0];
@@ -362,98 +343,75 @@ static int msm_vidc_adjust_dynamic_property(struct msm_vidc_inst *inst,
 	}
 
 	/* add cap_id to firmware list always */
-	rc = msm_vidc_add_capid_to_fw_list(inst, cap_id);
-	if (rc)
-		goto error;
+	set_bit(cap_id, inst->firmware_pending);
 
 	/* add children only if cap value modified */
 	if (cap[cap_id].value == prev_value)
 		return 0;
 
-	rc = msm_vidc_add_children(inst, cap_id);
-	if (rc)
-		goto error;
+	bitmap_zero(pending, INST_CAP_MAX);
+	msm_vidc_add_children(inst, cap_id, pending);
 
-	list_for_each_entry_safe(entry, temp, &inst->children_list, list) {
-		if (!is_valid_cap_id(entry->cap_id)) {
-			rc = -EINVAL;
-			goto error;
-		}
+	for (pos = inst->cap_order_pos[cap_id] + 1;
+	     pos < inst->cap_order_count && !bitmap_empty(pending, INST_CAP_MAX);
+	     pos++) {
+		child = inst->cap_order[pos];
+		if (!test_and_clear_bit(child, pending))
+			continue;
 
-		if (!cap[entry->cap_id].adjust) {
+		if (!inst->cap_table[child].adjust) {
 			i_vpr_e(inst, "%s: child cap must have ajdust function %s\n",
-				__func__, cap_name(entry->cap_id));
+				__func__, cap_name(child));
 			rc = -EINVAL;
 			goto error;
 		}
 
-		prev_value = cap[entry->cap_id].value;
-		rc = msm_vidc_adjust_cap(inst, entry->cap_id, NULL, __func__);
+		prev_value = cap[child].value;
+		rc = msm_vidc_adjust_cap(inst, child, NULL, __func__);
 		if (rc)
 			goto error;
 
 		/* add children if cap value modified */
-		if (cap[entry->cap_id].value != prev_value) {
-			/* add cap_id to firmware list always */
-			rc = msm_vidc_add_capid_to_fw_list(inst, entry->cap_id);
-			if (rc)
-				goto error;
-
-			rc = msm_vidc_add_children(inst, entry->cap_id);
-			if (rc)
-				goto error;
+		if (cap[child].value != prev_value) {
+			set_bit(child, inst->firmware_pending);
+			msm_vidc_add_children(inst, child, pending);
 		}
-
-		list_del_init(&entry->list);
-		vfree(entry);
 	}
 
-	/* expecting children_list to be empty */
-	if (!list_empty(&inst->children_list)) {
-		i_vpr_e(inst, "%s: child_list is not empty\n", __func__);
+	/* every marked child must have been reached */
+	if (!bitmap_empty(pending, INST_CAP_MAX)) {
+		i_vpr_e(inst, "%s: child caps out of dependency order: %*pbl\n",
+			__func__, INST_CAP_MAX, pending);
 		rc = -EINVAL;
 		goto error;
 	}
 
 	return 0;
 error:
-	list_for_each_entry_safe(entry, temp, &inst->children_list, list) {
-		i_vpr_e(inst, "%s: child list: %s\n", __func__, cap_name(entry->cap_id));
-		list_del_init(&entry->list);
-		vfree(entry);
-	}
-	list_for_each_entry_safe(entry, temp, &inst->firmware_list, list) {
-		i_vpr_e(inst, "%s: fw list: %s\n", __func__, cap_name(entry->cap_id));
-		list_del_init(&entry->list);
-		vfree(entry);
-	}
+	bitmap_zero(inst->firmware_pending, INST_CAP_MAX);
 
 	return rc;
 }
 
 static int msm_vidc_set_dynamic_property(struct msm_vidc_inst *inst)
 {
-	struct msm_vidc_inst_cap_entry *entry = NULL, *temp = NULL;
+	enum msm_vidc_inst_capability_type cap_id;
+	u32 pos;
 	int rc = 0;
 
 	i_vpr_h(inst, "%s()\n", __func__);
 
-	list_for_each_entry_safe(entry, temp, &inst->firmware_list, list) {
-		rc = msm_vidc_set_cap(inst, entry->cap_id, __func__);
-		if (rc)
-			goto error;
-
-		list_del_init(&entry->list);
-		vfree(entry);
-	}
+	for (pos = 0; pos < inst->cap_order_count &&
+	     !bitmap_empty(inst->firmware_pending, INST_CAP_MAX); pos++) {
+		cap_id = inst->cap_order[pos];
+		if (!test_and_clear_bit(cap_id, inst->firmware_pending))
+			continue;
 
-	return 0;
-error:
-	list_for_each_entry_safe(entry, temp, &inst->firmware_list, list) {
-		i_vpr_e(inst, "%s: fw list: %s\n", __func__, cap_name(entry->cap_id));
-		list_del_init(&entry->list);
-		vfree(entry);
+		rc = msm_vidc_set_cap(inst, cap_id, __func__);
+		if (rc)
+			break;
 	}
+	bitmap_zero(inst->firmware_pending, INST_CAP_MAX);
 
 	return rc;
 }
@@ -470,7 +428,8 @@ int msm_vidc_ctrl_handler_deinit(struct msm_vidc_inst *inst)
 int msm_vidc_ctrl_handler_init(struct msm_vidc_inst *inst, bool init)
 {
 	int rc = 0;
-	struct msm_vidc_inst_cap *cap;
+	struct msm_vidc_inst_cap_state *cap;
+	const struct msm_vidc_inst_cap *tbl;
 	struct msm_vidc_core *core;
 	int idx = 0;
 	struct v4l2_ctrl_config ctrl_cfg = {0};
@@ -479,6 +438,7 @@ int msm_vidc_ctrl_handler_init(struct msm_vidc_inst *inst, bool init)
 
 	core = inst->core;
 	cap = &inst->capabilities[0];
+	tbl = inst->cap_table;
 
 	if (!core->v4l2_ctrl_ops) {
 		i_vpr_e(inst, "%s: no control ops\n", __func__);
@@ -486,7 +446,7 @@ int msm_vidc_ctrl_handler_init(struct msm_vidc_inst *inst, bool init)
 	}
 
 	for (idx = 0; idx < INST_CAP_MAX; idx++) {
-		if (cap[idx].v4l2_id)
+		if (tbl[idx].v4l2_id)
 			num_ctrls++;
 	}
 	if (!num_ctrls) {
@@ -511,13 +471,13 @@ int msm_vidc_ctrl_handler_init(struct msm_vidc_inst *inst, bool init)
 	for (idx = 0; idx < INST_CAP_MAX; idx++) {
 		struct v4l2_ctrl *ctrl;
 
-		if (!cap[idx].v4l2_id)
+		if (!tbl[idx].v4l2_id)
 			continue;
 
 		if (ctrl_idx >= num_ctrls) {
 			i_vpr_e(inst,
 				"%s: invalid ctrl %#x, max allowed %d\n",
-				__func__, cap[idx].v4l2_id,
+				__func__, tbl[idx].v4l2_id,
 				num_ctrls);
 			rc = -EINVAL;
 			goto error;
@@ -530,8 +490,8 @@ int msm_vidc_ctrl_handler_init(struct msm_vidc_inst *inst, bool init)
 			cap[idx].max,
 			cap[idx].step_or_mask,
 			cap[idx].flags,
-			cap[idx].v4l2_id,
-			cap[idx].hfi_id);
+			tbl[idx].v4l2_id,
+			tbl[idx].hfi_id);
 
 		memset(&ctrl_cfg, 0, sizeof(struct v4l2_ctrl_config));
 
@@ -542,7 +502,7 @@ int msm_vidc_ctrl_handler_init(struct msm_vidc_inst *inst, bool init)
 		if (!init) {
 			struct msm_vidc_ctrl_data ctrl_priv_data;
 
-			ctrl = v4l2_ctrl_find(&inst->ctrl_handler, cap[idx].v4l2_id);
+			ctrl = v4l2_ctrl_find(&inst->ctrl_handler, tbl[idx].v4l2_id);
 			if (ctrl) {
 				step_or_mask = (cap[idx].flags & CAP_FLAG_MENU) ?
 					~(cap[idx].step_or_mask) :
@@ -561,11 +521,11 @@ int msm_vidc_ctrl_handler_init(struct msm_vidc_inst *inst, bool init)
 			}
 		}
 
-		if (is_priv_ctrl(cap[idx].v4l2_id)) {
+		if (is_priv_ctrl(tbl[idx].v4l2_id)) {
 			/* add private control */
 			ctrl_cfg.def = cap[idx].value;
 			ctrl_cfg.flags = 0;
-			ctrl_cfg.id = cap[idx].v4l2_id;
+			ctrl_cfg.id = tbl[idx].v4l2_id;
 			ctrl_cfg.max = cap[idx].max;
 			ctrl_cfg.min = cap[idx].min;
 			ctrl_cfg.ops = core->v4l2_ctrl_ops;
@@ -589,12 +549,12 @@ int msm_vidc_ctrl_handler_init(struct msm_vidc_inst *inst, bool init)
 				ctrl_cfg.menu_skip_mask =
 					~(cap[idx].step_or_mask);
 				ctrl_cfg.qmenu = msm_vidc_get_qmenu_type(inst,
-					cap[idx].cap_id);
+					tbl[idx].cap_id);
 			} else {
 				ctrl_cfg.step =
 					cap[idx].step_or_mask;
 			}
-			ctrl_cfg.name = cap_name(cap[idx].cap_id);
+			ctrl_cfg.name = cap_name(tbl[idx].cap_id);
 			if (!ctrl_cfg.name) {
 				i_vpr_e(inst, "%s: %#x ctrl name is null\n",
 					__func__, ctrl_cfg.id);
@@ -608,14 +568,14 @@ int msm_vidc_ctrl_handler_init(struct msm_vidc_inst *inst, bool init)
 				ctrl = v4l2_ctrl_new_std_menu(
 					&inst->ctrl_handler,
 					core->v4l2_ctrl_ops,
-					cap[idx].v4l2_id,
+					tbl[idx].v4l2_id,
 					cap[idx].max,
 					~(cap[idx].step_or_mask),
 					cap[idx].value);
 			} else {
 				ctrl = v4l2_ctrl_new_std(&inst->ctrl_handler,
 					core->v4l2_ctrl_ops,
-					cap[idx].v4l2_id,
+					tbl[idx].v4l2_id,
 					cap[idx].min,
 					cap[idx].max,
 					cap[idx].step_or_mask,
@@ -624,7 +584,7 @@ int msm_vidc_ctrl_handler_init(struct msm_vidc_inst *inst, bool init)
 		}
 		if (!ctrl) {
 			i_vpr_e(inst, "%s: invalid ctrl %#x cap %24s\n", __func__,
-				cap[idx].v4l2_id, cap_name(idx));
+				tbl[idx].v4l2_id, cap_name(idx));
 			rc = -EINVAL;
 			goto error;
 		}
@@ -633,7 +593,7 @@ int msm_vidc_ctrl_handler_init(struct msm_vidc_inst *inst, bool init)
 		if (rc) {
 			i_vpr_e(inst,
 				"error adding ctrl (%#x) to ctrl handle, %d\n",
-				cap[idx].v4l2_id,
+				tbl[idx].v4l2_id,
 				inst->ctrl_handler.error);
 			goto error;
 		}
@@ -737,7 +697,7 @@ int msm_v4l2_op_g_volatile_ctrl(struct v4l2_ctrl *ctrl)
 		return -EINVAL;
 	}
 	client_lock(inst, __func__);
-	inst_lock(inst, __func__);
+	ctrl_lock(inst, __func__);
 
 	rc = msm_vidc_get_control(inst, ctrl);
 	if (rc) {
@@ -750,7 +710,7 @@ int msm_v4l2_op_g_volatile_ctrl(struct v4l2_ctrl *ctrl)
 	}
 
 unlock:
-	inst_unlock(inst, __func__);
+	ctrl_unlock(inst, __func__);
 	client_unlock(inst, __func__);
 	put_inst(inst);
 	return rc;
@@ -845,7 +805,7 @@ static int msm_vidc_update_static_property(struct msm_vidc_inst *inst,
 int msm_vidc_s_ctrl(struct msm_vidc_inst *inst, struct v4l2_ctrl *ctrl)
 {
 	enum msm_vidc_inst_capability_type cap_id;
-	struct msm_vidc_inst_cap *cap;
+	struct msm_vidc_inst_cap_state *cap;
 	int rc = 0;
 	u32 port;
 
@@ -913,13 +873,13 @@ int msm_v4l2_op_s_ctrl(struct v4l2_ctrl *ctrl)
 	}
 
 	client_lock(inst, __func__);
-	inst_lock(inst, __func__);
+	ctrl_lock(inst, __func__);
 	rc = inst->event_handle(inst, MSM_VIDC_S_CTRL, ctrl);
 	if (rc)
 		goto unlock;
 
 unlock:
-	inst_unlock(inst, __func__);
+	ctrl_unlock(inst, __func__);
 	client_unlock(inst, __func__);
 	put_inst(inst);
 	return rc;
@@ -928,14 +888,14 @@ unlock:
 int msm_vidc_prepare_dependency_list(struct msm_vidc_inst *inst)
 {
 	struct list_head leaf_list, opt_list;
-	struct msm_vidc_inst_cap *cap, *lcap, *temp_cap;
+	const struct msm_vidc_inst_cap *cap, *lcap, *temp_cap;
 	struct msm_vidc_inst_cap_entry *entry = NULL, *temp = NULL;
 	bool leaf_visited[INST_CAP_MAX];
 	bool opt_visited[INST_CAP_MAX];
 	int tmp_count_total, tmp_count, num_nodes = 0;
 	int i, rc = 0;
 
-	cap = &inst->capabilities[0];
+	cap = inst->cap_table;
 
 	if (!list_empty(&inst->caps_list)) {
 		i_vpr_h(inst, "%s: dependency list already prepared\n", __func__);
@@ -1026,6 +986,13 @@ int msm_vidc_prepare_dependency_list(struct msm_vidc_inst *inst)
 	/* move elements to &inst->caps_list from local */
 	list_replace_init(&leaf_list, &inst->caps_list);
 
+	/* flat copy of the order for dynamic propagation */
+	inst->cap_order_count = 0;
+	list_for_each_entry(entry, &inst->caps_list, list) {
+		inst->cap_order_pos[entry->cap_id] = inst->cap_order_count;
+		inst->cap_order[inst->cap_order_count++] = entry->cap_id;
+	}
+
 	return 0;
 error:
 	list_for_each_entry_safe(entry, temp, &opt_list, list) {
@@ -1064,15 +1031,37 @@ int msm_vidc_adjust_v4l2_properties(struct msm_vidc_inst *inst)
 int msm_vidc_set_v4l2_properties(struct msm_vidc_inst *inst)
 {
 	struct msm_vidc_inst_cap_entry *entry = NULL, *temp = NULL;
+	u32 sent = 0;
 	int rc = 0;
 
 	i_vpr_h(inst, "%s()\n", __func__);
 
+	/* thumbnail sessions are short lived, send all properties at once */
+	if (is_thumbnail_session(inst))
+		venus_hfi_session_property_batch_begin(inst);
+
 	/* set all caps from caps_list */
 	list_for_each_entry_safe(entry, temp, &inst->caps_list, list) {
 		rc = msm_vidc_set_cap(inst, entry->cap_id, __func__);
 		if (rc)
-			return rc;
+			break;
+	}
+
+	if (is_thumbnail_session(inst)) {
+		/*
+		 * drop the partial batch on failure. Chunks of a batch which
+		 * outgrew the packet may already be with firmware.
+		 */
+		if (rc) {
+			venus_hfi_session_property_batch_end(inst, true, &sent);
+			i_vpr_e(inst, "%s: failed after %u batched properties sent\n",
+				__func__, sent);
+		} else {
+			rc = venus_hfi_session_property_batch_end(inst, false, &sent);
+			if (rc)
+				i_vpr_e(inst, "%s: batch failed, %u properties sent\n",
+					__func__, sent);
+		}
 	}
 
 	return rc;
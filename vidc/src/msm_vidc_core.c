@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2020-2021, The Linux Foundation. All rights reserved.
+ * Copyright (c) 2022-2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#include "msm_vidc_core.h"
+#include "msm_vidc_driver.h"
+#include "msm_vidc_state.h"
+#include "msm_vidc_debug.h"
+#include "msm_vidc_events.h"
+#include "venus_hfi.h"
+#include "firmware.h"
+
+int msm_vidc_core_deinit_locked(struct msm_vidc_core *core, bool force)
+{
+	int rc = 0;
+	struct msm_vidc_inst *inst, *dummy;
+	enum msm_vidc_allow allow;
+
+	rc = __strict_check(core, __func__);
+	if (rc) {
+		d_vpr_e("%s(): core was not locked\n", __func__);
+		return rc;
+	}
+
+	if (is_core_state(core, MSM_VIDC_CORE_DEINIT))
+		return 0;
+
+	/*
+	 * msm_vidc_core_init() is in fw_load() without core->lock and owns
+	 * the hardware until it takes the lock back. A forced deinit only
+	 * moves the core to ERROR, which wakes the openers waiting on
+	 * init_done and makes the loader deinit the core itself.
+	 */
+	if (core->fw_booting) {
+		d_vpr_h("%s(): firmware loading, defer deinit\n", __func__);
+		if (force)
+			msm_vidc_change_core_state(core, MSM_VIDC_CORE_ERROR, __func__);
+		return 0;
+	}
+
+	/* print error for state change not allowed case */
+	allow = msm_vidc_allow_core_state_change(core, MSM_VIDC_CORE_DEINIT);
+	if (allow != MSM_VIDC_ALLOW)
+		d_vpr_e("%s: %s core state change %s -> %s\n", __func__,
+			allow_name(allow), core_state_name(core->state),
+			core_state_name(MSM_VIDC_CORE_DEINIT));
+
+	if (force) {
+		d_vpr_e("%s(): force deinit core\n", __func__);
+	} else {
+		/* in normal case, deinit core only if no session present */
+		if (!list_empty(&core->instances)) {
+			d_vpr_h("%s(): skip deinit\n", __func__);
+			return 0;
+		} else {
+			d_vpr_h("%s(): deinit core\n", __func__);
+		}
+	}
+
+	venus_hfi_core_deinit(core, force);
+	/* after an error, request the image again on the next load */
+	if (force)
+		fw_release(core);
+
+	/* unlink all sessions from core, if any */
+	list_for_each_entry_safe(inst, dummy, &core->instances, list) {
+		msm_vidc_change_state(inst, MSM_VIDC_ERROR, __func__);
+		list_move_tail(&inst->list, &core->dangling_instances);
+	}
+	msm_vidc_change_core_state(core, MSM_VIDC_CORE_DEINIT, __func__);
+
+	return rc;
+}
+
+int msm_vidc_core_deinit(struct msm_vidc_core *core, bool force)
+{
+	int rc = 0;
+
+	/*
+	 * clk_work takes core->lock, so it can only be synced here. Work
+	 * queued later finds the core deinited and returns.
+	 */
+	cancel_work_sync(&core->clk_work);
+
+	core_lock(core, __func__);
+	rc = msm_vidc_core_deinit_locked(core, force);
+	core_unlock(core, __func__);
+
+	return rc;
+}
+
+int msm_vidc_core_init_wait(struct msm_vidc_core *core)
+{
+	unsigned long timeout;
+	bool booting;
+	u64 start_ns;
+	int rc = 0;
+
+	core_lock(core, __func__);
+	if (is_core_state(core, MSM_VIDC_CORE_INIT)) {
+		rc = 0;
+		goto unlock;
+	} else if (is_core_state(core, MSM_VIDC_CORE_DEINIT) ||
+		   is_core_state(core, MSM_VIDC_CORE_ERROR)) {
+		d_vpr_e("%s: invalid core state %s\n",
+			__func__, core_state_name(core->state));
+		rc = -EINVAL;
+		goto unlock;
+	}
+
+	/*
+	 * Completed on any transition out of INIT_WAIT, so every concurrent
+	 * opener sleeps here instead of taking turns on core->lock. The
+	 * response timeout covers sys init only: a wait that started while
+	 * the firmware was still being loaded is restarted.
+	 */
+	d_vpr_h("%s(): waiting for state change\n", __func__);
+	timeout = msecs_to_jiffies(core->capabilities[HW_RESPONSE_TIMEOUT].value);
+	start_ns = ktime_get_ns();
+	do {
+		booting = core->fw_booting;
+		core_unlock(core, __func__);
+		wait_for_completion_timeout(&core->init_done, timeout);
+		core_lock(core, __func__);
+	} while (is_core_state(core, MSM_VIDC_CORE_INIT_WAIT) &&
+		 (booting || core->fw_booting));
+	d_vpr_h("%s: state %s, waited %llu ms\n", __func__,
+		core_state_name(core->state),
+		(ktime_get_ns() - start_ns) / NSEC_PER_MSEC);
+
+	if (is_core_state(core, MSM_VIDC_CORE_INIT)) {
+		d_vpr_h("%s: sys init successful\n", __func__);
+		trace_msm_v4l2_vidc_core_init("SYS_INIT_DONE");
+		rc = 0;
+		goto unlock;
+	} else if (is_core_state(core, MSM_VIDC_CORE_INIT_WAIT)) {
+		d_vpr_h("%s: sys init wait timedout. state %s\n",
+			__func__, core_state_name(core->state));
+		msm_vidc_change_core_state(core, MSM_VIDC_CORE_ERROR, __func__);
+		/* mark video hw unresponsive */
+		msm_vidc_change_core_sub_state(core,
+			0, CORE_SUBSTATE_VIDEO_UNRESPONSIVE, __func__);
+		/* core deinit to handle error */
+		msm_vidc_core_deinit_locked(core, true);
+		rc = -EINVAL;
+		goto unlock;
+	} else {
+		d_vpr_e("%s: invalid core state %s\n",
+			__func__, core_state_name(core->state));
+		rc = -EINVAL;
+		goto unlock;
+	}
+unlock:
+	core_unlock(core, __func__);
+	return rc;
+}
+
+int msm_vidc_core_init(struct msm_vidc_core *core)
+{
+	enum msm_vidc_allow allow;
+	int rc = 0;
+
+	core_lock(core, __func__);
+	if (core_in_valid_state(core)) {
+		goto unlock;
+	} else if (is_core_state(core, MSM_VIDC_CORE_ERROR)) {
+		d_vpr_e("%s: invalid core state %s\n",
+			__func__, core_state_name(core->state));
+		rc = -EINVAL;
+		goto unlock;
+	}
+
+	/* print error for state change not allowed case */
+	allow = msm_vidc_allow_core_state_change(core, MSM_VIDC_CORE_INIT_WAIT);
+	if (allow != MSM_VIDC_ALLOW)
+		d_vpr_e("%s: %s core state change %s -> %s\n", __func__,
+			allow_name(allow), core_state_name(core->state),
+			core_state_name(MSM_VIDC_CORE_INIT_WAIT));
+
+	msm_vidc_change_core_state(core, MSM_VIDC_CORE_INIT_WAIT, __func__);
+	/* clear PM suspend from core sub_state */
+	msm_vidc_change_core_sub_state(core, CORE_SUBSTATE_PM_SUSPEND, 0, __func__);
+	msm_vidc_change_core_sub_state(core, CORE_SUBSTATE_PAGE_FAULT, 0, __func__);
+
+	rc = venus_hfi_core_power_on(core);
+	if (rc)
+		goto error;
+
+	/*
+	 * request_firmware, the mdt load and TZ authentication take hundreds
+	 * of ms on a cold boot. Run them without core->lock: other openers
+	 * find the core in INIT_WAIT and sleep on init_done instead.
+	 */
+	core->fw_booting = true;
+	core_unlock(core, __func__);
+	rc = fw_load(core);
+	core_lock(core, __func__);
+	core->fw_booting = false;
+	if (rc)
+		goto error;
+
+	/* forced deinit while loading, see msm_vidc_core_deinit_locked() */
+	if (!is_core_state(core, MSM_VIDC_CORE_INIT_WAIT)) {
+		d_vpr_e("%s: core state %s after fw load\n",
+			__func__, core_state_name(core->state));
+		rc = -EINVAL;
+		goto error;
+	}
+
+	rc = venus_hfi_core_init(core);
+	if (rc)
+		goto error;
+
+unlock:
+	core_unlock(core, __func__);
+	return rc;
+
+error:
+	msm_vidc_change_core_state(core, MSM_VIDC_CORE_ERROR, __func__);
+	d_vpr_e("%s: core init failed\n", __func__);
+	/* do core deinit to handle error */
+	msm_vidc_core_deinit_locked(core, true);
+	goto unlock;
+}
@@ -12,6 +12,7 @@
 #include "msm_vidc_inst.h"
 #include "msm_vidc_internal.h"
 #include "msm_vidc_events.h"
+#include "msm_vidc_power.h"
 
 extern struct msm_vidc_core *g_core;
 
@@ -27,6 +28,46 @@ unsigned int msm_fw_debug = FW_LOG;
 /* disabled synx fence by default temporarily */
 bool msm_vidc_synx_fence_enable = false;
 
+DEFINE_STATIC_KEY_TRUE(msm_vidc_log_err);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_high);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_low);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_perf);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_pkt);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_bus);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_log_stat);
+DEFINE_STATIC_KEY_FALSE(msm_vidc_buf_trace);
+
+#define update_log_key(key, on) \
+	do { \
+		if (on) \
+			static_branch_enable(&(key)); \
+		else \
+			static_branch_disable(&(key)); \
+	} while (0)
+
+static void msm_vidc_update_log_keys(unsigned int level)
+{
+	update_log_key(msm_vidc_log_err, level & VIDC_ERR);
+	update_log_key(msm_vidc_log_high, level & VIDC_HIGH);
+	update_log_key(msm_vidc_log_low, level & VIDC_LOW);
+	update_log_key(msm_vidc_log_perf, level & VIDC_PERF);
+	update_log_key(msm_vidc_log_pkt, level & VIDC_PKT);
+	update_log_key(msm_vidc_log_bus, level & VIDC_BUS);
+	update_log_key(msm_vidc_log_stat, level & VIDC_STAT);
+}
+
+/* buffer_event_log tracepoint (un)registration, see msm_vidc_events.h */
+int msm_vidc_buf_trace_reg(void)
+{
+	static_branch_inc(&msm_vidc_buf_trace);
+	return 0;
+}
+
+void msm_vidc_buf_trace_unreg(void)
+{
+	static_branch_dec(&msm_vidc_buf_trace);
+}
+
 static int debug_level_set_drv(const char *val,
 	const struct kernel_param *kp)
 {
@@ -44,6 +85,7 @@ static int debug_level_set_drv(const char *val,
 		return ret;
 
 	msm_vidc_debug = dvalue;
+	msm_vidc_update_log_keys(dvalue);
 
 	core = *(struct msm_vidc_core **)kp->arg;
 
@@ -225,6 +267,26 @@ EXPORT_SYMBOL(msm_vidc_fw_dump);
 unsigned int msm_vidc_enable_bugon = !1;
 EXPORT_SYMBOL(msm_vidc_enable_bugon);
 
+bool msm_vidc_adaptive_pc = true;
+EXPORT_SYMBOL(msm_vidc_adaptive_pc);
+
+unsigned int msm_vidc_dcvs_policy = MSM_VIDC_DCVS_POLICY_BUFFER_COUNT;
+module_param(msm_vidc_dcvs_policy, uint, 0644);
+MODULE_PARM_DESC(msm_vidc_dcvs_policy, "dcvs policy: 0 - buffer count, 1 - closed loop");
+
+unsigned int msm_vidc_dcvs_headroom = 10;
+unsigned int msm_vidc_dcvs_hysteresis = 10;
+
+unsigned int msm_vidc_clock_aggregation = MSM_VIDC_CLOCK_AGGR_SUM;
+module_param(msm_vidc_clock_aggregation, uint, 0644);
+MODULE_PARM_DESC(msm_vidc_clock_aggregation, "clock aggregation: 0 - sum, 1 - edf");
+
+/* edf margin on measured cycles, model cycles carry their own overhead */
+unsigned int msm_vidc_edf_margin = 10;
+
+/* half-life of the per-session average bandwidth */
+unsigned int msm_vidc_bw_half_life_ms = 1000;
+
 #define MAX_DBG_BUF_SIZE 4096
 
 struct core_inst_pair {
@@ -326,6 +388,221 @@ static const struct file_operations core_info_fops = {
 	.read = core_info_read,
 };
 
+static ssize_t pc_stats_read(struct file *file, char __user *buf,
+	size_t count, loff_t *ppos)
+{
+	struct msm_vidc_core *core = file->private_data;
+	struct msm_vidc_pc_stats *pc;
+	char *cur, *end, *dbuf = NULL;
+	ssize_t len = 0;
+
+	if (!core) {
+		d_vpr_e("%s: invalid params %pK\n", __func__, core);
+		return 0;
+	}
+
+	dbuf = vzalloc(MAX_DBG_BUF_SIZE);
+	if (!dbuf) {
+		d_vpr_e("%s: allocation failed\n", __func__);
+		return -ENOMEM;
+	}
+
+	cur = dbuf;
+	end = cur + MAX_DBG_BUF_SIZE;
+
+	core_lock(core, __func__);
+	pc = &core->pc_stats;
+	cur += write_str(cur, end - cur, "adaptive: %d\n", msm_vidc_adaptive_pc);
+	cur += write_str(cur, end - cur, "delay_ms: %u\n", pc->delay_ms);
+	cur += write_str(cur, end - cur, "predicted_idle_ms: %llu\n",
+		div_u64(pc->predicted_idle_ns, NSEC_PER_MSEC));
+	cur += write_str(cur, end - cur, "actual_idle_ms: %llu\n",
+		div_u64(pc->actual_idle_ns, NSEC_PER_MSEC));
+	cur += write_str(cur, end - cur, "resume_cost_us: %llu\n",
+		div_u64(pc->resume_cost_ns, NSEC_PER_USEC));
+	cur += write_str(cur, end - cur, "collapse_count: %u\n", pc->collapse_count);
+	cur += write_str(cur, end - cur, "resume_count: %u\n", pc->resume_count);
+	cur += write_str(cur, end - cur, "early_resume_count: %u\n",
+		pc->early_resume_count);
+	core_unlock(core, __func__);
+
+	len = simple_read_from_buffer(buf, count, ppos,
+		dbuf, cur - dbuf);
+
+	vfree(dbuf);
+	return len;
+}
+
+static const struct file_operations pc_stats_fops = {
+	.open = simple_open,
+	.read = pc_stats_read,
+};
+
+static ssize_t clk_stats_read(struct file *file, char __user *buf,
+	size_t count, loff_t *ppos)
+{
+	struct msm_vidc_core *core = file->private_data;
+	struct clock_scaling_stats *stats;
+	char *cur, *end, *dbuf = NULL;
+	u64 requested, coalesced;
+	ssize_t len = 0;
+
+	if (!core || !core->resource) {
+		d_vpr_e("%s: invalid params %pK\n", __func__, core);
+		return 0;
+	}
+
+	dbuf = vzalloc(MAX_DBG_BUF_SIZE);
+	if (!dbuf) {
+		d_vpr_e("%s: allocation failed\n", __func__);
+		return -ENOMEM;
+	}
+
+	cur = dbuf;
+	end = cur + MAX_DBG_BUF_SIZE;
+
+	stats = &core->resource->scaling_stats;
+	spin_lock(&core->clk_req_lock);
+	requested = stats->requested;
+	coalesced = stats->coalesced;
+	spin_unlock(&core->clk_req_lock);
+
+	core_lock(core, __func__);
+	cur += write_str(cur, end - cur, "requested: %llu\n", requested);
+	cur += write_str(cur, end - cur, "coalesced: %llu\n", coalesced);
+	cur += write_str(cur, end - cur, "clk_applied: %llu\n", stats->clk_applied);
+	cur += write_str(cur, end - cur, "opp_applied: %llu\n", stats->opp_applied);
+	cur += write_str(cur, end - cur, "opp_skipped: %llu\n", stats->opp_skipped);
+	cur += write_str(cur, end - cur, "clk_time_us: %llu\n",
+		div_u64(stats->clk_time_ns, NSEC_PER_USEC));
+	cur += write_str(cur, end - cur, "opp_time_us: %llu\n",
+		div_u64(stats->opp_time_ns, NSEC_PER_USEC));
+	core_unlock(core, __func__);
+
+	len = simple_read_from_buffer(buf, count, ppos,
+		dbuf, cur - dbuf);
+
+	vfree(dbuf);
+	return len;
+}
+
+static const struct file_operations clk_stats_fops = {
+	.open = simple_open,
+	.read = clk_stats_read,
+};
+
+static ssize_t residency_read(struct file *file, char __user *buf,
+	size_t count, loff_t *ppos)
+{
+	struct msm_vidc_core *core = file->private_data;
+	struct bus_residency *bres;
+	struct clock_info *cl;
+	struct bus_info *bus;
+	char *cur, *end, *dbuf = NULL;
+	u64 cur_time_ns, time_ns;
+	ssize_t len = 0;
+	int i;
+
+	if (!core || !core->resource) {
+		d_vpr_e("%s: invalid params %pK\n", __func__, core);
+		return 0;
+	}
+
+	dbuf = vzalloc(MAX_DBG_BUF_SIZE);
+	if (!dbuf) {
+		d_vpr_e("%s: allocation failed\n", __func__);
+		return -ENOMEM;
+	}
+
+	cur = dbuf;
+	end = cur + MAX_DBG_BUF_SIZE;
+
+	core_lock(core, __func__);
+	cur_time_ns = ktime_get_ns();
+	venus_hfi_for_each_clock(core, cl) {
+		if (!cl->residency)
+			continue;
+		cur += write_str(cur, end - cur, "clock %s:\n", cl->name);
+		for (i = 0; i < cl->residency_count; i++) {
+			time_ns = cl->residency[i].total_time_ns;
+			if (i == cl->residency_idx)
+				time_ns += cur_time_ns - cl->residency_start_ns;
+			if (i == cl->residency_count - 1)
+				cur += write_str(cur, end - cur, "  other: %llu us\n",
+					div_u64(time_ns, NSEC_PER_USEC));
+			else
+				cur += write_str(cur, end - cur, "  %llu: %llu us\n",
+					cl->residency[i].rate,
+					div_u64(time_ns, NSEC_PER_USEC));
+		}
+	}
+	venus_hfi_for_each_bus(core, bus) {
+		bres = &bus->residency;
+		cur += write_str(cur, end - cur, "bus %s (max %u kbps):\n",
+			bus->name, bus->max_kbps);
+		for (i = 0; i < BW_RESIDENCY_BUCKETS; i++) {
+			time_ns = bres->total_time_ns[i];
+			if (i == bres->bucket)
+				time_ns += cur_time_ns - bres->start_time_ns;
+			cur += write_str(cur, end - cur, "  bucket %d: %llu us\n",
+				i, div_u64(time_ns, NSEC_PER_USEC));
+		}
+	}
+	time_ns = core->pc_stats.collapsed_ns;
+	if (core->pc_stats.collapsed_start_ns)
+		time_ns += cur_time_ns - core->pc_stats.collapsed_start_ns;
+	cur += write_str(cur, end - cur, "power collapse: %llu us\n",
+		div_u64(time_ns, NSEC_PER_USEC));
+	core_unlock(core, __func__);
+
+	len = simple_read_from_buffer(buf, count, ppos,
+		dbuf, cur - dbuf);
+
+	vfree(dbuf);
+	return len;
+}
+
+static ssize_t residency_write(struct file *filp, const char __user *buf,
+	size_t count, loff_t *ppos)
+{
+	struct msm_vidc_core *core = filp->private_data;
+	char kbuf[MAX_DEBUG_LEVEL_STRING_LEN] = {0};
+	u32 reset = 0;
+	int rc = 0;
+
+	if (!core) {
+		d_vpr_e("%s: invalid params %pK\n", __func__, core);
+		return 0;
+	}
+
+	/* filter partial writes and invalid commands */
+	if (*ppos != 0 || count >= sizeof(kbuf) || count == 0)
+		return -EINVAL;
+
+	rc = simple_write_to_buffer(kbuf, sizeof(kbuf) - 1, ppos, buf, count);
+	if (rc < 0) {
+		d_vpr_e("%s: User memory fault\n", __func__);
+		return -EFAULT;
+	}
+
+	rc = kstrtou32(kbuf, 0, &reset);
+	if (rc) {
+		d_vpr_e("%s: invalid value\n", __func__);
+		return -EINVAL;
+	}
+
+	if (reset)
+		msm_vidc_reset_residency_stats(core);
+
+	return count;
+}
+
+static const struct file_operations residency_fops = {
+	.open = simple_open,
+	.read = residency_read,
+	.write = residency_write,
+};
+
 static ssize_t stats_delay_write_ms(struct file *filp, const char __user *buf,
 		size_t count, loff_t *ppos)
 {
@@ -502,6 +779,16 @@ struct dentry *msm_vidc_debugfs_init_drv(void)
 			&msm_vidc_lossless_encode);
 	debugfs_create_u32("enable_bugon", 0644, dir,
 			&msm_vidc_enable_bugon);
+	debugfs_create_bool("adaptive_power_collapse", 0644, dir,
+			&msm_vidc_adaptive_pc);
+	debugfs_create_u32("dcvs_headroom_pct", 0644, dir,
+			&msm_vidc_dcvs_headroom);
+	debugfs_create_u32("dcvs_hysteresis_pct", 0644, dir,
+			&msm_vidc_dcvs_hysteresis);
+	debugfs_create_u32("edf_margin_pct", 0644, dir,
+			&msm_vidc_edf_margin);
+	debugfs_create_u32("bw_half_life_ms", 0644, dir,
+			&msm_vidc_bw_half_life_ms);
 
 	return dir;
 
@@ -548,6 +835,18 @@ struct dentry *msm_vidc_debugfs_init_core(struct msm_vidc_core *core)
 		d_vpr_e("debugfs_create_file: fail\n");
 		goto failed_create_dir;
 	}
+	if (!debugfs_create_file("pc_stats", 0444, dir, core, &pc_stats_fops)) {
+		d_vpr_e("debugfs_create_file: fail\n");
+		goto failed_create_dir;
+	}
+	if (!debugfs_create_file("clk_stats", 0444, dir, core, &clk_stats_fops)) {
+		d_vpr_e("debugfs_create_file: fail\n");
+		goto failed_create_dir;
+	}
+	if (!debugfs_create_file("residency", 0644, dir, core, &residency_fops)) {
+		d_vpr_e("debugfs_create_file: fail\n");
+		goto failed_create_dir;
+	}
 failed_create_dir:
 	return dir;
 }
@@ -565,6 +864,32 @@ static int publish_unreleased_reference(struct msm_vidc_inst *inst,
 	return 0;
 }
 
+/*
+ * Print the internal buffer requirement currently computed for this
+ * session, so the per-session footprint of a configuration can be read
+ * back without instrumenting the buffer size calculators.
+ */
+static void publish_internal_buffer_sizes(struct msm_vidc_inst *inst,
+		char **dbuf, char *end)
+{
+	struct msm_vidc_buffers *buffers;
+	enum msm_vidc_buffer_type type;
+	u64 total = 0;
+
+	*dbuf += write_str(*dbuf, end - *dbuf, "internal buffer requirements:\n");
+	for (type = MSM_VIDC_BUF_BIN; type <= MSM_VIDC_BUF_PARTIAL_DATA; type++) {
+		buffers = msm_vidc_get_buffers(inst, type, __func__);
+		if (!buffers || !buffers->size || !buffers->min_count)
+			continue;
+
+		*dbuf += write_str(*dbuf, end - *dbuf, "  %-12s %u x %u\n",
+			buf_name(type), buffers->size, buffers->min_count);
+		total += (u64)buffers->size * buffers->min_count;
+	}
+	*dbuf += write_str(*dbuf, end - *dbuf, "internal buffer total: %llu KB\n",
+		total / 1024);
+}
+
 static ssize_t inst_info_read(struct file *file, char __user *buf,
 		size_t count, loff_t *ppos)
 {
@@ -575,6 +900,7 @@ static ssize_t inst_info_read(struct file *file, char __user *buf,
 	int i, j;
 	ssize_t len = 0;
 	struct v4l2_format *f;
+	struct msm_vidc_bw_window_stats ws_1s, ws_10s;
 
 	if (!idata || !idata->core || !idata->inst) {
 		d_vpr_e("%s: invalid params %pK\n", __func__, idata);
@@ -644,6 +970,35 @@ static ssize_t inst_info_read(struct file *file, char __user *buf,
 		inst->debug_count.ftb);
 	cur += write_str(cur, end - cur, "FBD Count: %d\n",
 		inst->debug_count.fbd);
+	cur += write_str(cur, end - cur, "-------------------------------\n");
+	cur += write_str(cur, end - cur, "freq model evals: %u hits: %u\n",
+		inst->power_cache.freq_evals, inst->power_cache.freq_hits);
+	cur += write_str(cur, end - cur, "bw model evals: %u hits: %u\n",
+		inst->power_cache.bw_evals, inst->power_cache.bw_hits);
+	cur += write_str(cur, end - cur, "request pkt bytes last: %u max: %u capacity: %u\n",
+		inst->pending_pkts.last_frame_bytes, inst->pending_pkts.max_frame_bytes,
+		inst->pending_pkts.capacity);
+	cur += write_str(cur, end - cur, "internal bufs reused: %u allocated: %u shrunk: %u\n",
+		inst->buf_reuse.reused, inst->buf_reuse.allocated,
+		inst->buf_reuse.shrunk);
+	cur += write_str(cur, end - cur, "-------------------------------\n");
+	cur += write_str(cur, end - cur, "ewma bw ddr: %u kbps llcc: %u kbps\n",
+		inst->stats.avg_bw_ddr, inst->stats.avg_bw_llcc);
+	inst_lock(inst, __func__);
+	msm_vidc_advance_bw_window(inst, ktime_get_ns());
+	msm_vidc_get_bw_window(inst, 1, &ws_1s);
+	msm_vidc_get_bw_window(inst, 10, &ws_10s);
+	inst_unlock(inst, __func__);
+	cur += write_str(cur, end - cur,
+		"1s  bw ddr avg/peak: %u/%u kbps llcc avg/peak: %u/%u kbps\n",
+		ws_1s.avg_ddr, ws_1s.peak_ddr, ws_1s.avg_llcc, ws_1s.peak_llcc);
+	cur += write_str(cur, end - cur,
+		"10s bw ddr avg/peak: %u/%u kbps llcc avg/peak: %u/%u kbps\n",
+		ws_10s.avg_ddr, ws_10s.peak_ddr, ws_10s.avg_llcc, ws_10s.peak_llcc);
+	cur += write_str(cur, end - cur, "-------------------------------\n");
+	inst_lock(inst, __func__);
+	publish_internal_buffer_sizes(inst, &cur, end);
+	inst_unlock(inst, __func__);
 
 	publish_unreleased_reference(inst, &cur, end);
 	len = simple_read_from_buffer(buf, count, ppos,
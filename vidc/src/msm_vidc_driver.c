@@ -29,12 +29,6 @@ extern struct msm_vidc_core *g_core;
 
 #define is_odd(val) ((val) % 2 == 1)
 #define check_in_range(val, min, max) (((min) <= (val)) && ((val) <= (max)))
-#define COUNT_BITS(a, out) {       \
-	while ((a) >= 1) {          \
-		(out) += (a) & (1); \
-		(a) >>= (1);        \
-	}                           \
-}
 
 #define SSR_TYPE 0x0000000F
 #define SSR_TYPE_SHIFT 0
@@ -138,7 +132,7 @@ const char *v4l2_pixelfmt_name(struct msm_vidc_inst *inst, u32 pixfmt)
 	return "UNKNOWN";
 }
 
-void print_vidc_buffer(u32 tag, const char *tag_str, const char *str, struct msm_vidc_inst *inst,
+void __print_vidc_buffer(u32 tag, const char *tag_str, const char *str, struct msm_vidc_inst *inst,
 		struct msm_vidc_buffer *vbuf)
 {
 	struct dma_buf *dbuf;
@@ -246,7 +240,7 @@ int msm_vidc_add_buffer_stats(struct msm_vidc_inst *inst,
 {
 	struct msm_vidc_buffer_stats *stats = NULL;
 
-	if (!(msm_vidc_debug & VIDC_LOW))
+	if (!msm_vidc_log_on(VIDC_LOW))
 		return 0;
 
 	/* stats applicable only to input & output buffers */
@@ -283,7 +277,7 @@ int msm_vidc_remove_buffer_stats(struct msm_vidc_inst *inst,
 	struct msm_vidc_buffer_stats *prev_stats = NULL;
 	bool remove_stat = false, is_first_stat = false;;
 
-	if (!(msm_vidc_debug & VIDC_LOW))
+	if (!msm_vidc_log_on(VIDC_LOW))
 		return 0;
 
 	/* stats applicable only to input & output buffers */
@@ -1098,9 +1092,19 @@ int msm_vidc_process_drain(struct msm_vidc_inst *inst)
 {
 	int rc = 0;
 
-	rc = venus_hfi_session_drain(inst, INPUT_PORT);
-	if (rc)
-		return rc;
+	/*
+	 * Inputs held on their fence were queued before the stop command,
+	 * so firmware must see them ahead of the drain. The drain is issued
+	 * by msm_vidc_process_input_fences() once the last one is queued.
+	 */
+	if (!list_empty(&inst->input_fence_list)) {
+		i_vpr_h(inst, "%s: deferred, input fences pending\n", __func__);
+		inst->drain_deferred = true;
+	} else {
+		rc = venus_hfi_session_drain(inst, INPUT_PORT);
+		if (rc)
+			return rc;
+	}
 	rc = msm_vidc_change_sub_state(inst, 0, MSM_VIDC_DRAIN, __func__);
 	if (rc)
 		return rc;
@@ -2077,6 +2081,7 @@ struct msm_vidc_buffer *msm_vidc_get_driver_buf(struct msm_vidc_inst *inst,
 	rc = vb2_buffer_to_driver(vb2, buf);
 	if (rc)
 		return NULL;
+	msm_vidc_update_input_size(inst, buf);
 
 	/* treat every buffer as deferred buffer initially */
 	buf->attr |= MSM_VIDC_ATTR_DEFERRED;
@@ -2121,6 +2126,8 @@ int msm_vidc_allocate_buffers(struct msm_vidc_inst *inst,
 		buf->index = idx;
 		buf->region = call_mem_op(core, buffer_region, inst, buf_type);
 	}
+	if (buf_type == MSM_VIDC_BUF_INPUT)
+		inst->power.input_size_stale = true;
 	i_vpr_h(inst, "%s: allocated %d buffers for type %s\n",
 		__func__, num_buffers, buf_name(buf_type));
 
@@ -2148,6 +2155,8 @@ int msm_vidc_free_buffers(struct msm_vidc_inst *inst,
 		list_del_init(&buf->list);
 		msm_vidc_pool_free(inst, buf);
 	}
+	if (buf_type == MSM_VIDC_BUF_INPUT)
+		inst->power.input_size_stale = true;
 	i_vpr_h(inst, "%s: freed %d buffers for type %s\n",
 		__func__, buf_count, buf_name(buf_type));
 
@@ -2313,7 +2322,7 @@ exit:
 
 bool msm_vidc_allow_decode_batch(struct msm_vidc_inst *inst)
 {
-	struct msm_vidc_inst_cap *cap;
+	struct msm_vidc_inst_cap_state *cap;
 	struct msm_vidc_core *core;
 	bool allow = false;
 	u32 value = 0;
@@ -2393,32 +2402,33 @@ exit:
 
 static void msm_vidc_update_input_cr(struct msm_vidc_inst *inst, u32 idx, u32 cr)
 {
-	struct msm_vidc_input_cr_data *temp = NULL, *next = NULL;
-	bool found = false;
+	struct msm_vidc_input_cr_data *crs = &inst->enc_input_crs;
 
-	list_for_each_entry_safe(temp, next, &inst->enc_input_crs, list) {
-		if (temp->index == idx) {
-			temp->input_cr = cr;
-			found = true;
-			break;
-		}
+	if (idx >= crs->count) {
+		i_vpr_l(inst, "%s: index %u out of range\n", __func__, idx);
+		return;
 	}
-	if (!found) {
-		temp = NULL;
-		temp = vzalloc(sizeof(*temp));
-		if (!temp) {
-			i_vpr_e(inst, "%s: allocation failed\n", __func__);
-			return;
-		}
-		temp->index = idx;
-		temp->input_cr = cr;
-		list_add_tail(&temp->list, &inst->enc_input_crs);
+
+	crs->input_cr[idx] = cr;
+	set_bit(idx, crs->valid);
+
+	/* keep the running minimum; rescan only if it may have grown */
+	if (crs->stale)
+		return;
+	if (cr <= crs->min_cr) {
+		crs->min_cr = cr;
+		crs->min_index = idx;
+	} else if (idx == crs->min_index) {
+		crs->stale = true;
 	}
 }
 
 void msm_vidc_update_stats(struct msm_vidc_inst *inst,
 	struct msm_vidc_buffer *buf, enum msm_vidc_debugfs_event etype)
 {
+	/* also called from the input buffer done path under buffer_lock alone */
+	lockdep_assert_held(&inst->buffer_lock);
+
 	if ((is_decode_session(inst) && etype == MSM_VIDC_DEBUGFS_EVENT_ETB) ||
 		(is_encode_session(inst) && etype == MSM_VIDC_DEBUGFS_EVENT_FBD))
 		inst->stats.data_size += buf->data_size;
@@ -2452,8 +2462,6 @@ void msm_vidc_print_stats(struct msm_vidc_inst *inst)
 
 	inst->stats.count = inst->debug_count;
 	inst->stats.data_size = 0;
-	inst->stats.avg_bw_llcc = 0;
-	inst->stats.avg_bw_ddr = 0;
 	inst->stats.time_ms = time_ms;
 }
 
@@ -2523,6 +2531,10 @@ int schedule_stats_work(struct msm_vidc_inst *inst)
 		return 0;
 	}
 
+	/* thumbnail sessions end before the first stats period */
+	if (is_thumbnail_session(inst))
+		return 0;
+
 	/**
 	 * Hfi session is already closed and inst also going to be
 	 * closed soon. So skip scheduling new stats_work to avoid
@@ -2533,17 +2545,22 @@ int schedule_stats_work(struct msm_vidc_inst *inst)
 		return 0;
 	}
 	core = inst->core;
-	mod_delayed_work(inst->workq, &inst->stats_work,
+	mod_delayed_work(core->inst_workq, &inst->stats_work,
 		msecs_to_jiffies(core->capabilities[STATS_TIMEOUT_MS].value));
 
 	return 0;
 }
 
-int cancel_stats_work_sync(struct msm_vidc_inst *inst)
+void msm_vidc_debugfs_work(struct msm_vidc_inst *inst)
 {
-	cancel_delayed_work_sync(&inst->stats_work);
+	struct msm_vidc_core *core;
 
-	return 0;
+	core = inst->core;
+
+	inst->debugfs_root =
+		msm_vidc_debugfs_init_inst(inst, core->debugfs_root);
+	if (!inst->debugfs_root)
+		i_vpr_h(inst, "%s: debugfs not available\n", __func__);
 }
 
 void msm_vidc_stats_handler(struct work_struct *work)
@@ -2551,6 +2568,11 @@ void msm_vidc_stats_handler(struct work_struct *work)
 	struct msm_vidc_inst *inst;
 
 	inst = container_of(work, struct msm_vidc_inst, stats_work.work);
+	msm_vidc_queue_inst_work(inst, MSM_VIDC_INST_WORK_STATS);
+}
+
+void msm_vidc_stats_work(struct msm_vidc_inst *inst)
+{
 	inst = get_inst_ref(g_core, inst);
 	if (!inst || !inst->packet) {
 		d_vpr_e("%s: invalid params\n", __func__);
@@ -2678,6 +2700,9 @@ int msm_vidc_queue_deferred_buffers(struct msm_vidc_inst *inst, enum msm_vidc_bu
 	list_for_each_entry(buf, &buffers->list, list) {
 		if (!(buf->attr & MSM_VIDC_ATTR_DEFERRED))
 			continue;
+		/* queued once its input fence signals */
+		if (buf->attr & MSM_VIDC_ATTR_FENCE_WAIT)
+			continue;
 		rc = msm_vidc_queue_buffer(inst, buf);
 		if (rc)
 			return rc;
@@ -2699,6 +2724,185 @@ int msm_vidc_buf_queue(struct msm_vidc_inst *inst, struct msm_vidc_buffer *buf)
 	return rc;
 }
 
+static void msm_vidc_input_fence_cb(struct dma_fence *fence, struct dma_fence_cb *cb)
+{
+	struct msm_vidc_input_fence *in_fence =
+		container_of(cb, struct msm_vidc_input_fence, cb);
+	struct msm_vidc_inst *inst = in_fence->inst;
+
+	msm_vidc_queue_inst_work(inst, MSM_VIDC_INST_WORK_INPUT_FENCE);
+}
+
+static void msm_vidc_input_fence_error(struct msm_vidc_inst *inst,
+	struct msm_vidc_buffer *buf, int status)
+{
+	struct msm_vidc_buffer *meta;
+
+	print_vidc_buffer(VIDC_ERR, "err ", "input fence failed", inst, buf);
+	i_vpr_e(inst, "%s: fence status %d\n", __func__, status);
+
+	meta = get_meta_buffer(inst, buf);
+	if (meta && meta->attr & MSM_VIDC_ATTR_DEFERRED) {
+		meta->attr &= ~MSM_VIDC_ATTR_DEFERRED;
+		meta->attr |= MSM_VIDC_ATTR_BUFFER_DONE;
+		meta->flags |= MSM_VIDC_BUF_FLAG_ERROR;
+		meta->data_size = 0;
+		msm_vidc_vb2_buffer_done(inst, meta);
+	}
+
+	buf->attr &= ~MSM_VIDC_ATTR_DEFERRED;
+	buf->attr |= MSM_VIDC_ATTR_BUFFER_DONE;
+	buf->flags |= MSM_VIDC_BUF_FLAG_ERROR;
+	buf->data_size = 0;
+	msm_vidc_update_input_size(inst, buf);
+	msm_vidc_vb2_buffer_done(inst, buf);
+}
+
+/*
+ * Queue the input buffers whose producer fence has signalled, in qbuf
+ * order. Processing stops at the first buffer still waiting.
+ */
+static void msm_vidc_process_input_fences(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_input_fence *in_fence, *dummy;
+	struct msm_vidc_buffer *buf;
+	int status, rc;
+
+	list_for_each_entry_safe(in_fence, dummy, &inst->input_fence_list, list) {
+		if (in_fence->fence && !dma_fence_is_signaled(in_fence->fence))
+			break;
+
+		buf = in_fence->buf;
+		status = in_fence->fence ? dma_fence_get_status(in_fence->fence) : 1;
+		list_del(&in_fence->list);
+		if (in_fence->fence)
+			dma_fence_put(in_fence->fence);
+		kfree(in_fence);
+
+		buf->attr &= ~MSM_VIDC_ATTR_FENCE_WAIT;
+		if (status < 0) {
+			msm_vidc_input_fence_error(inst, buf, status);
+			continue;
+		}
+
+		rc = inst->event_handle(inst, MSM_VIDC_BUF_QUEUE, buf);
+		if (rc) {
+			i_vpr_e(inst, "%s: qbuf failed\n", __func__);
+			msm_vidc_change_state(inst, MSM_VIDC_ERROR, __func__);
+			return;
+		}
+	}
+
+	if (inst->drain_deferred && list_empty(&inst->input_fence_list)) {
+		inst->drain_deferred = false;
+		i_vpr_h(inst, "%s: issue deferred drain\n", __func__);
+		rc = venus_hfi_session_drain(inst, INPUT_PORT);
+		if (rc) {
+			i_vpr_e(inst, "%s: drain failed\n", __func__);
+			msm_vidc_change_state(inst, MSM_VIDC_ERROR, __func__);
+		}
+	}
+}
+
+void msm_vidc_input_fence_work(struct msm_vidc_inst *inst)
+{
+	inst = get_inst_ref(g_core, inst);
+	if (!inst) {
+		d_vpr_e("%s: invalid params\n", __func__);
+		return;
+	}
+
+	inst_lock(inst, __func__);
+	if (!is_session_error(inst))
+		msm_vidc_process_input_fences(inst);
+	inst_unlock(inst, __func__);
+
+	put_inst(inst);
+}
+
+/*
+ * Drop all pending input fence waits. The buffers stay deferred and are
+ * returned by the regular flush.
+ */
+void msm_vidc_flush_input_fences(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_input_fence *in_fence, *dummy;
+
+	list_for_each_entry_safe(in_fence, dummy, &inst->input_fence_list, list) {
+		/* once removed under fence lock, the callback cannot be running */
+		if (in_fence->fence) {
+			dma_fence_remove_callback(in_fence->fence, &in_fence->cb);
+			dma_fence_put(in_fence->fence);
+		}
+		in_fence->buf->attr &= ~MSM_VIDC_ATTR_FENCE_WAIT;
+		list_del(&in_fence->list);
+		kfree(in_fence);
+	}
+	/* the input flush also ends the drain sequence */
+	inst->drain_deferred = false;
+}
+
+/*
+ * Hold an input buffer until the producer fence set via INBUF_FENCE_FD
+ * signals, instead of having the client wait for it before qbuf.
+ * Returns 1 if the buffer is held or already returned, 0 if it can be
+ * queued right away.
+ */
+static int msm_vidc_input_fence_wait(struct msm_vidc_inst *inst,
+	struct msm_vidc_buffer *buf)
+{
+	struct msm_vidc_input_fence *in_fence;
+	struct dma_fence *fence = NULL;
+	int fd, rc;
+
+	if (is_valid_cap(inst, INBUF_FENCE_FD) &&
+	    inst->capabilities[INBUF_FENCE_FD].value != INVALID_FD) {
+		fd = inst->capabilities[INBUF_FENCE_FD].value;
+		msm_vidc_update_cap_value(inst, INBUF_FENCE_FD, INVALID_FD, __func__);
+		fence = sync_file_get_fence(fd);
+		if (!fence) {
+			i_vpr_e(inst, "%s: invalid input fence fd %d\n", __func__, fd);
+			return -EINVAL;
+		}
+	}
+
+	if (list_empty(&inst->input_fence_list) &&
+	    (!fence || dma_fence_is_signaled(fence))) {
+		rc = fence ? dma_fence_get_status(fence) : 1;
+		if (fence)
+			dma_fence_put(fence);
+		if (rc < 0) {
+			msm_vidc_input_fence_error(inst, buf, rc);
+			return 1;
+		}
+		return 0;
+	}
+
+	in_fence = kzalloc(sizeof(*in_fence), GFP_KERNEL);
+	if (!in_fence) {
+		if (fence)
+			dma_fence_put(fence);
+		return -ENOMEM;
+	}
+	in_fence->inst = inst;
+	in_fence->buf = buf;
+	in_fence->fence = fence;
+	buf->attr |= MSM_VIDC_ATTR_FENCE_WAIT;
+	list_add_tail(&in_fence->list, &inst->input_fence_list);
+	print_vidc_buffer(VIDC_LOW, "low ", "wait input fence", inst, buf);
+
+	if (fence) {
+		rc = dma_fence_add_callback(fence, &in_fence->cb,
+			msm_vidc_input_fence_cb);
+		/* already signalled */
+		if (rc == -ENOENT)
+			msm_vidc_queue_inst_work(inst,
+				MSM_VIDC_INST_WORK_INPUT_FENCE);
+	}
+
+	return 1;
+}
+
 int msm_vidc_queue_buffer_single(struct msm_vidc_inst *inst, struct vb2_buffer *vb2)
 {
 	int rc = 0;
@@ -2720,6 +2924,15 @@ int msm_vidc_queue_buffer_single(struct msm_vidc_inst *inst, struct vb2_buffer *
 		buf->fence_id = fence->fence_id;
 	}
 
+	if (is_input_buffer(buf->type)) {
+		rc = msm_vidc_input_fence_wait(inst, buf);
+		if (rc < 0)
+			goto exit;
+		/* queued from msm_vidc_input_fence_work */
+		if (rc > 0)
+			return 0;
+	}
+
 	rc = inst->event_handle(inst, MSM_VIDC_BUF_QUEUE, buf);
 	if (rc)
 		goto exit;
@@ -2780,6 +2993,129 @@ int msm_vidc_destroy_internal_buffer(struct msm_vidc_inst *inst,
 	return 0;
 }
 
+/*
+ * Mark the existing internal buffers which still satisfy the latest
+ * size and region requirement with MSM_VIDC_ATTR_REUSE, up to min_count
+ * of them. Unmarked buffers are released/destroyed by the callers and
+ * only the missing ones get allocated. Buffers which stayed oversized
+ * for longer than INTERNAL_BUF_SHRINK_DELAY_MS are not retained, so that
+ * a resolution switching back and forth does not churn allocations but
+ * a lasting downswitch still gives the memory back.
+ */
+static void msm_vidc_mark_reusable_internal_buffers(struct msm_vidc_inst *inst,
+	struct msm_vidc_buffers *buffers, enum msm_vidc_buffer_type buffer_type,
+	bool allow)
+{
+	struct msm_vidc_core *core = inst->core;
+	struct msm_vidc_buffer *buf;
+	u32 region, retained = 0, dropped = 0, oversize;
+	bool oversized = false, shrink = false;
+	u64 now;
+
+	if (list_empty(&buffers->list)) {
+		buffers->reuse = false;
+		buffers->oversize_since_ns = 0;
+		return;
+	}
+
+	region = call_mem_op(core, buffer_region, inst, buffer_type);
+	oversize = buffers->size * INTERNAL_BUF_OVERSIZE_RATIO;
+
+	list_for_each_entry(buf, &buffers->list, list) {
+		if (buf->attr & MSM_VIDC_ATTR_PENDING_RELEASE)
+			continue;
+		if (buffers->size && buf->buffer_size >= oversize)
+			oversized = true;
+	}
+
+	now = ktime_get_ns();
+	if (!oversized)
+		buffers->oversize_since_ns = 0;
+	else if (!buffers->oversize_since_ns)
+		buffers->oversize_since_ns = now;
+	else if (now - buffers->oversize_since_ns >=
+		 (u64)INTERNAL_BUF_SHRINK_DELAY_MS * NSEC_PER_MSEC)
+		shrink = true;
+
+	list_for_each_entry(buf, &buffers->list, list) {
+		if (buf->attr & MSM_VIDC_ATTR_PENDING_RELEASE)
+			continue;
+
+		buf->attr &= ~MSM_VIDC_ATTR_REUSE;
+		if (allow && buffers->size && retained < buffers->min_count &&
+		    buf->buffer_size >= buffers->size && buf->region == region &&
+		    !(shrink && buf->buffer_size >= oversize)) {
+			buf->attr |= MSM_VIDC_ATTR_REUSE;
+			retained++;
+		} else {
+			if (shrink && buf->buffer_size >= oversize)
+				inst->buf_reuse.shrunk++;
+			dropped++;
+		}
+	}
+	if (shrink)
+		buffers->oversize_since_ns = 0;
+
+	/* nothing to release or allocate for this type */
+	buffers->reuse = !dropped && retained == buffers->min_count;
+
+	i_vpr_l(inst, "%s: %s: retained %u, dropped %u, required %u x %u\n",
+		__func__, buf_name(buffer_type), retained, dropped,
+		buffers->min_count, buffers->size);
+}
+
+/*
+ * Called once a port is stopped and firmware has returned its internal
+ * buffers: frees retained buffers which are oversized for the last
+ * requirement, instead of keeping them until the next reconfiguration.
+ * Anything still queued or pending release is left to the usual paths.
+ */
+void msm_vidc_free_oversized_internal_buffers(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_buffers *buffers;
+	struct msm_vidc_buffer *buf, *dummy;
+	u32 i, freed;
+
+	static const enum msm_vidc_buffer_type internal_buf_types[] = {
+		MSM_VIDC_BUF_BIN,
+		MSM_VIDC_BUF_ARP,
+		MSM_VIDC_BUF_COMV,
+		MSM_VIDC_BUF_NON_COMV,
+		MSM_VIDC_BUF_LINE,
+		MSM_VIDC_BUF_DPB,
+		MSM_VIDC_BUF_PERSIST,
+		MSM_VIDC_BUF_VPSS,
+		MSM_VIDC_BUF_PARTIAL_DATA,
+	};
+
+	for (i = 0; i < ARRAY_SIZE(internal_buf_types); i++) {
+		buffers = msm_vidc_get_buffers(inst, internal_buf_types[i], __func__);
+		if (!buffers || !buffers->size)
+			continue;
+
+		freed = 0;
+		list_for_each_entry_safe(buf, dummy, &buffers->list, list) {
+			if (buf->attr & (MSM_VIDC_ATTR_QUEUED |
+					 MSM_VIDC_ATTR_PENDING_RELEASE))
+				continue;
+			if (buf->buffer_size < buffers->size * INTERNAL_BUF_OVERSIZE_RATIO)
+				continue;
+
+			i_vpr_h(inst, "%s: free oversized %s: size %u, required %u\n",
+				__func__, buf_name(buf->type), buf->buffer_size,
+				buffers->size);
+			msm_vidc_destroy_internal_buffer(inst, buf);
+			inst->buf_reuse.shrunk++;
+			freed++;
+		}
+		if (freed) {
+			/* the next streamon allocates the missing buffers */
+			buffers->reuse = false;
+			buffers->oversize_since_ns = 0;
+		}
+	}
+}
+
 int msm_vidc_get_internal_buffers(struct msm_vidc_inst *inst,
 	enum msm_vidc_buffer_type buffer_type)
 {
@@ -2787,6 +3123,7 @@ int msm_vidc_get_internal_buffers(struct msm_vidc_inst *inst,
 	u32 buf_count;
 	struct msm_vidc_core *core;
 	struct msm_vidc_buffers *buffers;
+	bool allow_reuse = true;
 
 	core = inst->core;
 
@@ -2804,27 +3141,47 @@ int msm_vidc_get_internal_buffers(struct msm_vidc_inst *inst,
 	 * In a usecase when film grain is initially present, dpb buffers
 	 * are allocated and in the middle of the session, if film grain
 	 * is disabled, then dpb internal buffers should be destroyed.
-	 * When film grain is disabled, buffer_size op call returns 0.
-	 * To ensure buffers->reuse is set to false, add check to detect
-	 * if buf_size has become zero. Do the same for buf_count as well.
+	 * When film grain is disabled, buffer_size op call returns 0,
+	 * which leaves no buffer eligible for reuse.
 	 */
-	if (is_split_mode_enabled(inst) && is_sub_state(inst, MSM_VIDC_FIRST_IPSC)) {
-		buffers->reuse = false;
-		buffers->size = buf_size;
-		buffers->min_count = buf_count;
-	} else if (buf_size && buf_size <= buffers->size &&
-		buf_count && buf_count <= buffers->min_count) {
-		buffers->reuse = true;
-	} else {
-		buffers->reuse = false;
-		buffers->size = buf_size;
-		buffers->min_count = buf_count;
-	}
+	if (is_split_mode_enabled(inst) && is_sub_state(inst, MSM_VIDC_FIRST_IPSC))
+		allow_reuse = false;
+
+	buffers->size = buf_size;
+	buffers->min_count = buf_count;
+	msm_vidc_mark_reusable_internal_buffers(inst, buffers, buffer_type,
+		allow_reuse);
+
 	return 0;
 }
 
+/*
+ * Retained buffers keep their index, so the indices in use are not
+ * 0..count-1 after a reconfiguration. Buffers pending release still
+ * hold theirs until firmware returns them.
+ */
+static u32 msm_vidc_free_internal_buffer_index(struct msm_vidc_buffers *buffers)
+{
+	struct msm_vidc_buffer *buf;
+	u32 index = 0;
+	bool used;
+
+	do {
+		used = false;
+		list_for_each_entry(buf, &buffers->list, list) {
+			if (buf->index == index) {
+				used = true;
+				index++;
+				break;
+			}
+		}
+	} while (used);
+
+	return index;
+}
+
 int msm_vidc_create_internal_buffer(struct msm_vidc_inst *inst,
-	enum msm_vidc_buffer_type buffer_type, u32 index)
+	enum msm_vidc_buffer_type buffer_type)
 {
 	int rc = 0;
 	struct msm_vidc_buffers *buffers;
@@ -2858,7 +3215,7 @@ int msm_vidc_create_internal_buffer(struct msm_vidc_inst *inst,
 	}
 	INIT_LIST_HEAD(&buffer->list);
 	buffer->type = buffer_type;
-	buffer->index = index;
+	buffer->index = msm_vidc_free_internal_buffer_index(buffers);
 	buffer->buffer_size = buffers->size;
 	list_add_tail(&buffer->list, &buffers->list);
 
@@ -2872,6 +3229,7 @@ int msm_vidc_create_internal_buffer(struct msm_vidc_inst *inst,
 	mem->region = call_mem_op(core, buffer_region, inst, buffer_type);
 	mem->size = buffer->buffer_size;
 	mem->secure = is_secure_region(mem->region);
+	mem->map_kernel = msm_vidc_buffer_map_kernel(buffer_type);
 	rc = call_mem_op(core, memory_alloc_map, core, mem);
 	if (rc)
 		return -ENOMEM;
@@ -2880,6 +3238,7 @@ int msm_vidc_create_internal_buffer(struct msm_vidc_inst *inst,
 	buffer->dmabuf = mem->dmabuf;
 	buffer->device_addr = mem->device_addr;
 	buffer->region = mem->region;
+	inst->buf_reuse.allocated++;
 	i_vpr_h(inst, "%s: create: type: %8s, size: %9u, device_addr %#llx\n", __func__,
 		buf_name(buffer_type), buffers->size, buffer->device_addr);
 
@@ -2891,19 +3250,29 @@ int msm_vidc_create_internal_buffers(struct msm_vidc_inst *inst,
 {
 	int rc = 0;
 	struct msm_vidc_buffers *buffers;
-	int i;
+	struct msm_vidc_buffer *buf;
+	u32 retained = 0, i;
 
 	buffers = msm_vidc_get_buffers(inst, buffer_type, __func__);
 	if (!buffers)
 		return -EINVAL;
 
+	/* allocate only what the retained buffers do not cover */
+	list_for_each_entry(buf, &buffers->list, list) {
+		if (buf->attr & MSM_VIDC_ATTR_PENDING_RELEASE)
+			continue;
+		if (buf->attr & MSM_VIDC_ATTR_REUSE)
+			retained++;
+	}
+	inst->buf_reuse.reused += retained;
+
 	if (buffers->reuse) {
 		i_vpr_l(inst, "%s: reuse enabled for %s\n", __func__, buf_name(buffer_type));
 		return 0;
 	}
 
-	for (i = 0; i < buffers->min_count; i++) {
-		rc = msm_vidc_create_internal_buffer(inst, buffer_type, i);
+	for (i = retained; i < buffers->min_count; i++) {
+		rc = msm_vidc_create_internal_buffer(inst, buffer_type);
 		if (rc)
 			return rc;
 	}
@@ -3015,6 +3384,9 @@ int msm_vidc_release_internal_buffers(struct msm_vidc_inst *inst,
 		/* release only queued buffers */
 		if (!(buffer->attr & MSM_VIDC_ATTR_QUEUED))
 			continue;
+		/* keep buffers which still fit the new requirement */
+		if (buffer->attr & MSM_VIDC_ATTR_REUSE)
+			continue;
 		rc = venus_hfi_release_buffer(inst, buffer);
 		if (rc)
 			return rc;
@@ -3078,6 +3450,8 @@ int msm_vidc_vb2_buffer_done(struct msm_vidc_inst *inst,
 	vbuf->flags = buf->flags;
 	vb2->timestamp = buf->timestamp;
 	vb2->planes[0].bytesused = buf->data_size + vb2->planes[0].data_offset;
+	trace_msm_vidc_buffer_stage(inst, MSM_VIDC_BUF_STAGE_VB2_DONE,
+		buf->type, buf->index, buf->device_addr, buf->timestamp, 0);
 	vb2_buffer_done(vb2, state);
 
 	return 0;
@@ -3185,6 +3559,38 @@ fail_input_vb2q_init:
 	return rc;
 }
 
+static int msm_vidc_alloc_input_crs(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_input_cr_data *crs = &inst->enc_input_crs;
+	u32 count;
+
+	count = inst->bufq[INPUT_PORT].vb2q->max_num_buffers;
+	crs->valid = bitmap_zalloc(count, GFP_KERNEL);
+	crs->input_cr = kcalloc(count, sizeof(*crs->input_cr), GFP_KERNEL);
+	if (!crs->valid || !crs->input_cr) {
+		bitmap_free(crs->valid);
+		kfree(crs->input_cr);
+		crs->valid = NULL;
+		crs->input_cr = NULL;
+		return -ENOMEM;
+	}
+	crs->count = count;
+	crs->stale = true;
+
+	return 0;
+}
+
+static void msm_vidc_free_input_crs(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_input_cr_data *crs = &inst->enc_input_crs;
+
+	bitmap_free(crs->valid);
+	kfree(crs->input_cr);
+	crs->valid = NULL;
+	crs->input_cr = NULL;
+	crs->count = 0;
+}
+
 int msm_vidc_vb2_queue_init(struct msm_vidc_inst *inst)
 {
 	int rc = 0;
@@ -3241,8 +3647,16 @@ int msm_vidc_vb2_queue_init(struct msm_vidc_inst *inst)
 	if (rc)
 		goto fail_out_meta_vb2q_init;
 
+	rc = msm_vidc_alloc_input_crs(inst);
+	if (rc) {
+		i_vpr_e(inst, "%s: input cr allocation failed\n", __func__);
+		goto fail_input_crs_alloc;
+	}
+
 	return 0;
 
+fail_input_crs_alloc:
+	vb2_queue_release(inst->bufq[OUTPUT_META_PORT].vb2q);
 fail_out_meta_vb2q_init:
 	vfree(inst->bufq[OUTPUT_META_PORT].vb2q);
 	inst->bufq[OUTPUT_META_PORT].vb2q = NULL;
@@ -3273,6 +3687,8 @@ int msm_vidc_vb2_queue_deinit(struct msm_vidc_inst *inst)
 		return 0;
 	}
 
+	msm_vidc_free_input_crs(inst);
+
 	/*
 	 * vb2_queue_release() for input and output queues
 	 * is called from v4l2_m2m_ctx_release()
@@ -3382,7 +3798,7 @@ int msm_vidc_session_open(struct msm_vidc_inst *inst)
 {
 	int rc = 0;
 
-	inst->packet_size = 4096;
+	inst->packet_size = MSM_VIDC_SESSION_PACKET_SIZE;
 	inst->packet = vzalloc(inst->packet_size);
 	if (!inst->packet) {
 		i_vpr_e(inst, "%s: allocation failed\n", __func__);
@@ -3509,6 +3925,9 @@ int msm_vidc_session_streamoff(struct msm_vidc_inst *inst,
 	if (rc)
 		goto error;
 
+	/* internal buffers returned by the stop are not reused until streamon */
+	msm_vidc_free_oversized_internal_buffers(inst);
+
 	/* flush deferred buffers */
 	msm_vidc_flush_buffers(inst, buffer_type);
 	msm_vidc_flush_read_only_buffers(inst, buffer_type);
@@ -3577,385 +3996,6 @@ int msm_vidc_kill_session(struct msm_vidc_inst *inst)
 	return 0;
 }
 
-int msm_vidc_get_inst_capability(struct msm_vidc_inst *inst)
-{
-	int rc = 0;
-	int i;
-	u32 codecs_count = 0;
-	struct msm_vidc_core *core;
-
-	core = inst->core;
-
-	codecs_count = core->enc_codecs_count + core->dec_codecs_count;
-
-	for (i = 0; i < codecs_count; i++) {
-		if (core->inst_caps[i].domain == inst->domain &&
-			core->inst_caps[i].codec == inst->codec) {
-			i_vpr_h(inst,
-				"%s: copied capabilities with %#x codec, %#x domain\n",
-				__func__, inst->codec, inst->domain);
-			memcpy(&inst->capabilities[0], &core->inst_caps[i].cap[0],
-			(INST_CAP_MAX + 1) * sizeof(struct msm_vidc_inst_cap));
-		}
-	}
-
-	return rc;
-}
-
-int msm_vidc_init_core_caps(struct msm_vidc_core *core)
-{
-	int rc = 0;
-	int i, num_platform_caps;
-	struct msm_platform_core_capability *platform_data;
-
-	platform_data = core->platform->data.core_data;
-	if (!platform_data) {
-		d_vpr_e("%s: platform core data is NULL\n",
-				__func__);
-			rc = -EINVAL;
-			goto exit;
-	}
-
-	num_platform_caps = core->platform->data.core_data_size;
-
-	/* loop over platform caps */
-	for (i = 0; i < num_platform_caps && i < CORE_CAP_MAX; i++) {
-		core->capabilities[platform_data[i].type].type = platform_data[i].type;
-		core->capabilities[platform_data[i].type].value = platform_data[i].value;
-	}
-
-exit:
-	return rc;
-}
-
-static int update_inst_capability(struct msm_platform_inst_capability *in,
-		struct msm_vidc_inst_capability *capability)
-{
-	if (!in || !capability) {
-		d_vpr_e("%s: invalid params %pK %pK\n",
-			__func__, in, capability);
-		return -EINVAL;
-	}
-	if (in->cap_id >= INST_CAP_MAX) {
-		d_vpr_e("%s: invalid cap id %d\n", __func__, in->cap_id);
-		return -EINVAL;
-	}
-
-	capability->cap[in->cap_id].cap_id = in->cap_id;
-	capability->cap[in->cap_id].min = in->min;
-	capability->cap[in->cap_id].max = in->max;
-	capability->cap[in->cap_id].step_or_mask = in->step_or_mask;
-	capability->cap[in->cap_id].value = in->value;
-	capability->cap[in->cap_id].flags = in->flags;
-	capability->cap[in->cap_id].v4l2_id = in->v4l2_id;
-	capability->cap[in->cap_id].hfi_id = in->hfi_id;
-
-	return 0;
-}
-
-static int update_inst_cap_dependency(
-	struct msm_platform_inst_cap_dependency *in,
-	struct msm_vidc_inst_capability *capability)
-{
-	if (!in || !capability) {
-		d_vpr_e("%s: invalid params %pK %pK\n",
-			__func__, in, capability);
-		return -EINVAL;
-	}
-	if (in->cap_id >= INST_CAP_MAX) {
-		d_vpr_e("%s: invalid cap id %d\n", __func__, in->cap_id);
-		return -EINVAL;
-	}
-
-	if (capability->cap[in->cap_id].cap_id != in->cap_id) {
-		d_vpr_e("%s: invalid cap id %d\n", __func__, in->cap_id);
-		return -EINVAL;
-	}
-
-	memcpy(capability->cap[in->cap_id].children, in->children,
-		sizeof(capability->cap[in->cap_id].children));
-	capability->cap[in->cap_id].adjust = in->adjust;
-	capability->cap[in->cap_id].set = in->set;
-
-	return 0;
-}
-
-int msm_vidc_init_instance_caps(struct msm_vidc_core *core)
-{
-	int rc = 0;
-	u8 enc_valid_codecs, dec_valid_codecs;
-	u8 count_bits, codecs_count = 0;
-	u8 enc_codecs_count = 0, dec_codecs_count = 0;
-	int i, j, check_bit;
-	int num_platform_cap_data, num_platform_cap_dependency_data;
-	struct msm_platform_inst_capability *platform_cap_data = NULL;
-	struct msm_platform_inst_cap_dependency *platform_cap_dependency_data = NULL;
-
-	platform_cap_data = core->platform->data.inst_cap_data;
-	if (!platform_cap_data) {
-		d_vpr_e("%s: platform instance cap data is NULL\n",
-				__func__);
-			rc = -EINVAL;
-		goto error;
-	}
-
-	platform_cap_dependency_data = core->platform->data.inst_cap_dependency_data;
-	if (!platform_cap_dependency_data) {
-		d_vpr_e("%s: platform instance cap dependency data is NULL\n",
-				__func__);
-			rc = -EINVAL;
-		goto error;
-	}
-
-	enc_valid_codecs = core->capabilities[ENC_CODECS].value;
-	count_bits = enc_valid_codecs;
-	COUNT_BITS(count_bits, enc_codecs_count);
-	core->enc_codecs_count = enc_codecs_count;
-
-	dec_valid_codecs = core->capabilities[DEC_CODECS].value;
-	count_bits = dec_valid_codecs;
-	COUNT_BITS(count_bits, dec_codecs_count);
-	core->dec_codecs_count = dec_codecs_count;
-
-	codecs_count = enc_codecs_count + dec_codecs_count;
-	core->inst_caps = devm_kzalloc(&core->pdev->dev,
-		codecs_count * sizeof(struct msm_vidc_inst_capability), GFP_KERNEL);
-	if (!core->inst_caps) {
-		d_vpr_e("%s: failed to alloc memory for instance caps\n", __func__);
-		rc = -ENOMEM;
-		goto error;
-	}
-
-	check_bit = 0;
-	/* determine codecs for enc domain */
-	for (i = 0; i < enc_codecs_count; i++) {
-		while (check_bit < (sizeof(enc_valid_codecs) * 8)) {
-			if (enc_valid_codecs & BIT(check_bit)) {
-				core->inst_caps[i].domain = MSM_VIDC_ENCODER;
-				core->inst_caps[i].codec = enc_valid_codecs &
-						BIT(check_bit);
-				check_bit++;
-				break;
-			}
-			check_bit++;
-		}
-	}
-
-	/* reset checkbit to check from 0th bit of decoder codecs set bits*/
-	check_bit = 0;
-	/* determine codecs for dec domain */
-	for (; i < codecs_count; i++) {
-		while (check_bit < (sizeof(dec_valid_codecs) * 8)) {
-			if (dec_valid_codecs & BIT(check_bit)) {
-				core->inst_caps[i].domain = MSM_VIDC_DECODER;
-				core->inst_caps[i].codec = dec_valid_codecs &
-						BIT(check_bit);
-				check_bit++;
-				break;
-			}
-			check_bit++;
-		}
-	}
-
-	num_platform_cap_data = core->platform->data.inst_cap_data_size;
-	num_platform_cap_dependency_data = core->platform->data.inst_cap_dependency_data_size;
-	d_vpr_h("%s: num caps %d, dependency %d\n", __func__,
-		num_platform_cap_data, num_platform_cap_dependency_data);
-
-	/* loop over each platform capability */
-	for (i = 0; i < num_platform_cap_data; i++) {
-		/* select matching core codec and update it */
-		for (j = 0; j < codecs_count; j++) {
-			if ((platform_cap_data[i].domain &
-				core->inst_caps[j].domain) &&
-				(platform_cap_data[i].codec &
-				core->inst_caps[j].codec)) {
-				/* update core capability */
-				rc = update_inst_capability(&platform_cap_data[i],
-					&core->inst_caps[j]);
-				if (rc)
-					return rc;
-			}
-		}
-	}
-
-	/* loop over each platform dependency capability */
-	for (i = 0; i < num_platform_cap_dependency_data; i++) {
-		/* select matching core codec and update it */
-		for (j = 0; j < codecs_count; j++) {
-			if ((platform_cap_dependency_data[i].domain &
-				core->inst_caps[j].domain) &&
-				(platform_cap_dependency_data[i].codec &
-				core->inst_caps[j].codec)) {
-				/* update core dependency capability */
-				rc = update_inst_cap_dependency(
-					&platform_cap_dependency_data[i],
-					&core->inst_caps[j]);
-				if (rc)
-					return rc;
-			}
-		}
-	}
-
-error:
-	return rc;
-}
-
-int msm_vidc_core_deinit_locked(struct msm_vidc_core *core, bool force)
-{
-	int rc = 0;
-	struct msm_vidc_inst *inst, *dummy;
-	enum msm_vidc_allow allow;
-
-	rc = __strict_check(core, __func__);
-	if (rc) {
-		d_vpr_e("%s(): core was not locked\n", __func__);
-		return rc;
-	}
-
-	if (is_core_state(core, MSM_VIDC_CORE_DEINIT))
-		return 0;
-
-	/* print error for state change not allowed case */
-	allow = msm_vidc_allow_core_state_change(core, MSM_VIDC_CORE_DEINIT);
-	if (allow != MSM_VIDC_ALLOW)
-		d_vpr_e("%s: %s core state change %s -> %s\n", __func__,
-			allow_name(allow), core_state_name(core->state),
-			core_state_name(MSM_VIDC_CORE_DEINIT));
-
-	if (force) {
-		d_vpr_e("%s(): force deinit core\n", __func__);
-	} else {
-		/* in normal case, deinit core only if no session present */
-		if (!list_empty(&core->instances)) {
-			d_vpr_h("%s(): skip deinit\n", __func__);
-			return 0;
-		} else {
-			d_vpr_h("%s(): deinit core\n", __func__);
-		}
-	}
-
-	venus_hfi_core_deinit(core, force);
-
-	/* unlink all sessions from core, if any */
-	list_for_each_entry_safe(inst, dummy, &core->instances, list) {
-		msm_vidc_change_state(inst, MSM_VIDC_ERROR, __func__);
-		list_move_tail(&inst->list, &core->dangling_instances);
-	}
-	msm_vidc_change_core_state(core, MSM_VIDC_CORE_DEINIT, __func__);
-
-	return rc;
-}
-
-int msm_vidc_core_deinit(struct msm_vidc_core *core, bool force)
-{
-	int rc = 0;
-
-	core_lock(core, __func__);
-	rc = msm_vidc_core_deinit_locked(core, force);
-	core_unlock(core, __func__);
-
-	return rc;
-}
-
-int msm_vidc_core_init_wait(struct msm_vidc_core *core)
-{
-	const int interval = 10;
-	int max_tries, count = 0, rc = 0;
-
-	core_lock(core, __func__);
-	if (is_core_state(core, MSM_VIDC_CORE_INIT)) {
-		rc = 0;
-		goto unlock;
-	} else if (is_core_state(core, MSM_VIDC_CORE_DEINIT) ||
-		   is_core_state(core, MSM_VIDC_CORE_ERROR)) {
-		d_vpr_e("%s: invalid core state %s\n",
-			__func__, core_state_name(core->state));
-		rc = -EINVAL;
-		goto unlock;
-	}
-
-	d_vpr_h("%s(): waiting for state change\n", __func__);
-	max_tries = core->capabilities[HW_RESPONSE_TIMEOUT].value / interval;
-	while (count < max_tries) {
-		if (core->state != MSM_VIDC_CORE_INIT_WAIT)
-			break;
-
-		core_unlock(core, __func__);
-		msleep_interruptible(interval);
-		core_lock(core, __func__);
-		count++;
-	}
-	d_vpr_h("%s: state %s, interval %u, count %u, max_tries %u\n", __func__,
-		core_state_name(core->state), interval, count, max_tries);
-
-	if (is_core_state(core, MSM_VIDC_CORE_INIT)) {
-		d_vpr_h("%s: sys init successful\n", __func__);
-		rc = 0;
-		goto unlock;
-	} else if (is_core_state(core, MSM_VIDC_CORE_INIT_WAIT)) {
-		d_vpr_h("%s: sys init wait timedout. state %s\n",
-			__func__, core_state_name(core->state));
-		msm_vidc_change_core_state(core, MSM_VIDC_CORE_ERROR, __func__);
-		/* mark video hw unresponsive */
-		msm_vidc_change_core_sub_state(core,
-			0, CORE_SUBSTATE_VIDEO_UNRESPONSIVE, __func__);
-		/* core deinit to handle error */
-		msm_vidc_core_deinit_locked(core, true);
-		rc = -EINVAL;
-		goto unlock;
-	} else {
-		d_vpr_e("%s: invalid core state %s\n",
-			__func__, core_state_name(core->state));
-		rc = -EINVAL;
-		goto unlock;
-	}
-unlock:
-	core_unlock(core, __func__);
-	return rc;
-}
-
-int msm_vidc_core_init(struct msm_vidc_core *core)
-{
-	enum msm_vidc_allow allow;
-	int rc = 0;
-
-	core_lock(core, __func__);
-	if (core_in_valid_state(core)) {
-		goto unlock;
-	} else if (is_core_state(core, MSM_VIDC_CORE_ERROR)) {
-		d_vpr_e("%s: invalid core state %s\n",
-			__func__, core_state_name(core->state));
-		rc = -EINVAL;
-		goto unlock;
-	}
-
-	/* print error for state change not allowed case */
-	allow = msm_vidc_allow_core_state_change(core, MSM_VIDC_CORE_INIT_WAIT);
-	if (allow != MSM_VIDC_ALLOW)
-		d_vpr_e("%s: %s core state change %s -> %s\n", __func__,
-			allow_name(allow), core_state_name(core->state),
-			core_state_name(MSM_VIDC_CORE_INIT_WAIT));
-
-	msm_vidc_change_core_state(core, MSM_VIDC_CORE_INIT_WAIT, __func__);
-	/* clear PM suspend from core sub_state */
-	msm_vidc_change_core_sub_state(core, CORE_SUBSTATE_PM_SUSPEND, 0, __func__);
-	msm_vidc_change_core_sub_state(core, CORE_SUBSTATE_PAGE_FAULT, 0, __func__);
-
-	rc = venus_hfi_core_init(core);
-	if (rc) {
-		msm_vidc_change_core_state(core, MSM_VIDC_CORE_ERROR, __func__);
-		d_vpr_e("%s: core init failed\n", __func__);
-		/* do core deinit to handle error */
-		msm_vidc_core_deinit_locked(core, true);
-		goto unlock;
-	}
-
-unlock:
-	core_unlock(core, __func__);
-	return rc;
-}
-
 int msm_vidc_print_residency_stats(struct msm_vidc_core *core)
 {
 	int rc = 0;
@@ -3978,6 +4018,10 @@ int msm_vidc_reset_residency_stats(struct msm_vidc_core *core)
 	rc = call_res_op(core, clk_reset_residency_stats, core);
 	if (rc)
 		goto unlock;
+	/* a collapse in progress keeps accruing from now, like the clocks */
+	core->pc_stats.collapsed_ns = 0;
+	if (core->pc_stats.collapsed_start_ns)
+		core->pc_stats.collapsed_start_ns = ktime_get_ns();
 
 unlock:
 	core_unlock(core, __func__);
@@ -4304,6 +4348,21 @@ int cancel_stability_work_sync(struct msm_vidc_inst *inst)
 	return 0;
 }
 
+/* brings the core up ahead of the first open */
+void msm_vidc_core_init_handler(struct work_struct *work)
+{
+	struct msm_vidc_core *core;
+	int rc = 0;
+
+	core = container_of(work, struct msm_vidc_core, init_work);
+
+	rc = msm_vidc_core_init(core);
+	if (!rc)
+		rc = msm_vidc_core_init_wait(core);
+	if (rc)
+		d_vpr_e("%s: core init failed, retrying at open\n", __func__);
+}
+
 void msm_vidc_fw_unload_handler(struct work_struct *work)
 {
 	struct msm_vidc_core *core = NULL;
@@ -4379,6 +4438,7 @@ int msm_vidc_flush_buffers(struct msm_vidc_inst *inst,
 	core = inst->core;
 
 	if (is_input_buffer(type)) {
+		msm_vidc_flush_input_fences(inst);
 		buffer_type[0] = MSM_VIDC_BUF_INPUT_META;
 		buffer_type[1] = MSM_VIDC_BUF_INPUT;
 	} else if (is_output_buffer(type)) {
@@ -4409,6 +4469,7 @@ int msm_vidc_flush_buffers(struct msm_vidc_inst *inst,
 						}
 					}
 					buf->data_size = 0;
+					msm_vidc_update_input_size(inst, buf);
 					msm_vidc_vb2_buffer_done(inst, buf);
 				}
 			}
@@ -4466,7 +4527,6 @@ void msm_vidc_destroy_buffers(struct msm_vidc_inst *inst)
 	struct msm_vidc_input_timer *timer, *dummy_timer;
 	struct msm_vidc_buffer_stats *stats, *dummy_stats;
 	struct msm_vidc_inst_cap_entry *entry, *dummy_entry;
-	struct msm_vidc_input_cr_data *cr, *dummy_cr;
 	struct msm_vidc_fence *fence, *dummy_fence;
 	struct msm_vidc_core *core;
 
@@ -4591,28 +4651,11 @@ void msm_vidc_destroy_buffers(struct msm_vidc_inst *inst)
 		call_mem_op(core, dma_buf_put_completely, inst, dbuf);
 	}
 
-	list_for_each_entry_safe(entry, dummy_entry, &inst->firmware_list, list) {
-		i_vpr_e(inst, "%s: fw list: %s\n", __func__, cap_name(entry->cap_id));
-		list_del(&entry->list);
-		vfree(entry);
-	}
-
-	list_for_each_entry_safe(entry, dummy_entry, &inst->children_list, list) {
-		i_vpr_e(inst, "%s: child list: %s\n", __func__, cap_name(entry->cap_id));
-		list_del(&entry->list);
-		vfree(entry);
-	}
-
 	list_for_each_entry_safe(entry, dummy_entry, &inst->caps_list, list) {
 		list_del(&entry->list);
 		vfree(entry);
 	}
 
-	list_for_each_entry_safe(cr, dummy_cr, &inst->enc_input_crs, list) {
-		list_del(&cr->list);
-		vfree(cr);
-	}
-
 	list_for_each_entry_safe(fence, dummy_fence, &inst->fence_list, list) {
 		i_vpr_e(inst, "%s: destroying fence %s\n", __func__, fence->name);
 		call_fence_op(core, fence_destroy, inst, fence->fence_id);
@@ -4631,6 +4674,7 @@ static void msm_vidc_close_helper(struct kref *kref)
 	core = inst->core;
 
 	i_vpr_h(inst, "%s()\n", __func__);
+	msm_vidc_cancel_inst_work(inst);
 	msm_vidc_debugfs_deinit_inst(inst);
 	msm_vidc_fence_deinit(inst);
 	if (is_decode_session(inst))
@@ -4647,14 +4691,11 @@ static void msm_vidc_close_helper(struct kref *kref)
 	msm_vidc_vb2_queue_deinit(inst);
 	msm_vidc_v4l2_fh_deinit(inst);
 	inst_unlock(inst, __func__);
-	destroy_workqueue(inst->workq);
 	msm_vidc_destroy_buffers(inst);
 	msm_vidc_remove_session(inst);
 	msm_vidc_remove_dangling_session(inst);
-	mutex_destroy(&inst->client_lock);
-	mutex_destroy(&inst->ctx_q_lock);
-	mutex_destroy(&inst->lock);
-	vfree(inst);
+	kfree(inst->pending_pkts.data);
+	msm_vidc_free_inst_shell(inst);
 }
 
 struct msm_vidc_inst *get_inst_ref(struct msm_vidc_core *core,
@@ -4711,13 +4752,35 @@ void core_unlock(struct msm_vidc_core *core, const char *function)
 void inst_lock(struct msm_vidc_inst *inst, const char *function)
 {
 	mutex_lock(&inst->lock);
+	mutex_lock(&inst->buffer_lock);
 }
 
 void inst_unlock(struct msm_vidc_inst *inst, const char *function)
 {
+	mutex_unlock(&inst->buffer_lock);
 	mutex_unlock(&inst->lock);
 }
 
+void ctrl_lock(struct msm_vidc_inst *inst, const char *function)
+{
+	mutex_lock(&inst->lock);
+}
+
+void ctrl_unlock(struct msm_vidc_inst *inst, const char *function)
+{
+	mutex_unlock(&inst->lock);
+}
+
+void buffer_lock(struct msm_vidc_inst *inst, const char *function)
+{
+	mutex_lock(&inst->buffer_lock);
+}
+
+void buffer_unlock(struct msm_vidc_inst *inst, const char *function)
+{
+	mutex_unlock(&inst->buffer_lock);
+}
+
 void client_lock(struct msm_vidc_inst *inst, const char *function)
 {
 	mutex_lock(&inst->client_lock);
@@ -4922,7 +4985,7 @@ static int msm_vidc_print_running_instances_info(struct msm_vidc_core *core)
 {
 	struct msm_vidc_inst *inst;
 	u32 height, width, fps, orate;
-	struct msm_vidc_inst_cap *cap;
+	struct msm_vidc_inst_cap_state *cap;
 	struct v4l2_format *out_f;
 	struct v4l2_format *inp_f;
 	char prop[64];
@@ -5153,7 +5216,7 @@ int msm_vidc_check_core_mbpf(struct msm_vidc_inst *inst)
 static int msm_vidc_check_inst_mbpf(struct msm_vidc_inst *inst)
 {
 	u32 mbpf = 0, max_mbpf = 0;
-	struct msm_vidc_inst_cap *cap;
+	struct msm_vidc_inst_cap_state *cap;
 
 	cap = &inst->capabilities[0];
 
@@ -5207,7 +5270,7 @@ u32 msm_vidc_get_max_bitrate(struct msm_vidc_inst *inst)
 
 static bool msm_vidc_allow_image_encode_session(struct msm_vidc_inst *inst)
 {
-	struct msm_vidc_inst_cap *cap;
+	struct msm_vidc_inst_cap_state *cap;
 	struct v4l2_format *fmt;
 	u32 min_width, min_height, max_width, max_height, pix_fmt, profile;
 	bool allow = false;
@@ -5296,7 +5359,7 @@ exit:
 
 static int msm_vidc_check_resolution_supported(struct msm_vidc_inst *inst)
 {
-	struct msm_vidc_inst_cap *cap;
+	struct msm_vidc_inst_cap_state *cap;
 	u32 width = 0, height = 0, min_width, min_height,
 		max_width, max_height;
 	bool is_interlaced = false;
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copyright (c) 2020-2021, The Linux Foundation. All rights reserved.
+ * Copyright (c) 2022-2024 Qualcomm Innovation Center, Inc. All rights reserved.
+ */
+
+#include "msm_vidc_inst.h"
+#include "msm_vidc_core.h"
+#include "msm_vidc_driver.h"
+#include "msm_vidc_debug.h"
+
+/* pre-initialized instances kept around for a fast open */
+#define MSM_VIDC_INST_CACHE_SIZE 2
+
+/*
+ * Session work runs on the shared core->inst_workq. Each session posts it
+ * through its single inst->work item, which the workqueue never runs on
+ * two workers at once: debugfs, input fence and stats work of a session
+ * run one at a time, as on a per-session ordered workqueue, while
+ * different sessions proceed in parallel. Events posted while the handler
+ * runs requeue inst->work and are picked up by the next pass.
+ */
+void msm_vidc_queue_inst_work(struct msm_vidc_inst *inst,
+	enum msm_vidc_inst_work type)
+{
+	struct msm_vidc_core *core = inst->core;
+
+	set_bit(type, &inst->work_pending);
+	queue_work(core->inst_workq, &inst->work);
+}
+
+void msm_vidc_inst_work_handler(struct work_struct *work)
+{
+	struct msm_vidc_inst *inst;
+	unsigned long pending;
+
+	inst = container_of(work, struct msm_vidc_inst, work);
+
+	pending = xchg(&inst->work_pending, 0);
+	if (pending & BIT(MSM_VIDC_INST_WORK_DEBUGFS))
+		msm_vidc_debugfs_work(inst);
+	if (pending & BIT(MSM_VIDC_INST_WORK_INPUT_FENCE))
+		msm_vidc_input_fence_work(inst);
+	if (pending & BIT(MSM_VIDC_INST_WORK_STATS))
+		msm_vidc_stats_work(inst);
+}
+
+void msm_vidc_cancel_inst_work(struct msm_vidc_inst *inst)
+{
+	/* the stats pass re-arms stats_work, the stats timer requeues work */
+	do {
+		cancel_delayed_work_sync(&inst->stats_work);
+	} while (cancel_work_sync(&inst->work) ||
+		 delayed_work_pending(&inst->stats_work));
+
+	inst->work_pending = 0;
+}
+
+/*
+ * Everything here only depends on the memory being zeroed, so it is done
+ * ahead of time for cached shells and msm_vidc_open only fills in the
+ * session specific state.
+ */
+static struct msm_vidc_inst *msm_vidc_alloc_inst_shell(void)
+{
+	struct msm_vidc_inst *inst;
+	int i;
+
+	inst = vzalloc(sizeof(*inst));
+	if (!inst)
+		return NULL;
+
+	mutex_init(&inst->lock);
+	mutex_init(&inst->buffer_lock);
+	mutex_init(&inst->ctx_q_lock);
+	mutex_init(&inst->client_lock);
+	INIT_LIST_HEAD(&inst->list);
+	INIT_LIST_HEAD(&inst->caps_list);
+	INIT_LIST_HEAD(&inst->timestamps.list);
+	INIT_LIST_HEAD(&inst->ts_reorder.list);
+	INIT_LIST_HEAD(&inst->buffers.input.list);
+	INIT_LIST_HEAD(&inst->buffers.input_meta.list);
+	INIT_LIST_HEAD(&inst->buffers.output.list);
+	INIT_LIST_HEAD(&inst->buffers.output_meta.list);
+	INIT_LIST_HEAD(&inst->buffers.read_only.list);
+	INIT_LIST_HEAD(&inst->buffers.bin.list);
+	INIT_LIST_HEAD(&inst->buffers.arp.list);
+	INIT_LIST_HEAD(&inst->buffers.comv.list);
+	INIT_LIST_HEAD(&inst->buffers.non_comv.list);
+	INIT_LIST_HEAD(&inst->buffers.line.list);
+	INIT_LIST_HEAD(&inst->buffers.dpb.list);
+	INIT_LIST_HEAD(&inst->buffers.persist.list);
+	INIT_LIST_HEAD(&inst->buffers.vpss.list);
+	INIT_LIST_HEAD(&inst->buffers.partial_data.list);
+	INIT_LIST_HEAD(&inst->mem_info.bin.list);
+	INIT_LIST_HEAD(&inst->mem_info.arp.list);
+	INIT_LIST_HEAD(&inst->mem_info.comv.list);
+	INIT_LIST_HEAD(&inst->mem_info.non_comv.list);
+	INIT_LIST_HEAD(&inst->mem_info.line.list);
+	INIT_LIST_HEAD(&inst->mem_info.dpb.list);
+	INIT_LIST_HEAD(&inst->mem_info.persist.list);
+	INIT_LIST_HEAD(&inst->mem_info.vpss.list);
+	INIT_LIST_HEAD(&inst->mem_info.partial_data.list);
+	INIT_LIST_HEAD(&inst->dmabuf_tracker);
+	INIT_LIST_HEAD(&inst->input_timer_list);
+	INIT_LIST_HEAD(&inst->fence_list);
+	INIT_LIST_HEAD(&inst->buffer_stats_list);
+	inst->enc_input_crs.stale = true;
+	for (i = 0; i < MAX_SIGNAL; i++)
+		init_completion(&inst->completions[i]);
+
+	INIT_WORK(&inst->work, msm_vidc_inst_work_handler);
+	INIT_DELAYED_WORK(&inst->stats_work, msm_vidc_stats_handler);
+	INIT_WORK(&inst->stability_work, msm_vidc_stability_handler);
+	INIT_LIST_HEAD(&inst->input_fence_list);
+
+	return inst;
+}
+
+void msm_vidc_free_inst_shell(struct msm_vidc_inst *inst)
+{
+	mutex_destroy(&inst->client_lock);
+	mutex_destroy(&inst->ctx_q_lock);
+	mutex_destroy(&inst->buffer_lock);
+	mutex_destroy(&inst->lock);
+	vfree(inst);
+}
+
+struct msm_vidc_inst *msm_vidc_get_inst_shell(struct msm_vidc_core *core)
+{
+	struct msm_vidc_inst *inst = NULL;
+
+	spin_lock(&core->inst_cache_lock);
+	if (!list_empty(&core->inst_cache)) {
+		inst = list_first_entry(&core->inst_cache,
+			struct msm_vidc_inst, list);
+		list_del_init(&inst->list);
+		core->inst_cache_count--;
+	}
+	spin_unlock(&core->inst_cache_lock);
+
+	queue_work(core->inst_workq, &core->inst_cache_work);
+
+	if (!inst)
+		inst = msm_vidc_alloc_inst_shell();
+
+	return inst;
+}
+
+void msm_vidc_inst_cache_handler(struct work_struct *work)
+{
+	struct msm_vidc_core *core;
+	struct msm_vidc_inst *inst;
+	bool full;
+
+	core = container_of(work, struct msm_vidc_core, inst_cache_work);
+
+	while (1) {
+		spin_lock(&core->inst_cache_lock);
+		full = core->inst_cache_count >= MSM_VIDC_INST_CACHE_SIZE;
+		spin_unlock(&core->inst_cache_lock);
+		if (full)
+			break;
+
+		inst = msm_vidc_alloc_inst_shell();
+		if (!inst) {
+			d_vpr_e("%s: allocation failed\n", __func__);
+			break;
+		}
+
+		spin_lock(&core->inst_cache_lock);
+		list_add_tail(&inst->list, &core->inst_cache);
+		core->inst_cache_count++;
+		spin_unlock(&core->inst_cache_lock);
+	}
+}
+
+void msm_vidc_inst_cache_deinit(struct msm_vidc_core *core)
+{
+	struct msm_vidc_inst *inst, *dummy;
+	LIST_HEAD(list);
+
+	cancel_work_sync(&core->inst_cache_work);
+
+	spin_lock(&core->inst_cache_lock);
+	list_splice_init(&core->inst_cache, &list);
+	core->inst_cache_count = 0;
+	spin_unlock(&core->inst_cache_lock);
+
+	list_for_each_entry_safe(inst, dummy, &list, list) {
+		list_del(&inst->list);
+		msm_vidc_free_inst_shell(inst);
+	}
+}
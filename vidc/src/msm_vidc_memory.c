@@ -34,8 +34,6 @@ static const struct msm_vidc_type_size_name buftype_size_name_arr[] = {
 	{MSM_MEM_POOL_ALLOC_MAP,  sizeof(struct msm_vidc_mem),        "MSM_MEM_POOL_ALLOC_MAP"  },
 	{MSM_MEM_POOL_TIMESTAMP,  sizeof(struct msm_vidc_timestamp),  "MSM_MEM_POOL_TIMESTAMP"  },
 	{MSM_MEM_POOL_DMABUF,     sizeof(struct msm_memory_dmabuf),   "MSM_MEM_POOL_DMABUF"     },
-	{MSM_MEM_POOL_PACKET,     sizeof(struct hfi_pending_packet) + MSM_MEM_POOL_PACKET_SIZE,
-		"MSM_MEM_POOL_PACKET"},
 	{MSM_MEM_POOL_BUF_TIMER,  sizeof(struct msm_vidc_input_timer), "MSM_MEM_POOL_BUF_TIMER" },
 	{MSM_MEM_POOL_BUF_STATS,  sizeof(struct msm_vidc_buffer_stats), "MSM_MEM_POOL_BUF_STATS"},
 };
@@ -385,6 +383,12 @@ static int msm_vidc_memory_alloc_map(struct msm_vidc_core *core, struct msm_vidc
 
 	size = ALIGN(mem->size, SZ_4K);
 	mem->attrs = DMA_ATTR_WRITE_COMBINE;
+	/*
+	 * skip the vmalloc mapping for device-only memory, kvaddr is then
+	 * an opaque cookie for dma_free_attrs and must not be dereferenced
+	 */
+	if (!mem->map_kernel)
+		mem->attrs |= DMA_ATTR_NO_KERNEL_MAPPING;
 
 	cb = msm_vidc_get_context_bank_for_region(core, mem->region);
 	if (!cb) {
@@ -400,9 +404,9 @@ static int msm_vidc_memory_alloc_map(struct msm_vidc_core *core, struct msm_vidc
 	}
 
 	d_vpr_h(
-		"%s: dmabuf %pK, size %d, buffer_type %s, secure %d, region %d\n",
+		"%s: dmabuf %pK, size %d, buffer_type %s, secure %d, region %d, kmap %d\n",
 		__func__, mem->kvaddr, mem->size, buf_name(mem->type),
-		mem->secure, mem->region);
+		mem->secure, mem->region, mem->map_kernel);
 
 	return 0;
 }
@@ -112,11 +112,11 @@ u64 msm_vidc_max_freq(struct msm_vidc_inst *inst)
 static int fill_dynamic_stats(struct msm_vidc_inst *inst,
 	struct vidc_bus_vote_data *vote_data)
 {
-	struct msm_vidc_input_cr_data *temp, *next;
+	struct msm_vidc_input_cr_data *crs = &inst->enc_input_crs;
 	u32 cf = MSM_VIDC_MAX_UBWC_COMPLEXITY_FACTOR;
 	u32 cr = MSM_VIDC_MIN_UBWC_COMPRESSION_RATIO;
-	u32 input_cr = MSM_VIDC_MIN_UBWC_COMPRESSION_RATIO;
-	u32 frame_size;
+	u32 input_cr;
+	u32 frame_size, i;
 
 	if (inst->power.fw_cr)
 		cr = inst->power.fw_cr;
@@ -128,8 +128,18 @@ static int fill_dynamic_stats(struct msm_vidc_inst *inst,
 			cf = cf / frame_size;
 	}
 
-	list_for_each_entry_safe(temp, next, &inst->enc_input_crs, list)
-		input_cr = min(input_cr, temp->input_cr);
+	if (crs->stale) {
+		crs->min_cr = MSM_VIDC_MIN_UBWC_COMPRESSION_RATIO;
+		crs->min_index = 0;
+		for_each_set_bit(i, crs->valid, crs->count) {
+			if (crs->input_cr[i] <= crs->min_cr) {
+				crs->min_cr = crs->input_cr[i];
+				crs->min_index = i;
+			}
+		}
+		crs->stale = false;
+	}
+	input_cr = crs->min_cr;
 
 	vote_data->compression_ratio = cr;
 	vote_data->complexity_factor = cf;
@@ -209,6 +219,147 @@ static int msm_vidc_set_buses(struct msm_vidc_inst *inst)
 	return 0;
 }
 
+/* 2^(-k/8) in Q16, k = 0..8 */
+static const u32 exp2_neg_q16[] = {
+	65536, 60097, 55109, 50535, 46341, 42495, 38968, 35734, 32768,
+};
+
+/*
+ * Weight (Q16) an average keeps after dt_ns with the given half-life,
+ * i.e. 2^(-dt/half_life). Integer half-lives are a shift, the fraction
+ * is interpolated in eighths which is good to ~0.1%.
+ */
+static u32 msm_vidc_ewma_decay(u64 dt_ns, u64 half_life_ns)
+{
+	u64 halvings, rem, frac;
+	u32 k, w;
+
+	if (!half_life_ns)
+		return 0;
+
+	halvings = div64_u64_rem(dt_ns, half_life_ns, &rem);
+	if (halvings >= 16)
+		return 0;
+
+	frac = div64_u64(rem << 11, half_life_ns);
+	k = frac >> 8;
+	w = exp2_neg_q16[k] -
+		(((exp2_neg_q16[k] - exp2_neg_q16[k + 1]) * (u32)(frac & 0xff)) >> 8);
+
+	return w >> halvings;
+}
+
+static u32 msm_vidc_ewma(u32 avg, u32 sample, u32 w)
+{
+	return (u32)(((u64)avg * w + (u64)sample * ((1 << 16) - w)) >> 16);
+}
+
+/*
+ * Integrate the last vote up to now into the per-second slots. A vote
+ * holds until the next one, so every slot it spans is charged with it.
+ */
+void msm_vidc_advance_bw_window(struct msm_vidc_inst *inst, u64 now)
+{
+	struct msm_vidc_bw_window *win = &inst->stats.bw_window;
+	u64 slot_end, end, dt_us;
+
+	if (!win->last_ns || now <= win->last_ns) {
+		if (!win->last_ns)
+			win->slot_start_ns = win->last_ns = now;
+		return;
+	}
+
+	/* idle for longer than the whole window: nothing old survives */
+	if (now - win->slot_start_ns >=
+		(u64)MSM_VIDC_BW_WINDOW_SLOTS * NSEC_PER_SEC) {
+		memset(win->ddr_sum, 0, sizeof(win->ddr_sum));
+		memset(win->llcc_sum, 0, sizeof(win->llcc_sum));
+		memset(win->ddr_peak, 0, sizeof(win->ddr_peak));
+		memset(win->llcc_peak, 0, sizeof(win->llcc_peak));
+		win->slot_start_ns = now -
+			(u64)(MSM_VIDC_BW_WINDOW_SLOTS - 1) * NSEC_PER_SEC;
+		win->last_ns = win->slot_start_ns;
+		win->ddr_peak[win->slot] = win->last_bw_ddr;
+		win->llcc_peak[win->slot] = win->last_bw_llcc;
+	}
+
+	while (win->last_ns < now) {
+		slot_end = win->slot_start_ns + NSEC_PER_SEC;
+		end = min(now, slot_end);
+		dt_us = (end - win->last_ns) / NSEC_PER_USEC;
+		win->ddr_sum[win->slot] += (u64)win->last_bw_ddr * dt_us;
+		win->llcc_sum[win->slot] += (u64)win->last_bw_llcc * dt_us;
+		win->last_ns = end;
+		if (end < slot_end)
+			break;
+
+		win->slot = (win->slot + 1) % MSM_VIDC_BW_WINDOW_SLOTS;
+		win->slot_start_ns = slot_end;
+		win->ddr_sum[win->slot] = 0;
+		win->llcc_sum[win->slot] = 0;
+		win->ddr_peak[win->slot] = win->last_bw_ddr;
+		win->llcc_peak[win->slot] = win->last_bw_llcc;
+	}
+}
+
+/*
+ * Average and peak over the last @secs completed seconds. The slot
+ * being filled is not reported so a window is always a full one.
+ */
+void msm_vidc_get_bw_window(struct msm_vidc_inst *inst, u32 secs,
+	struct msm_vidc_bw_window_stats *ws)
+{
+	struct msm_vidc_bw_window *win = &inst->stats.bw_window;
+	u64 ddr_sum = 0, llcc_sum = 0;
+	u32 i, slot;
+
+	memset(ws, 0, sizeof(*ws));
+	secs = clamp_t(u32, secs, 1, MSM_VIDC_BW_WINDOW_SLOTS - 1);
+
+	for (i = 1; i <= secs; i++) {
+		slot = (win->slot + MSM_VIDC_BW_WINDOW_SLOTS - i) %
+			MSM_VIDC_BW_WINDOW_SLOTS;
+		ddr_sum += win->ddr_sum[slot];
+		llcc_sum += win->llcc_sum[slot];
+		ws->peak_ddr = max(ws->peak_ddr, win->ddr_peak[slot]);
+		ws->peak_llcc = max(ws->peak_llcc, win->llcc_peak[slot]);
+	}
+	ws->avg_ddr = (u32)div64_u64(ddr_sum, (u64)secs * USEC_PER_SEC);
+	ws->avg_llcc = (u32)div64_u64(llcc_sum, (u64)secs * USEC_PER_SEC);
+}
+
+/*
+ * Time-weighted EWMA: the previous vote was in force for dt, so it is
+ * folded in with weight 1 - 2^(-dt/half_life). Votes arriving in a burst
+ * barely move the average, a vote that held for long dominates it.
+ */
+static void msm_vidc_update_bw_stats(struct msm_vidc_inst *inst,
+	u32 bw_ddr, u32 bw_llcc)
+{
+	struct msm_vidc_bw_window *win = &inst->stats.bw_window;
+	u64 now = ktime_get_ns();
+	u32 w;
+
+	if (!inst->stats.bw_update_ns) {
+		inst->stats.avg_bw_ddr = bw_ddr;
+		inst->stats.avg_bw_llcc = bw_llcc;
+	} else {
+		w = msm_vidc_ewma_decay(now - inst->stats.bw_update_ns,
+			(u64)msm_vidc_bw_half_life_ms * NSEC_PER_MSEC);
+		inst->stats.avg_bw_ddr = msm_vidc_ewma(inst->stats.avg_bw_ddr,
+			inst->power.ddr_bw, w);
+		inst->stats.avg_bw_llcc = msm_vidc_ewma(inst->stats.avg_bw_llcc,
+			inst->power.sys_cache_bw, w);
+	}
+	inst->stats.bw_update_ns = now;
+
+	msm_vidc_advance_bw_window(inst, now);
+	win->last_bw_ddr = bw_ddr;
+	win->last_bw_llcc = bw_llcc;
+	win->ddr_peak[win->slot] = max(win->ddr_peak[win->slot], bw_ddr);
+	win->llcc_peak[win->slot] = max(win->llcc_peak[win->slot], bw_llcc);
+}
+
 static int msm_vidc_scale_buses(struct msm_vidc_inst *inst)
 {
 	int rc = 0;
@@ -226,7 +377,8 @@ static int msm_vidc_scale_buses(struct msm_vidc_inst *inst)
 	vote_data = &inst->bus_data;
 
 	vote_data->power_mode = VIDC_POWER_NORMAL;
-	if (inst->power.buffer_counter < DCVS_WINDOW || is_image_session(inst))
+	if (inst->power.buffer_counter < DCVS_WINDOW || is_image_session(inst) ||
+	    is_thumbnail_session(inst))
 		vote_data->power_mode = VIDC_POWER_TURBO;
 
 	if (vote_data->power_mode == VIDC_POWER_TURBO)
@@ -306,21 +458,11 @@ static int msm_vidc_scale_buses(struct msm_vidc_inst *inst)
 
 	call_session_op(core, calc_bw, inst, vote_data);
 
+	msm_vidc_update_bw_stats(inst, vote_data->calc_bw_ddr,
+		vote_data->calc_bw_llcc);
 	inst->power.ddr_bw = vote_data->calc_bw_ddr;
 	inst->power.sys_cache_bw = vote_data->calc_bw_llcc;
 
-	if (!inst->stats.avg_bw_llcc)
-		inst->stats.avg_bw_llcc = inst->power.sys_cache_bw;
-	else
-		inst->stats.avg_bw_llcc =
-			(inst->stats.avg_bw_llcc + inst->power.sys_cache_bw) / 2;
-
-	if (!inst->stats.avg_bw_ddr)
-		inst->stats.avg_bw_ddr = inst->power.ddr_bw;
-	else
-		inst->stats.avg_bw_ddr =
-			(inst->stats.avg_bw_ddr + inst->power.ddr_bw) / 2;
-
 set_buses:
 	inst->power.power_mode = vote_data->power_mode;
 	rc = msm_vidc_set_buses(inst);
@@ -330,14 +472,63 @@ set_buses:
 	return 0;
 }
 
+u64 msm_vidc_thermal_max_freq(struct msm_vidc_core *core)
+{
+	struct freq_set *freq_set = &core->resource->freq_set;
+	unsigned long state;
+
+	if (!freq_set->freq_tbl || !freq_set->count)
+		return 0;
+
+	/* cooling state N limits the clock to freq_tbl index N */
+	state = min_t(unsigned long, core->thermal_state, freq_set->count - 1);
+
+	return freq_set->freq_tbl[state].freq;
+}
+
+/*
+ * when the requested demand does not fit under the thermal cap, realtime
+ * sessions keep their full rate and non-realtime sessions share what is
+ * left, with at least MSM_VIDC_THERMAL_MIN_RATE_PCT of their rate.
+ */
+static void msm_vidc_thermal_throttle(struct msm_vidc_core *core,
+	u64 max_freq, u64 rt_demand, u64 nrt_demand)
+{
+	struct msm_vidc_inst *temp;
+	u64 budget;
+	u32 pct = 0;
+
+	if (rt_demand + nrt_demand > max_freq) {
+		budget = max_freq > rt_demand ? max_freq - rt_demand : 0;
+		pct = nrt_demand ? div64_u64(budget * 100, nrt_demand) : 100;
+		pct = clamp_t(u32, pct, MSM_VIDC_THERMAL_MIN_RATE_PCT, 100);
+		if (rt_demand > max_freq)
+			d_vpr_h("%s: realtime demand %llu exceeds thermal cap %llu\n",
+				__func__, rt_demand, max_freq);
+	}
+
+	/*
+	 * runs under core->lock, not the sessions' own locks: each session
+	 * reads its thermal_pct once per msm_vidc_scale_power()
+	 */
+	list_for_each_entry(temp, &core->instances, list) {
+		if (is_realtime_session(temp))
+			continue;
+		if (READ_ONCE(temp->power.thermal_pct) != pct)
+			i_vpr_h(temp, "%s: thermal rate %u%% (cap %llu)\n",
+				__func__, pct ? pct : 100, max_freq);
+		WRITE_ONCE(temp->power.thermal_pct, pct);
+	}
+}
+
 static int msm_vidc_set_clocks(struct msm_vidc_inst *inst)
 {
 	int rc = 0;
 	struct msm_vidc_core *core;
 	struct msm_vidc_inst *temp;
-	u64 freq;
+	u64 freq, demand, req, rt_demand, nrt_demand, max_freq;
 	u64 rate = 0;
-	bool increment, decrement;
+	bool increment, decrement, edf;
 	u64 curr_time_ns;
 	int i = 0;
 
@@ -352,7 +543,11 @@ static int msm_vidc_set_clocks(struct msm_vidc_inst *inst)
 	mutex_lock(&core->lock);
 	increment = false;
 	decrement = true;
+	edf = msm_vidc_clock_aggregation == MSM_VIDC_CLOCK_AGGR_EDF;
 	freq = 0;
+	demand = 0;
+	rt_demand = 0;
+	nrt_demand = 0;
 	curr_time_ns = ktime_get_ns();
 	list_for_each_entry(temp, &core->instances, list) {
 		/* skip for session where no input is there to process */
@@ -370,6 +565,7 @@ static int msm_vidc_set_clocks(struct msm_vidc_inst *inst)
 			d_vpr_l("msm_vidc_clock_voting %d\n", msm_vidc_clock_voting);
 			freq = msm_vidc_clock_voting;
 			decrement = false;
+			edf = false;
 			break;
 		}
 		/* increment even if one session requested for it */
@@ -378,6 +574,55 @@ static int msm_vidc_set_clocks(struct msm_vidc_inst *inst)
 		/* decrement only if all sessions requested for it */
 		if (!(temp->power.dcvs_flags & MSM_VIDC_DCVS_DECR))
 			decrement = false;
+
+		if (!temp->power.frame_cycles || !temp->max_rate)
+			edf = false;
+		demand += msm_vidc_edf_demand(temp->power.frame_cycles,
+			temp->max_rate, temp->power.slack_frames,
+			temp->power.cycles_margin);
+
+		/* unthrottled demand, used to decide thermal throttling */
+		req = temp->power.frame_cycles ?
+			temp->power.frame_cycles * temp->power.req_rate :
+			temp->power.min_freq;
+		if (is_realtime_session(temp))
+			rt_demand += req;
+		else
+			nrt_demand += req;
+	}
+
+	max_freq = msm_vidc_thermal_max_freq(core);
+	if (!msm_vidc_clock_voting)
+		msm_vidc_thermal_throttle(core, max_freq, rt_demand, nrt_demand);
+
+	/*
+	 * EDF aggregation: every active session is a periodic task needing
+	 * power.frame_cycles per frame every 1/max_rate seconds, with
+	 * power.slack_frames of its deadlines already met by work done ahead.
+	 * The core runs at the lowest table rate covering the processor
+	 * demand of the next second. Buffer count dcvs may step that up once,
+	 * but never below it: the cushion a decrement reacts to is the slack
+	 * already taken out of the demand. Falls back to the sum policy while
+	 * any active session has no cycle estimate yet.
+	 */
+	if (edf && demand) {
+		rate = msm_vidc_table_rate(core->resource->freq_set.freq_tbl,
+			core->resource->freq_set.count, demand);
+		for (i = 0; i < core->resource->freq_set.count; i++) {
+			if (core->resource->freq_set.freq_tbl[i].freq == rate)
+				break;
+		}
+		/* any step down would fall below the edf rate */
+		if (increment && i > 0 && i < core->resource->freq_set.count)
+			rate = core->resource->freq_set.freq_tbl[i - 1].freq;
+		if (max_freq && rate > max_freq)
+			rate = max_freq;
+		core->power.clk_freq = (u32)rate;
+
+		i_vpr_p(inst, "%s: clock rate %llu edf demand %llu sum %llu increment %d decrement %d\n",
+			__func__, rate, demand, freq, increment, decrement);
+		mutex_unlock(&core->lock);
+		goto scale_clocks;
 	}
 
 	/*
@@ -398,12 +643,15 @@ static int msm_vidc_set_clocks(struct msm_vidc_inst *inst)
 		if (i < (int)(core->platform->data.freq_tbl_size - 1))
 			rate = core->resource->freq_set.freq_tbl[i + 1].freq;
 	}
+	if (max_freq && rate > max_freq && !msm_vidc_clock_voting)
+		rate = max_freq;
 	core->power.clk_freq = (u32)rate;
 
 	i_vpr_p(inst, "%s: clock rate %llu requested %llu increment %d decrement %d\n",
 		__func__, rate, freq, increment, decrement);
 	mutex_unlock(&core->lock);
 
+scale_clocks:
 	rc = venus_hfi_scale_clocks(inst, rate);
 	if (rc)
 		return rc;
@@ -411,17 +659,9 @@ static int msm_vidc_set_clocks(struct msm_vidc_inst *inst)
 	return 0;
 }
 
-static int msm_vidc_apply_dcvs(struct msm_vidc_inst *inst)
+static int msm_vidc_bufs_with_fw(struct msm_vidc_inst *inst)
 {
-	int rc = 0;
-	int bufs_with_fw = 0;
-	struct msm_vidc_power *power;
-
-	/* skip dcvs */
-	if (!inst->power.dcvs_mode)
-		return 0;
-
-	power = &inst->power;
+	int bufs_with_fw;
 
 	if (is_decode_session(inst)) {
 		bufs_with_fw = msm_vidc_num_buffers(inst,
@@ -432,7 +672,19 @@ static int msm_vidc_apply_dcvs(struct msm_vidc_inst *inst)
 	}
 
 	/* +1 as one buffer is going to be queued after the function */
-	bufs_with_fw += 1;
+	return bufs_with_fw + 1;
+}
+
+static int msm_vidc_apply_dcvs(struct msm_vidc_inst *inst, int bufs_with_fw)
+{
+	int rc = 0;
+	struct msm_vidc_power *power;
+
+	/* skip dcvs */
+	if (!inst->power.dcvs_mode)
+		return 0;
+
+	power = &inst->power;
 
 	/*
 	 * DCVS decides clock level based on below algorithm
@@ -483,25 +735,139 @@ exit:
 	return rc;
 }
 
+void msm_vidc_record_frame_submit(struct msm_vidc_inst *inst,
+	struct msm_vidc_buffer *buf, u64 timestamp)
+{
+	struct msm_vidc_power *power = &inst->power;
+	struct msm_vidc_etb_time *slot;
+
+	if (!is_input_buffer(buf->type))
+		return;
+
+	slot = &power->etb_time[power->etb_time_idx++ % MSM_VIDC_ETB_TIME_SLOTS];
+	slot->timestamp = timestamp;
+	slot->submit_ns = buf->submit_time_ns;
+}
+
+static u64 msm_vidc_take_etb_time(struct msm_vidc_inst *inst, u64 timestamp)
+{
+	struct msm_vidc_etb_time *slot;
+	u64 submit_ns;
+	u32 i;
+
+	for (i = 0; i < MSM_VIDC_ETB_TIME_SLOTS; i++) {
+		slot = &inst->power.etb_time[i];
+		if (!slot->submit_ns || slot->timestamp != timestamp)
+			continue;
+
+		submit_ns = slot->submit_ns;
+		slot->submit_ns = 0;
+		return submit_ns;
+	}
+
+	return 0;
+}
+
+/*
+ * Closed loop dcvs: track the cycles firmware spends per frame, measured
+ * on FBD from the latest of the matching ETB, the FTB and the previous
+ * FBD, and scaled by the core clock it was processed at. timestamp is the
+ * one firmware returned, before any ts_reorder rewrite of buf->timestamp.
+ */
+void msm_vidc_update_frame_time(struct msm_vidc_inst *inst,
+	struct msm_vidc_buffer *buf, u64 timestamp)
+{
+	struct msm_vidc_core *core = inst->core;
+	struct msm_vidc_power *power = &inst->power;
+	u64 now, start, etb_ns, ftb_ns, proc_ns, cycles;
+	u32 fps;
+
+	ftb_ns = buf->submit_time_ns;
+	buf->submit_time_ns = 0;
+	etb_ns = msm_vidc_take_etb_time(inst, timestamp);
+	if (!etb_ns || !ftb_ns || !buf->data_size)
+		return;
+
+	now = ktime_get_ns();
+	fps = inst->max_rate;
+	start = max3(etb_ns, ftb_ns, power->last_done_ns);
+	if (fps && now > start && now - start > div_u64(NSEC_PER_SEC, fps))
+		power->deadline_misses++;
+
+	proc_ns = msm_vidc_frame_proc_ns(etb_ns, ftb_ns,
+		power->last_done_ns, now, fps);
+	power->last_done_ns = now;
+	if (!proc_ns || !core->power.clk_freq)
+		return;
+
+	cycles = div_u64(proc_ns * core->power.clk_freq, NSEC_PER_SEC);
+	power->avg_frame_cycles = msm_vidc_frame_cycles_avg(
+		power->avg_frame_cycles, power->frame_samples, cycles);
+	power->frame_samples++;
+}
+
+static u64 msm_vidc_closed_loop_freq(struct msm_vidc_inst *inst)
+{
+	struct msm_vidc_core *core = inst->core;
+	struct msm_vidc_power *power = &inst->power;
+	u64 rate;
+
+	rate = msm_vidc_closed_loop_rate(core->resource->freq_set.freq_tbl,
+		core->resource->freq_set.count, power->avg_frame_cycles,
+		inst->max_rate, power->closed_loop_freq,
+		msm_vidc_dcvs_headroom, msm_vidc_dcvs_hysteresis);
+
+	i_vpr_p(inst,
+		"dcvs: cycles/frame %llu fps %u rate %llu misses %u\n",
+		power->avg_frame_cycles, inst->max_rate, rate,
+		power->deadline_misses);
+
+	power->closed_loop_freq = rate;
+	return rate;
+}
+
 static int msm_vidc_scale_clocks(struct msm_vidc_inst *inst)
 {
 	struct msm_vidc_core *core;
+	int bufs_with_fw = 0;
 
 	core = inst->core;
 
+	/* frames of cushion below the nominal dcvs threshold are edf slack */
+	inst->power.slack_frames = 0;
+	inst->power.cycles_margin = 0;
+	if (inst->power.dcvs_mode) {
+		bufs_with_fw = msm_vidc_bufs_with_fw(inst);
+		if (bufs_with_fw < (int)inst->power.nom_threshold)
+			inst->power.slack_frames =
+				inst->power.nom_threshold - bufs_with_fw;
+	}
+
 	if (inst->power.buffer_counter < DCVS_WINDOW ||
 	    is_image_session(inst) ||
+	    is_thumbnail_session(inst) ||
 	    is_sub_state(inst, MSM_VIDC_DRC) ||
 	    is_sub_state(inst, MSM_VIDC_DRAIN)) {
 		inst->power.min_freq = msm_vidc_max_freq(inst);
+		inst->power.frame_cycles = 0;
 		inst->power.dcvs_flags = 0;
 	} else if (msm_vidc_clock_voting) {
 		inst->power.min_freq = msm_vidc_clock_voting;
+		inst->power.frame_cycles = 0;
+		inst->power.dcvs_flags = 0;
+	} else if (msm_vidc_dcvs_policy == MSM_VIDC_DCVS_POLICY_CLOSED_LOOP &&
+		   inst->power.dcvs_mode && inst->max_rate &&
+		   inst->power.frame_samples >= DCVS_WINDOW) {
+		inst->power.min_freq = msm_vidc_closed_loop_freq(inst);
+		inst->power.frame_cycles = inst->power.avg_frame_cycles;
+		inst->power.cycles_margin = msm_vidc_edf_margin;
 		inst->power.dcvs_flags = 0;
 	} else {
 		inst->power.min_freq =
 			call_session_op(core, calc_freq, inst, inst->max_input_data_size);
-		msm_vidc_apply_dcvs(inst);
+		inst->power.frame_cycles = inst->max_rate ?
+			div_u64(inst->power.min_freq, inst->max_rate) : 0;
+		msm_vidc_apply_dcvs(inst, bufs_with_fw);
 	}
 	inst->power.curr_freq = inst->power.min_freq;
 	msm_vidc_set_clocks(inst);
@@ -515,7 +881,7 @@ int msm_vidc_scale_power(struct msm_vidc_inst *inst, bool scale_buses)
 	struct msm_vidc_buffer *vbuf;
 	u32 data_size = 0;
 	u32 cnt = 0;
-	u32 fps;
+	u32 fps, thermal_pct;
 	u32 frame_rate, operating_rate;
 	u32 timestamp_rate = 0, input_rate = 0;
 
@@ -543,8 +909,7 @@ int msm_vidc_scale_power(struct msm_vidc_inst *inst, bool scale_buses)
 		if (cnt)
 			data_size /= cnt;
 	} else {
-		list_for_each_entry(vbuf, &inst->buffers.input.list, list)
-			data_size = max(data_size, vbuf->data_size);
+		data_size = msm_vidc_input_size(inst);
 	}
 	inst->max_input_data_size = data_size;
 
@@ -580,6 +945,12 @@ int msm_vidc_scale_power(struct msm_vidc_inst *inst, bool scale_buses)
 				fps = fps + fps / 16;
 		}
 	}
+	inst->power.req_rate = fps;
+
+	/* thermal cap below demand slows non-realtime sessions down first */
+	thermal_pct = READ_ONCE(inst->power.thermal_pct);
+	if (thermal_pct && !is_realtime_session(inst))
+		fps = max_t(u32, 1, div_u64((u64)fps * thermal_pct, 100));
 	inst->max_rate = fps;
 
 	/* no pending inputs - skip scale power */
@@ -633,6 +1004,14 @@ static void msm_vidc_dcvs_data_reset(struct msm_vidc_inst *inst)
 	dcvs->dcvs_window = min_count < max_count ? max_count - min_count : 0;
 	dcvs->nom_threshold = dcvs->min_threshold + (dcvs->dcvs_window / 2);
 	dcvs->dcvs_flags = 0;
+	dcvs->last_done_ns = 0;
+	dcvs->avg_frame_cycles = 0;
+	dcvs->frame_cycles = 0;
+	dcvs->frame_samples = 0;
+	dcvs->closed_loop_freq = 0;
+	dcvs->deadline_misses = 0;
+	memset(dcvs->etb_time, 0, sizeof(dcvs->etb_time));
+	dcvs->etb_time_idx = 0;
 
 	i_vpr_p(inst, "%s: dcvs: thresholds [%d %d %d] flags %#x\n",
 		__func__, dcvs->min_threshold,
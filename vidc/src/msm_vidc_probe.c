@@ -14,6 +14,7 @@
 #include <linux/iommu.h>
 #include <linux/version.h>
 #include <linux/stringify.h>
+#include <linux/thermal.h>
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 16, 0))
 #include <linux/dma-iommu.h>
 #endif
@@ -30,6 +31,7 @@
 #include "msm_vidc_core.h"
 #include "msm_vidc_memory.h"
 #include "venus_hfi.h"
+#include "firmware.h"
 
 #define BASE_DEVICE_NUMBER 32
 
@@ -331,8 +333,16 @@ static int msm_vidc_deinitialize_core(struct msm_vidc_core *core)
 	}
 	d_vpr_h("%s()\n", __func__);
 
+	/* clk_work takes core->lock */
+	cancel_work_sync(&core->clk_work);
 	mutex_destroy(&core->lock);
 	msm_vidc_update_core_state(core, MSM_VIDC_CORE_DEINIT, __func__);
+	fw_release(core);
+
+	if (core->inst_workq) {
+		msm_vidc_inst_cache_deinit(core);
+		destroy_workqueue(core->inst_workq);
+	}
 
 	if (core->batch_workq)
 		destroy_workqueue(core->batch_workq);
@@ -340,6 +350,7 @@ static int msm_vidc_deinitialize_core(struct msm_vidc_core *core)
 	if (core->pm_workq)
 		destroy_workqueue(core->pm_workq);
 
+	core->inst_workq = NULL;
 	core->batch_workq = NULL;
 	core->pm_workq = NULL;
 
@@ -352,6 +363,7 @@ static int msm_vidc_initialize_core(struct msm_vidc_core *core)
 
 	d_vpr_h("%s()\n", __func__);
 
+	init_completion(&core->init_done);
 	msm_vidc_update_core_state(core, MSM_VIDC_CORE_DEINIT, __func__);
 
 	core->pm_workq = create_singlethread_workqueue("pm_workq");
@@ -368,6 +380,15 @@ static int msm_vidc_initialize_core(struct msm_vidc_core *core)
 		goto exit;
 	}
 
+	/* session work of all instances, shell cache refill and deferred core init */
+	core->inst_workq = alloc_workqueue("vidc_inst_workq",
+		WQ_UNBOUND | WQ_HIGHPRI, 0);
+	if (!core->inst_workq) {
+		d_vpr_e("%s: create inst workq failed\n", __func__);
+		rc = -EINVAL;
+		goto exit;
+	}
+
 	core->packet_size = VIDC_IFACEQ_VAR_HUGE_PKT_SIZE;
 	core->packet = devm_kzalloc(&core->pdev->dev, core->packet_size, GFP_KERNEL);
 	if (!core->packet) {
@@ -386,17 +407,26 @@ static int msm_vidc_initialize_core(struct msm_vidc_core *core)
 	mutex_init(&core->lock);
 	INIT_LIST_HEAD(&core->instances);
 	INIT_LIST_HEAD(&core->dangling_instances);
+	INIT_LIST_HEAD(&core->inst_cache);
+	spin_lock_init(&core->inst_cache_lock);
+	INIT_WORK(&core->inst_cache_work, msm_vidc_inst_cache_handler);
 
 	INIT_DELAYED_WORK(&core->pm_work, venus_hfi_pm_work_handler);
+	INIT_WORK(&core->clk_work, venus_hfi_clk_work_handler);
+	spin_lock_init(&core->clk_req_lock);
 	INIT_DELAYED_WORK(&core->fw_unload_work, msm_vidc_fw_unload_handler);
+	INIT_WORK(&core->init_work, msm_vidc_core_init_handler);
 	INIT_WORK(&core->ssr_work, msm_vidc_ssr_handler);
 
 	return 0;
 exit:
+	if (core->inst_workq)
+		destroy_workqueue(core->inst_workq);
 	if (core->batch_workq)
 		destroy_workqueue(core->batch_workq);
 	if (core->pm_workq)
 		destroy_workqueue(core->pm_workq);
+	core->inst_workq = NULL;
 	core->batch_workq = NULL;
 	core->pm_workq = NULL;
 
@@ -573,6 +603,76 @@ static void msm_vidc_component_unbind(struct device *dev,
 	d_vpr_h("%s(): %s\n", __func__, dev_name(dev));
 }
 
+static int msm_vidc_cdev_get_max_state(struct thermal_cooling_device *cdev,
+	unsigned long *state)
+{
+	struct msm_vidc_core *core = cdev->devdata;
+
+	/* one state per freq_tbl corner below the highest */
+	*state = core->resource->freq_set.count ?
+		core->resource->freq_set.count - 1 : 0;
+
+	return 0;
+}
+
+static int msm_vidc_cdev_get_cur_state(struct thermal_cooling_device *cdev,
+	unsigned long *state)
+{
+	struct msm_vidc_core *core = cdev->devdata;
+
+	*state = core->thermal_state;
+
+	return 0;
+}
+
+static int msm_vidc_cdev_set_cur_state(struct thermal_cooling_device *cdev,
+	unsigned long state)
+{
+	struct msm_vidc_core *core = cdev->devdata;
+
+	if (state >= core->resource->freq_set.count)
+		return -EINVAL;
+
+	core_lock(core, __func__);
+	if (core->thermal_state != state) {
+		d_vpr_h("%s: thermal state %lu -> %lu, max freq %llu\n",
+			__func__, core->thermal_state, state,
+			core->resource->freq_set.freq_tbl[state].freq);
+		core->thermal_state = state;
+		venus_hfi_reapply_clocks(core);
+	}
+	core_unlock(core, __func__);
+
+	return 0;
+}
+
+static const struct thermal_cooling_device_ops msm_vidc_cdev_ops = {
+	.get_max_state = msm_vidc_cdev_get_max_state,
+	.get_cur_state = msm_vidc_cdev_get_cur_state,
+	.set_cur_state = msm_vidc_cdev_set_cur_state,
+};
+
+static int msm_vidc_register_cooling_device(struct msm_vidc_core *core)
+{
+	struct device *dev = &core->pdev->dev;
+
+	if (!core->resource->freq_set.count)
+		return 0;
+
+	core->cdev = devm_thermal_of_cooling_device_register(dev, dev->of_node,
+		"msm_vidc", core, &msm_vidc_cdev_ops);
+	if (IS_ERR(core->cdev)) {
+		d_vpr_e("%s: failed to register cooling device %ld\n",
+			__func__, PTR_ERR(core->cdev));
+		core->cdev = NULL;
+		return -EINVAL;
+	}
+	d_vpr_h("%s: registered cooling device, max state %u\n",
+		__func__, core->resource->freq_set.count - 1);
+
+	return 0;
+}
+
 static int msm_vidc_component_master_bind(struct device *dev)
 {
 	struct msm_vidc_core *core = dev_get_drvdata(dev);
@@ -619,11 +719,12 @@ static int msm_vidc_component_master_bind(struct device *dev)
 		goto queues_deinit;
 	}
 
-	rc = msm_vidc_core_init(core);
-	if (rc) {
-		d_vpr_e("%s: sys init failed\n", __func__);
-		goto queues_deinit;
-	}
+	/*
+	 * Firmware load and sys init take hundreds of ms, run them off the
+	 * probe path. Openers arriving earlier wait on core->init_done, a
+	 * failure here is retried by the first open.
+	 */
+	queue_work(core->inst_workq, &core->init_work);
 
 	d_vpr_h("%s(): succssful\n", __func__);
 
@@ -644,6 +745,7 @@ static void msm_vidc_component_master_unbind(struct device *dev)
 
 	d_vpr_h("%s(): %s\n", __func__, dev_name(dev));
 
+	cancel_work_sync(&core->init_work);
 	msm_vidc_core_deinit(core, true);
 	venus_hfi_queue_deinit(core);
 	msm_vidc_deinitialize_media(core);
@@ -793,6 +895,12 @@ static int msm_vidc_probe_video_device(struct platform_device *pdev)
 		rc = 0; /* Ignore error */
 	}
 
+	rc = msm_vidc_register_cooling_device(core);
+	if (rc) {
+		d_vpr_e("Failed to register thermal cooling device\n");
+		rc = 0; /* Ignore error */
+	}
+
 	core->debugfs_root = msm_vidc_debugfs_init_core(core);
 	if (!core->debugfs_root)
 		d_vpr_h("Failed to init debugfs core\n");
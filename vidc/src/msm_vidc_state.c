@@ -258,6 +258,7 @@ int msm_vidc_update_core_state(struct msm_vidc_core *core,
 	enum msm_vidc_core_state request_state, const char *func)
 {
 	struct msm_vidc_core_state_handle *state_handle = NULL;
+	enum msm_vidc_core_state prev_state;
 	int rc = 0;
 
 	/* get core state handler for requested state */
@@ -268,10 +269,20 @@ int msm_vidc_update_core_state(struct msm_vidc_core *core,
 	d_vpr_h("%s: core state changed to %s from %s\n", func,
 		core_state_name(state_handle->state), core_state_name(core->state));
 
+	/* openers wait for the core to leave INIT_WAIT */
+	if (state_handle->state == MSM_VIDC_CORE_INIT_WAIT &&
+	    core->state != MSM_VIDC_CORE_INIT_WAIT)
+		reinit_completion(&core->init_done);
+
 	/* finally update core state and handler */
+	prev_state = core->state;
 	core->state = state_handle->state;
 	core->state_handle = state_handle->handle;
 
+	if (prev_state == MSM_VIDC_CORE_INIT_WAIT &&
+	    core->state != MSM_VIDC_CORE_INIT_WAIT)
+		complete_all(&core->init_done);
+
 	return rc;
 }
 
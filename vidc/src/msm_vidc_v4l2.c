@@ -12,6 +12,7 @@
 #include "msm_vidc_debug.h"
 #include "msm_vidc.h"
 #include "msm_vidc_events.h"
+#include "msm_vidc_vb2.h"
 
 extern struct msm_vidc_core *g_core;
 
@@ -78,6 +79,7 @@ int msm_v4l2_open(struct file *filp)
 		container_of(vdev, struct msm_video_device, vdev);
 	struct msm_vidc_core *core = video_drvdata(filp);
 	struct msm_vidc_inst *inst;
+	u64 start_ns = ktime_get_ns();
 
 	trace_msm_v4l2_vidc_open("START", NULL);
 	inst = msm_vidc_open(core, vid_dev->type);
@@ -89,6 +91,8 @@ int msm_v4l2_open(struct file *filp)
 	}
 	filp->private_data = &(inst->fh);
 	trace_msm_v4l2_vidc_open("END", inst);
+	trace_msm_v4l2_vidc_open_latency(inst->session_id,
+		(ktime_get_ns() - start_ns) / NSEC_PER_USEC);
 	return 0;
 }
 
@@ -96,6 +100,8 @@ int msm_v4l2_close(struct file *filp)
 {
 	int rc = 0;
 	struct msm_vidc_inst *inst;
+	u64 start_ns = ktime_get_ns();
+	u32 session_id;
 
 	inst = get_vidc_inst(filp, NULL);
 	if (!inst) {
@@ -104,10 +110,13 @@ int msm_v4l2_close(struct file *filp)
 	}
 
 	trace_msm_v4l2_vidc_close("START", inst);
+	session_id = inst->session_id;
 
 	rc = msm_vidc_close(inst);
 	filp->private_data = NULL;
 	trace_msm_v4l2_vidc_close("END", NULL);
+	trace_msm_v4l2_vidc_close_latency(session_id,
+		(ktime_get_ns() - start_ns) / NSEC_PER_USEC);
 	return rc;
 }
 
@@ -247,7 +256,7 @@ int msm_v4l2_g_fmt(struct file *filp, void *fh,
 	}
 
 	client_lock(inst, __func__);
-	inst_lock(inst, __func__);
+	ctrl_lock(inst, __func__);
 	if (is_session_error(inst)) {
 		i_vpr_e(inst, "%s: inst in error state\n", __func__);
 		rc = -EBUSY;
@@ -258,7 +267,7 @@ int msm_v4l2_g_fmt(struct file *filp, void *fh,
 		goto unlock;
 
 unlock:
-	inst_unlock(inst, __func__);
+	ctrl_unlock(inst, __func__);
 	client_unlock(inst, __func__);
 	put_inst(inst);
 
@@ -571,6 +580,9 @@ int msm_v4l2_qbuf(struct file *filp, void *fh,
 	 * Currently, request_fd is disabled. Therefore, acquire inst_lock
 	 * from this function to ensure RO list insertion/updation is under
 	 * lock to avoid stability usecase.
+	 * Unlike dqbuf, buffer_lock alone is not enough here: the queue path
+	 * applies request controls, updates frame rate and power and may move
+	 * the session to error state, all of which belong to inst->lock.
 	 */
 	client_lock(inst, __func__);
 	inst_lock(inst, __func__);
@@ -604,6 +616,21 @@ int msm_v4l2_dqbuf(struct file *filp, void *fh,
 		return -EINVAL;
 	}
 
+	/*
+	 * Once the queue is streaming, dqbuf only touches the vb2 queue and
+	 * the buffer lists, so it does not need to wait for a control or
+	 * format call holding the instance lock. streamon/streamoff update
+	 * the streaming state with buffer_lock held, hence the check below
+	 * is stable until buffer_unlock().
+	 */
+	buffer_lock(inst, __func__);
+	if (msm_vidc_is_queue_streaming(inst, b->type)) {
+		rc = msm_vidc_dqbuf(inst, b);
+		buffer_unlock(inst, __func__);
+		goto exit;
+	}
+	buffer_unlock(inst, __func__);
+
 	client_lock(inst, __func__);
 	inst_lock(inst, __func__);
 	rc = msm_vidc_dqbuf(inst, b);
@@ -613,6 +640,7 @@ int msm_v4l2_dqbuf(struct file *filp, void *fh,
 unlock:
 	inst_unlock(inst, __func__);
 	client_unlock(inst, __func__);
+exit:
 	put_inst(inst);
 
 	return rc;
@@ -15,6 +15,7 @@
 #include "msm_venc.h"
 #include "msm_vidc_control.h"
 #include "msm_vidc_platform.h"
+#include "msm_vidc_events.h"
 
 extern struct msm_vidc_core *g_core;
 
@@ -38,6 +39,22 @@ struct vb2_queue *msm_vidc_get_vb2q(struct msm_vidc_inst *inst,
 	return q;
 }
 
+bool msm_vidc_is_queue_streaming(struct msm_vidc_inst *inst, u32 type)
+{
+	struct vb2_queue *q = NULL;
+
+	if (type == INPUT_MPLANE)
+		q = inst->bufq[INPUT_PORT].vb2q;
+	else if (type == OUTPUT_MPLANE)
+		q = inst->bufq[OUTPUT_PORT].vb2q;
+	else if (type == INPUT_META_PLANE)
+		q = inst->bufq[INPUT_META_PORT].vb2q;
+	else if (type == OUTPUT_META_PLANE)
+		q = inst->bufq[OUTPUT_META_PORT].vb2q;
+
+	return q && q->streaming;
+}
+
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(5, 15, 0))
 void *msm_vb2_alloc(struct device *dev, unsigned long attrs,
 	unsigned long size, enum dma_data_direction dma_dir,
@@ -991,6 +1008,10 @@ void msm_vb2_buf_queue(struct vb2_buffer *vb2)
 			goto exit;
 	}
 
+	trace_msm_vidc_buffer_stage(inst, MSM_VIDC_BUF_STAGE_QBUF,
+		v4l2_type_to_driver(vb2->type, __func__), vb2->index, 0,
+		vb2->timestamp, 0);
+
 	if (is_decode_session(inst))
 		rc = msm_vdec_qbuf(inst, vb2);
 	else if (is_encode_session(inst))
@@ -29,7 +29,6 @@
 	((a) > (b) ? (a) - (b) < TRIVIAL_BW_THRESHOLD : \
 		(b) - (a) < TRIVIAL_BW_THRESHOLD)
 
-static struct clock_residency *get_residency_stats(struct clock_info *cl, u64 rate);
 static int __update_residency_stats(struct msm_vidc_core *core,
 		struct clock_info *cl, u64 rate);
 enum reset_state {
@@ -164,10 +163,13 @@ static int devm_pm_runtime_get_sync(struct device *dev)
 
 static int __opp_set_rate(struct msm_vidc_core *core, u64 freq)
 {
+	struct clock_scaling_stats *stats = &core->resource->scaling_stats;
 	unsigned long opp_freq = 0;
 	struct dev_pm_opp *opp;
+	u64 start_ns;
 	int rc = 0;
 
+	start_ns = ktime_get_ns();
 	opp_freq = freq;
 
 	/* find max(ceil) freq from opp table */
@@ -181,6 +183,12 @@ static int __opp_set_rate(struct msm_vidc_core *core, u64 freq)
 	}
 	dev_pm_opp_put(opp);
 
+	/* bail early if rails are already voted for this opp */
+	if (opp_freq == core->resource->opp_rate) {
+		stats->opp_skipped++;
+		goto exit;
+	}
+
 	/* print freq value */
 	d_vpr_h("%s: set rate %lu (requested %llu)\n",
 		__func__, opp_freq, freq);
@@ -189,9 +197,14 @@ static int __opp_set_rate(struct msm_vidc_core *core, u64 freq)
 	rc = dev_pm_opp_set_rate(&core->pdev->dev, opp_freq);
 	if (rc) {
 		d_vpr_e("%s: failed to set rate\n", __func__);
-		return rc;
+		core->resource->opp_rate = 0;
+		goto exit;
 	}
+	core->resource->opp_rate = opp_freq;
+	stats->opp_applied++;
 
+exit:
+	stats->opp_time_ns += ktime_get_ns() - start_ns;
 	return rc;
 }
 
@@ -277,6 +290,7 @@ static int __init_bus(struct msm_vidc_core *core)
 		interconnects->bus_tbl[cnt].name = bus_tbl[cnt].name;
 		interconnects->bus_tbl[cnt].min_kbps = bus_tbl[cnt].min_kbps;
 		interconnects->bus_tbl[cnt].max_kbps = bus_tbl[cnt].max_kbps;
+		interconnects->bus_tbl[cnt].residency.start_time_ns = ktime_get_ns();
 	}
 
 	/* print bus fields */
@@ -431,7 +445,6 @@ enable_runtime_pm:
 
 static int __init_clocks(struct msm_vidc_core *core)
 {
-	struct clock_residency *residency = NULL;
 	const struct clk_table *clk_tbl;
 	struct freq_table *freq_tbl;
 	struct clock_set *clocks;
@@ -471,35 +484,29 @@ static int __init_clocks(struct msm_vidc_core *core)
 
 	/* populate clk residency stats table */
 	for (cnt = 0; cnt < clocks->count; cnt++) {
-		/* initialize residency_list */
-		INIT_LIST_HEAD(&clocks->clock_tbl[cnt].residency_list);
+		cinfo = &clocks->clock_tbl[cnt];
+		cinfo->residency_idx = -1;
 
 		/* skip if scaling not supported */
-		if (!clocks->clock_tbl[cnt].has_scaling)
+		if (!cinfo->has_scaling)
 			continue;
 
-		for (fcnt = 0; fcnt < freq_count; fcnt++) {
-			residency = devm_kzalloc(&core->pdev->dev,
-				sizeof(struct clock_residency), GFP_KERNEL);
-			if (!residency) {
-				d_vpr_e("%s: failed to alloc clk residency stat node\n", __func__);
-				return -ENOMEM;
-			}
-
-			if (!freq_tbl) {
-				d_vpr_e("%s: invalid freq tbl 0x%p\n", __func__, freq_tbl);
-				return -EINVAL;
-			}
-
-			/* update residency node */
-			residency->rate = freq_tbl[fcnt].freq;
-			residency->start_time_us = 0;
-			residency->total_time_us = 0;
-			INIT_LIST_HEAD(&residency->list);
+		if (!freq_tbl) {
+			d_vpr_e("%s: invalid freq tbl 0x%p\n", __func__, freq_tbl);
+			return -EINVAL;
+		}
 
-			/* add entry into residency_list */
-			list_add_tail(&residency->list, &clocks->clock_tbl[cnt].residency_list);
+		/* one entry per freq_tbl rate plus one for off-table rates */
+		cinfo->residency = devm_kcalloc(&core->pdev->dev, freq_count + 1,
+			sizeof(*cinfo->residency), GFP_KERNEL);
+		if (!cinfo->residency) {
+			d_vpr_e("%s: failed to alloc clk residency stats\n", __func__);
+			return -ENOMEM;
 		}
+		cinfo->residency_count = freq_count + 1;
+
+		for (fcnt = 0; fcnt < freq_count; fcnt++)
+			cinfo->residency[fcnt].rate = freq_tbl[fcnt].freq;
 	}
 
 	/* print clock fields */
@@ -1048,6 +1055,8 @@ static int __vote_bandwidth(struct bus_info *bus, unsigned long bw_kbps)
 	if (rc)
 		d_vpr_e("Failed voting bus %s to ab %lu, rc=%d\n",
 			bus->name, bw_kbps, rc);
+	else
+		__update_bus_residency_stats(bus, bw_kbps);
 
 	return rc;
 }
@@ -1130,25 +1139,34 @@ static int set_bw(struct msm_vidc_core *core, unsigned long bw_ddr,
 static int print_residency_stats(struct msm_vidc_core *core, struct clock_info *cl)
 {
 	struct clock_residency *residency = NULL;
-	u64 total_time_us = 0;
-	int rc = 0;
+	u64 total_time_ns = 0, time_ns, cur_time_ns;
+	int i, rc = 0;
 
 	/* skip if scaling not supported */
-	if (!cl->has_scaling)
+	if (!cl->has_scaling || !cl->residency)
 		return 0;
 
+	cur_time_ns = ktime_get_ns();
+
 	/* grand total residency time */
-	list_for_each_entry(residency, &cl->residency_list, list)
-		total_time_us += residency->total_time_us;
+	for (i = 0; i < cl->residency_count; i++) {
+		total_time_ns += cl->residency[i].total_time_ns;
+		if (i == cl->residency_idx)
+			total_time_ns += cur_time_ns - cl->residency_start_ns;
+	}
 
 	/* sanity check to avoid divide by 0 */
-	total_time_us = (total_time_us > 0) ? total_time_us : 1;
+	total_time_ns = (total_time_ns > 0) ? total_time_ns : 1;
 
 	/* print residency percent for each clock */
-	list_for_each_entry(residency, &cl->residency_list, list) {
+	for (i = 0; i < cl->residency_count; i++) {
+		residency = &cl->residency[i];
+		time_ns = residency->total_time_ns;
+		if (i == cl->residency_idx)
+			time_ns += cur_time_ns - cl->residency_start_ns;
 		d_vpr_hs("%s: %s clock rate [%llu] total %llu us residency %llu%%\n",
-			__func__, cl->name, residency->rate, residency->total_time_us,
-			(residency->total_time_us * 100 + total_time_us / 2) / total_time_us);
+			__func__, cl->name, residency->rate, div_u64(time_ns, NSEC_PER_USEC),
+			div64_u64(time_ns * 100 + total_time_ns / 2, total_time_ns));
 	}
 
 	return rc;
@@ -1156,109 +1174,98 @@ static int print_residency_stats(struct msm_vidc_core *core, struct clock_info *
 
 static int reset_residency_stats(struct msm_vidc_core *core, struct clock_info *cl)
 {
-	struct clock_residency *residency = NULL;
-	int rc = 0;
+	int i, rc = 0;
 
 	/* skip if scaling not supported */
-	if (!cl->has_scaling)
+	if (!cl->has_scaling || !cl->residency)
 		return 0;
 
 	d_vpr_h("%s: reset %s residency stats\n", __func__, cl->name);
 
-	/* reset clock residency stats */
-	list_for_each_entry(residency, &cl->residency_list, list) {
-		residency->start_time_us = 0;
-		residency->total_time_us = 0;
-	}
-	/*
-	 * During the reset make sure to update start time of the clk prev freq,
-	 * because the prev clk freq might not be 0 so when the next seesion start
-	 * voting from that freq, then those resideny print will not come in stats
-	 */
-	residency = get_residency_stats(cl, cl->prev);
-	if (residency)
-		residency->start_time_us = ktime_get_ns() / 1000;
+	/* reset clock residency stats, current rate keeps accruing from now */
+	for (i = 0; i < cl->residency_count; i++)
+		cl->residency[i].total_time_ns = 0;
+	cl->residency_start_ns = ktime_get_ns();
+
 	return rc;
 }
 
-static struct clock_residency *get_residency_stats(struct clock_info *cl, u64 rate)
+static int get_residency_index(struct clock_info *cl, u64 rate)
 {
-	struct clock_residency *residency = NULL;
-	bool found = false;
-
-	if (!cl) {
-		d_vpr_e("%s: invalid params\n", __func__);
-		return NULL;
-	}
+	int i;
 
-	list_for_each_entry(residency, &cl->residency_list, list) {
-		if (residency->rate == rate) {
-			found = true;
+	/* entries hold the freq_tbl rates, last one collects the rest */
+	for (i = 0; i < cl->residency_count - 1; i++) {
+		if (cl->residency[i].rate == rate)
 			break;
-		}
 	}
 
-	return found ? residency : NULL;
+	return i;
 }
 
 static int __update_residency_stats(struct msm_vidc_core *core,
 		struct clock_info *cl, u64 rate)
 {
-	struct clock_residency *cur_residency = NULL, *prev_residency = NULL;
-	u64 cur_time_us = 0;
-	int rc = 0;
-
-	/* skip update if high or stats logs not enabled */
-	if (!(msm_vidc_debug & (VIDC_HIGH | VIDC_STAT)))
-		return 0;
+	u64 cur_time_ns;
+	int idx;
 
 	/* skip update if scaling not supported */
-	if (!cl->has_scaling)
+	if (!cl->has_scaling || !cl->residency)
 		return 0;
 
-	/* skip update if rate not changed */
-	if (rate == cl->prev)
+	/* clk disable case - no entry accrues time */
+	idx = rate ? get_residency_index(cl, rate) : -1;
+	if (idx == cl->residency_idx)
 		return 0;
 
-	/* get current time in ns */
-	cur_time_us = ktime_get_ns() / 1000;
+	cur_time_ns = ktime_get_ns();
 
-	/* update previous rate residency end or total time */
-	prev_residency = get_residency_stats(cl, cl->prev);
-	if (prev_residency) {
-		if (prev_residency->start_time_us)
-			prev_residency->total_time_us += cur_time_us -
-			    prev_residency->start_time_us;
+	/* close previous rate residency */
+	if (cl->residency_idx >= 0)
+		cl->residency[cl->residency_idx].total_time_ns +=
+			cur_time_ns - cl->residency_start_ns;
 
-		/* reset start time us */
-		prev_residency->start_time_us = 0;
-	}
+	cl->residency_idx = idx;
+	cl->residency_start_ns = cur_time_ns;
 
-	/* clk disable case - no need to update new entry */
-	if (rate == 0)
-		return 0;
+	return 0;
+}
 
-	/* check if rate entry is present */
-	cur_residency = get_residency_stats(cl, rate);
-	if (!cur_residency) {
-		d_vpr_e("%s: entry not found. rate %llu\n", __func__, rate);
-		return -EINVAL;
-	}
+static u32 get_bus_residency_bucket(struct bus_info *bus, unsigned long bw_kbps)
+{
+	if (!bw_kbps || !bus->max_kbps)
+		return 0;
 
-	/* update residency start time for current rate/freq */
-	cur_residency->start_time_us = cur_time_us;
+	return 1 + min_t(u64, BW_RESIDENCY_BUCKETS - 2,
+		div_u64((u64)(bw_kbps - 1) * (BW_RESIDENCY_BUCKETS - 1),
+			bus->max_kbps));
+}
 
-	return rc;
+static void __update_bus_residency_stats(struct bus_info *bus,
+		unsigned long bw_kbps)
+{
+	struct bus_residency *residency = &bus->residency;
+	u64 cur_time_ns;
+	u32 bucket;
+
+	bucket = get_bus_residency_bucket(bus, bw_kbps);
+	if (bucket == residency->bucket)
+		return;
+
+	cur_time_ns = ktime_get_ns();
+	residency->total_time_ns[residency->bucket] +=
+		cur_time_ns - residency->start_time_ns;
+	residency->bucket = bucket;
+	residency->start_time_ns = cur_time_ns;
 }
 
 static int __set_clk_rate(struct msm_vidc_core *core, struct clock_info *cl,
 			  u64 rate)
 {
+	struct clock_scaling_stats *stats = &core->resource->scaling_stats;
+	u64 start_ns;
 	int rc = 0;
 
-	/* update clock residency stats */
-	__update_residency_stats(core, cl, rate);
-
 	/* bail early if requested clk rate is not changed */
 	if (rate == cl->prev)
 		return 0;
@@ -1266,14 +1273,26 @@ static int __set_clk_rate(struct msm_vidc_core *core, struct clock_info *cl,
 	d_vpr_p("Scaling clock %s to %llu, prev %llu\n",
 		cl->name, rate, cl->prev);
 
+	start_ns = ktime_get_ns();
 	rc = clk_set_rate(cl->clk, rate);
+	stats->clk_time_ns += ktime_get_ns() - start_ns;
 	if (rc) {
 		d_vpr_e("%s: Failed to set clock rate %llu %s: %d\n",
 			__func__, rate, cl->name, rc);
+		/*
+		 * rate 0 follows clk_disable_unprepare(): the clock stopped
+		 * anyway, so close the interval on the current rate
+		 */
+		if (!rate)
+			__update_residency_stats(core, cl, 0);
 		return rc;
 	}
 
 	cl->prev = rate;
+	stats->clk_applied++;
+
+	/* update clock residency stats */
+	__update_residency_stats(core, cl, rate);
 
 	return rc;
 }
@@ -1683,12 +1702,6 @@ static int __print_clock_residency_stats(struct msm_vidc_core *core)
 		if (!cl->has_scaling)
 			continue;
 
-		/*
-		 * residency for the last clk corner entry will be updated in stats
-		 * only if we call update residency with rate 0
-		 */
-		__update_residency_stats(core, cl, 0);
-
 		/* print clock residency stats */
 		print_residency_stats(core, cl);
 	}
@@ -1699,6 +1712,7 @@ static int __print_clock_residency_stats(struct msm_vidc_core *core)
 static int __reset_clock_residency_stats(struct msm_vidc_core *core)
 {
 	struct clock_info *cl;
+	struct bus_info *bus;
 	int rc = 0;
 
 	venus_hfi_for_each_clock(core, cl) {
@@ -1710,6 +1724,13 @@ static int __reset_clock_residency_stats(struct msm_vidc_core *core)
 		reset_residency_stats(core, cl);
 	}
 
+	/* reset bandwidth bucket residency stats */
+	venus_hfi_for_each_bus(core, bus) {
+		memset(bus->residency.total_time_ns, 0,
+			sizeof(bus->residency.total_time_ns));
+		bus->residency.start_time_ns = ktime_get_ns();
+	}
+
 	return rc;
 }
 
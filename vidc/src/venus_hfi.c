@@ -82,19 +82,91 @@ static bool __valdiate_session(struct msm_vidc_core *core,
 	return valid;
 }
 
+/*
+ * Power collapse only pays off when the idle period following it is long
+ * enough to amortize the next resume. Break even time is modelled as a
+ * multiple of the measured resume latency.
+ */
+static u64 __pc_break_even_ns(struct msm_vidc_pc_stats *pc)
+{
+	u64 resume_ns = pc->resume_cost_ns;
+
+	if (!resume_ns)
+		resume_ns = (u64)VIDC_PC_DEFAULT_RESUME_COST_MS * NSEC_PER_MSEC;
+
+	return resume_ns * VIDC_PC_BREAK_EVEN_FACTOR;
+}
+
+static u32 __pc_min_delay_ms(struct msm_vidc_core *core)
+{
+	return core->capabilities[SW_PC_DELAY].value / VIDC_PC_MIN_DELAY_DIV;
+}
+
+static u32 __pc_get_delay_ms(struct msm_vidc_core *core)
+{
+	struct msm_vidc_pc_stats *pc = &core->pc_stats;
+	u32 sw_pc_delay = core->capabilities[SW_PC_DELAY].value;
+	u32 min_delay_ms = __pc_min_delay_ms(core);
+
+	if (!msm_vidc_adaptive_pc || !pc->idle_samples)
+		pc->delay_ms = sw_pc_delay;
+	else if (pc->predicted_idle_ns >
+		 (u64)min_delay_ms * NSEC_PER_MSEC + __pc_break_even_ns(pc))
+		/* long idle expected: collapse early */
+		pc->delay_ms = min_delay_ms;
+	else
+		/* short idle expected: avoid resuming right after collapse */
+		pc->delay_ms = sw_pc_delay * VIDC_PC_MAX_DELAY_MUL;
+
+	return pc->delay_ms;
+}
+
+/*
+ * Record the time of the latest command/response. Idle gaps long enough
+ * to be power collapse candidates feed the idle predictor.
+ */
+static void __pc_mark_activity(struct msm_vidc_core *core)
+{
+	struct msm_vidc_pc_stats *pc = &core->pc_stats;
+	u64 now, idle_ns, sum = 0;
+	u32 i;
+
+	now = ktime_get_ns();
+	idle_ns = now - pc->last_activity_ns;
+	if (pc->last_activity_ns &&
+	    idle_ns >= (u64)__pc_min_delay_ms(core) * NSEC_PER_MSEC) {
+		pc->actual_idle_ns = idle_ns;
+		pc->idle_history[pc->idle_index] = idle_ns;
+		pc->idle_index = (pc->idle_index + 1) % VIDC_PC_IDLE_HISTORY;
+		if (pc->idle_samples < VIDC_PC_IDLE_HISTORY)
+			pc->idle_samples++;
+
+		for (i = 0; i < pc->idle_samples; i++)
+			sum += pc->idle_history[i];
+		pc->predicted_idle_ns = div_u64(sum, pc->idle_samples);
+	}
+	pc->last_activity_ns = now;
+}
+
 static void __schedule_power_collapse_work(struct msm_vidc_core *core)
 {
+	u32 delay_ms;
+
 	if (!core->capabilities[SW_PC].value) {
 		d_vpr_l("software power collapse not enabled\n");
 		return;
 	}
 
-	if (!mod_delayed_work(core->pm_workq, &core->pm_work,
-			msecs_to_jiffies(core->capabilities[SW_PC_DELAY].value))) {
-		d_vpr_h("power collapse already scheduled\n");
+	/*
+	 * Work is armed only once; pm work handler re-arms itself based on
+	 * the last activity timestamp, so no need to modify it on every write.
+	 */
+	delay_ms = __pc_get_delay_ms(core);
+	if (!queue_delayed_work(core->pm_workq, &core->pm_work,
+			msecs_to_jiffies(delay_ms))) {
+		d_vpr_l("power collapse already scheduled\n");
 	} else {
-		d_vpr_l("power collapse scheduled for %d ms\n",
-			core->capabilities[SW_PC_DELAY].value);
+		d_vpr_l("power collapse scheduled for %d ms\n", delay_ms);
 	}
 }
 
@@ -170,8 +242,10 @@ static int __cmdq_write(struct msm_vidc_core *core, void *pkt)
 		return rc;
 
 	rc = venus_hfi_queue_cmd_write(core, pkt);
-	if (!rc)
+	if (!rc) {
+		__pc_mark_activity(core);
 		__schedule_power_collapse_work(core);
+	}
 
 	return rc;
 }
@@ -185,8 +259,10 @@ static int __cmdq_write_intr(struct msm_vidc_core *core, void *pkt, bool allow_i
 		return rc;
 
 	rc = venus_hfi_queue_cmd_write_intr(core, pkt, allow_intr);
-	if (!rc)
+	if (!rc) {
+		__pc_mark_activity(core);
 		__schedule_power_collapse_work(core);
+	}
 
 	return rc;
 }
@@ -255,7 +331,11 @@ int __prepare_pc(struct msm_vidc_core *core)
 		goto err_pc_prep;
 	}
 
-	if (__cmdq_write(core, core->packet))
+	/*
+	 * core is already powered on here, write directly so that pc prep
+	 * is not accounted as activity by the idle predictor
+	 */
+	if (venus_hfi_queue_cmd_write(core, core->packet))
 		rc = -ENOTEMPTY;
 	if (rc)
 		d_vpr_e("Failed to prepare venus for power off");
@@ -491,6 +571,8 @@ err_tzbsp_suspend:
 
 static int __resume(struct msm_vidc_core *core)
 {
+	struct msm_vidc_pc_stats *pc;
+	u64 start_ns, resume_ns;
 	int rc = 0;
 
 	if (is_core_sub_state(core, CORE_SUBSTATE_POWER_ENABLE)) {
@@ -504,6 +586,7 @@ static int __resume(struct msm_vidc_core *core)
 	if (rc)
 		return rc;
 
+	start_ns = ktime_get_ns();
 	d_vpr_h("Resuming from power collapse\n");
 	/* reset handoff done from core sub_state */
 	rc = msm_vidc_change_core_sub_state(core, CORE_SUBSTATE_GDSC_HANDOFF, 0, __func__);
@@ -558,6 +641,19 @@ static int __resume(struct msm_vidc_core *core)
 		rc = 0;
 	}
 
+	pc = &core->pc_stats;
+	resume_ns = ktime_get_ns() - start_ns;
+	pc->resume_cost_ns = pc->resume_cost_ns ?
+		(pc->resume_cost_ns * 7 + resume_ns) >> 3 : resume_ns;
+	pc->resume_count++;
+	if (pc->collapse_ns) {
+		if (start_ns - pc->collapse_ns < __pc_break_even_ns(pc))
+			pc->early_resume_count++;
+		pc->collapsed_ns += start_ns - pc->collapsed_start_ns;
+		pc->collapse_ns = 0;
+		pc->collapsed_start_ns = 0;
+	}
+
 	d_vpr_h("Resumed from power collapse\n");
 exit:
 	/* Don't reset skip_pc_count for SYS_PC_PREP cmd */
@@ -573,47 +669,13 @@ err_venus_power_on:
 	return rc;
 }
 
-static int __load_fw(struct msm_vidc_core *core)
-{
-	int rc = 0;
-
-	d_vpr_h("%s: loading video firmware\n", __func__);
-
-	/* clear all substates */
-	msm_vidc_change_core_sub_state(core, CORE_SUBSTATE_MAX - 1, 0, __func__);
-
-	trace_msm_v4l2_vidc_fw_load("START");
-	rc = __venus_power_on(core);
-	if (rc) {
-		d_vpr_e("%s: power on failed\n", __func__);
-		goto fail_power;
-	}
-
-	rc = fw_load(core);
-	if (rc)
-		goto fail_load_fw;
-
-	/*
-	 * Hand off control of regulators to h/w _after_ loading fw.
-	 * Note that the GDSC will turn off when switching from normal
-	 * (s/w triggered) to fast (HW triggered) unless the h/w vote is
-	 * present.
-	 */
-	call_res_op(core, gdsc_hw_ctrl, core);
-	trace_msm_v4l2_vidc_fw_load("END");
-
-	return rc;
-fail_load_fw:
-	__venus_power_off(core);
-fail_power:
-	trace_msm_v4l2_vidc_fw_load("END");
-	return rc;
-}
-
 static void __unload_fw(struct msm_vidc_core *core)
 {
-	if (!core->resource->fw_cookie)
+	/* powered on by venus_hfi_core_power_on(), but fw_load() failed */
+	if (!core->resource->fw_cookie) {
+		__venus_power_off(core);
 		return;
+	}
 
 	cancel_delayed_work(&core->pm_work);
 	fw_unload(core);
@@ -654,7 +716,11 @@ static int __response_handler(struct msm_vidc_core *core)
 		memset(core->response_packet, 0, core->packet_size);
 	}
 
+	/* pc_stats is shared with __cmdq_write() and the pm work handler */
+	core_lock(core, __func__);
+	__pc_mark_activity(core);
 	__schedule_power_collapse_work(core);
+	core_unlock(core, __func__);
 	__flush_debug_queue(core, core->response_packet, core->packet_size);
 
 	return rc;
@@ -701,10 +767,24 @@ void venus_hfi_pm_work_handler(struct work_struct *work)
 {
 	int rc = 0;
 	struct msm_vidc_core *core;
+	u64 delay_ns, idle_ns;
 
 	core = container_of(work, struct msm_vidc_core, pm_work.work);
 
 	core_lock(core, __func__);
+	/* msm_vidc_core_init() owns the core until fw_load() returns */
+	if (core->fw_booting)
+		goto unlock;
+
+	/* activity since the work was armed, wait for the remaining idle time */
+	delay_ns = (u64)__pc_get_delay_ms(core) * NSEC_PER_MSEC;
+	idle_ns = ktime_get_ns() - core->pc_stats.last_activity_ns;
+	if (idle_ns < delay_ns) {
+		queue_delayed_work(core->pm_workq, &core->pm_work,
+			nsecs_to_jiffies(delay_ns - idle_ns));
+		goto unlock;
+	}
+
 	d_vpr_h("%s: try power collapse\n", __func__);
 	/*
 	 * It is ok to check this variable outside the lock since
@@ -734,6 +814,9 @@ void venus_hfi_pm_work_handler(struct work_struct *work)
 	switch (rc) {
 	case 0:
 		core->skip_pc_count = 0;
+		core->pc_stats.collapse_count++;
+		core->pc_stats.collapse_ns = ktime_get_ns();
+		core->pc_stats.collapsed_start_ns = core->pc_stats.collapse_ns;
 		/* Cancel pending delayed works if any */
 		__cancel_power_collapse_work(core);
 		d_vpr_h("%s: power collapse successful!\n", __func__);
@@ -787,7 +870,13 @@ static int __sys_image_version(struct msm_vidc_core *core)
 	return 0;
 }
 
-int venus_hfi_core_init(struct msm_vidc_core *core)
+/*
+ * Core init is split around fw_load(), which msm_vidc_core_init() runs
+ * without core->lock: venus_hfi_core_power_on() sets up the interface
+ * queues and powers the core on, venus_hfi_core_init() then boots the
+ * loaded firmware and sends sys init.
+ */
+int venus_hfi_core_power_on(struct msm_vidc_core *core)
 {
 	int rc = 0;
 
@@ -801,13 +890,50 @@ int venus_hfi_core_init(struct msm_vidc_core *core)
 	if (rc)
 		goto error;
 
-	rc = __load_fw(core);
-	if (rc)
+	trace_msm_v4l2_vidc_core_init("START");
+	d_vpr_h("%s: loading video firmware\n", __func__);
+
+	/* clear all substates */
+	msm_vidc_change_core_sub_state(core, CORE_SUBSTATE_MAX - 1, 0, __func__);
+
+	trace_msm_v4l2_vidc_fw_load("START");
+	rc = __venus_power_on(core);
+	if (rc) {
+		d_vpr_e("%s: power on failed\n", __func__);
+		trace_msm_v4l2_vidc_fw_load("END");
 		goto error;
+	}
+
+	return 0;
+
+error:
+	d_vpr_e("%s(): failed\n", __func__);
+	return rc;
+}
+
+int venus_hfi_core_init(struct msm_vidc_core *core)
+{
+	int rc = 0;
+
+	d_vpr_h("%s(): core %pK\n", __func__, core);
+
+	rc = __strict_check(core, __func__);
+	if (rc)
+		return rc;
+
+	/*
+	 * Hand off control of regulators to h/w _after_ loading fw.
+	 * Note that the GDSC will turn off when switching from normal
+	 * (s/w triggered) to fast (HW triggered) unless the h/w vote is
+	 * present.
+	 */
+	call_res_op(core, gdsc_hw_ctrl, core);
+	trace_msm_v4l2_vidc_fw_load("END");
 
 	rc = call_venus_op(core, boot_firmware, core);
 	if (rc)
 		goto error;
+	trace_msm_v4l2_vidc_core_init("FW_BOOTED");
 
 	rc = call_res_op(core, llcc, core, true);
 	if (rc)
@@ -816,6 +942,7 @@ int venus_hfi_core_init(struct msm_vidc_core *core)
 	rc = __sys_init(core);
 	if (rc)
 		goto error;
+	trace_msm_v4l2_vidc_core_init("SYS_INIT_SENT");
 
 	rc = __sys_image_version(core);
 	if (rc)
@@ -908,6 +1035,12 @@ int venus_hfi_suspend(struct msm_vidc_core *core)
 		return 0;
 	}
 
+	/* msm_vidc_core_init() is loading firmware without core->lock */
+	if (core->fw_booting) {
+		d_vpr_e("%s: firmware loading\n", __func__);
+		return -EBUSY;
+	}
+
 	d_vpr_h("Suspending Venus\n");
 	rc = __power_collapse(core, true);
 	if (!rc) {
@@ -1016,6 +1149,37 @@ unlock:
 	return rc;
 }
 
+static int __session_property_batch_flush(struct msm_vidc_inst *inst)
+{
+	int rc = 0;
+
+	if (!inst->prop_batch_count)
+		return 0;
+
+	rc = __cmdq_write(inst->core, inst->packet);
+	if (!rc)
+		inst->prop_batch_sent += inst->prop_batch_count;
+	inst->prop_batch_count = 0;
+
+	return rc;
+}
+
+/*
+ * Commands built in inst->packet while a property batch is open would
+ * overwrite the pending batch: send it first, which also keeps the
+ * properties ahead of the command as without batching.
+ */
+static int __session_property_batch_sync(struct msm_vidc_inst *inst,
+	const char *func)
+{
+	if (!inst->prop_batch_count)
+		return 0;
+
+	i_vpr_l(inst, "%s: flush %u batched properties\n",
+		func, inst->prop_batch_count);
+	return __session_property_batch_flush(inst);
+}
+
 int venus_hfi_reserve_hardware(struct msm_vidc_inst *inst, u32 duration)
 {
 	struct msm_vidc_core *core;
@@ -1039,6 +1203,10 @@ int venus_hfi_reserve_hardware(struct msm_vidc_inst *inst, u32 duration)
 	else
 		payload = HFI_RESERVE_STOP;
 
+	rc = __session_property_batch_sync(inst, __func__);
+	if (rc)
+		goto unlock;
+
 	rc = hfi_create_header(inst->packet, inst->packet_size,
 		inst->session_id, core->header_id++);
 	if (rc)
@@ -1191,18 +1359,43 @@ unlock:
 	return rc;
 }
 
+/*
+ * inst->packet has to hold the whole pending arena on top of the buffer
+ * packets venus_hfi_queue_buffer() builds, so grow it along with the arena.
+ */
+static int venus_hfi_grow_inst_packet(struct msm_vidc_inst *inst, u32 size)
+{
+	struct hfi_header *hdr = (struct hfi_header *)inst->packet;
+	u8 *packet;
+
+	if (size <= inst->packet_size)
+		return 0;
+
+	packet = vzalloc(size);
+	if (!packet) {
+		i_vpr_e(inst, "%s: failed to grow packet to %u\n", __func__, size);
+		return -ENOMEM;
+	}
+	memcpy(packet, inst->packet, hdr->size);
+	vfree(inst->packet);
+	inst->packet = packet;
+	inst->packet_size = size;
+
+	return 0;
+}
+
 static int venus_hfi_cache_packet(struct msm_vidc_inst *inst)
 {
-	int rc = 0;
+	struct msm_vidc_pending_pkts *pkts = &inst->pending_pkts;
 	struct hfi_header *hdr;
-	struct hfi_pending_packet *packet;
-	struct msm_vidc_core *core;
+	u32 payload_size, capacity;
+	u8 *data;
+	int rc;
 
 	if (!inst->packet) {
 		d_vpr_e("%s: invalid params\n", __func__);
 		return -EINVAL;
 	}
-	core = inst->core;
 
 	hdr = (struct hfi_header *)inst->packet;
 	if (hdr->size < sizeof(struct hfi_header)) {
@@ -1210,23 +1403,132 @@ static int venus_hfi_cache_packet(struct msm_vidc_inst *inst)
 		return -EINVAL;
 	}
 
-	packet = msm_vidc_pool_alloc(inst, MSM_MEM_POOL_PACKET);
-	if (!packet) {
-		i_vpr_e(inst, "%s: failed to allocate pending packet\n", __func__);
+	payload_size = hdr->size - sizeof(struct hfi_header);
+	capacity = msm_vidc_pending_pkts_capacity(pkts->capacity,
+		pkts->size + payload_size);
+	if (!capacity) {
+		i_vpr_e(inst, "%s: pending packets %u + %u above max %u\n",
+			__func__, pkts->size, payload_size, PENDING_PKTS_MAX_SIZE);
 		return -ENOMEM;
 	}
+	if (capacity > pkts->capacity) {
+		data = krealloc(pkts->data, capacity, GFP_KERNEL);
+		if (!data) {
+			i_vpr_e(inst, "%s: failed to grow pending packets to %u\n",
+				__func__, capacity);
+			return -ENOMEM;
+		}
+		pkts->data = data;
+		pkts->capacity = capacity;
 
-	INIT_LIST_HEAD(&packet->list);
-	list_add_tail(&packet->list, &inst->pending_pkts);
-	packet->data = (u8 *)packet + sizeof(struct hfi_pending_packet);
+		/* keep the frame's own room on top of the arena */
+		rc = venus_hfi_grow_inst_packet(inst,
+			capacity + MSM_VIDC_SESSION_PACKET_SIZE);
+		if (rc)
+			return rc;
+		hdr = (struct hfi_header *)inst->packet;
+	}
 
-	if (hdr->size > MSM_MEM_POOL_PACKET_SIZE) {
-		i_vpr_e(inst, "%s: header size %d exceeds pool packet size %d\n",
-			__func__, hdr->size, MSM_MEM_POOL_PACKET_SIZE);
-		return -EINVAL;
+	memcpy(pkts->data + pkts->size, (u8 *)hdr + sizeof(struct hfi_header),
+		payload_size);
+	pkts->size += payload_size;
+	pkts->num_packets += hdr->num_packets;
+
+	return 0;
+}
+
+/*
+ * Append a property packet to the batch held in inst->packet, flushing
+ * the pending header first when the new packet would not fit.
+ */
+static int __session_property_batch_add(struct msm_vidc_inst *inst,
+	u32 pkt_type, u32 flags, u32 port, u32 payload_type,
+	void *payload, u32 payload_size)
+{
+	struct msm_vidc_core *core = inst->core;
+	struct hfi_header *hdr = (struct hfi_header *)inst->packet;
+	u32 pkt_size = sizeof(struct hfi_packet) + payload_size;
+	int rc = 0;
+
+	if (inst->prop_batch_count &&
+	    hdr->size + pkt_size > inst->packet_size) {
+		rc = __session_property_batch_flush(inst);
+		if (rc)
+			return rc;
+	}
+
+	if (!inst->prop_batch_count) {
+		rc = hfi_create_header(inst->packet, inst->packet_size,
+				inst->session_id, core->header_id++);
+		if (rc)
+			return rc;
 	}
-	memcpy(packet->data, inst->packet, hdr->size);
 
+	rc = hfi_create_packet(inst->packet, inst->packet_size,
+				pkt_type,
+				flags,
+				payload_type,
+				port,
+				core->packet_id++,
+				payload,
+				payload_size);
+	if (rc)
+		return rc;
+
+	inst->prop_batch_count++;
+
+	return 0;
+}
+
+/*
+ * Collect subsequent property packets of this session into a single hfi
+ * header instead of one queue write per property. The batch is staged in
+ * inst->packet: other session commands issued meanwhile flush it first.
+ *
+ * A batch that outgrows inst->packet is sent in chunks as it goes, so a
+ * failure part way leaves the earlier chunks already with firmware.
+ */
+void venus_hfi_session_property_batch_begin(struct msm_vidc_inst *inst)
+{
+	inst->prop_batch = true;
+	inst->prop_batch_count = 0;
+	inst->prop_batch_sent = 0;
+}
+
+/*
+ * Sends the rest of the batch, or drops it when @discard is set. @sent
+ * returns the number of batched properties written to the command queue,
+ * including chunks flushed before an error.
+ */
+int venus_hfi_session_property_batch_end(struct msm_vidc_inst *inst,
+	bool discard, u32 *sent)
+{
+	int rc = 0;
+	struct msm_vidc_core *core;
+
+	core = inst->core;
+	core_lock(core, __func__);
+
+	inst->prop_batch = false;
+	if (discard)
+		inst->prop_batch_count = 0;
+	if (!inst->prop_batch_count)
+		goto unlock;
+
+	if (!__valdiate_session(core, inst, __func__)) {
+		inst->prop_batch_count = 0;
+		rc = -EINVAL;
+		goto unlock;
+	}
+
+	i_vpr_l(inst, "%s: sending %u batched properties\n",
+		__func__, inst->prop_batch_count);
+	rc = __session_property_batch_flush(inst);
+
+unlock:
+	if (sent)
+		*sent = inst->prop_batch_sent;
+	core_unlock(core, __func__);
 	return rc;
 }
 
@@ -1249,6 +1551,16 @@ int venus_hfi_session_property(struct msm_vidc_inst *inst,
 		goto unlock;
 	}
 
+	if (inst->prop_batch && !inst->request) {
+		rc = __session_property_batch_add(inst, pkt_type, flags, port,
+			payload_type, payload, payload_size);
+		goto unlock;
+	}
+
+	rc = __session_property_batch_sync(inst, __func__);
+	if (rc)
+		goto unlock;
+
 	rc = hfi_create_header(inst->packet, inst->packet_size,
 				inst->session_id, core->header_id++);
 	if (rc)
@@ -1690,6 +2002,8 @@ int venus_hfi_queue_super_buffer(struct msm_vidc_inst *inst,
 		if (rc)
 			goto unlock;
 
+		buffer->submit_time_ns = ktime_get_ns();
+		msm_vidc_record_frame_submit(inst, buffer, hfi_buffer.timestamp);
 		/* update start timestamp */
 		msm_vidc_add_buffer_stats(inst, buffer, hfi_buffer.timestamp);
 
@@ -1705,18 +2019,14 @@ unlock:
 
 static int venus_hfi_add_pending_packets(struct msm_vidc_inst *inst)
 {
+	struct msm_vidc_pending_pkts *pkts = &inst->pending_pkts;
+	struct hfi_header *hdr;
 	int rc = 0;
-	int num_packets = 0;
-	struct hfi_pending_packet *pkt_info, *dummy;
-	struct hfi_header *hdr, *src_hdr;
-	struct hfi_packet *src_pkt;
-	struct msm_vidc_core *core;
 
 	if (!inst->packet) {
 		d_vpr_e("%s: invalid params\n", __func__);
 		return -EINVAL;
 	}
-	core = inst->core;
 
 	hdr = (struct hfi_header *)inst->packet;
 	if (hdr->size < sizeof(struct hfi_header)) {
@@ -1725,25 +2035,26 @@ static int venus_hfi_add_pending_packets(struct msm_vidc_inst *inst)
 		return -EINVAL;
 	}
 
-	list_for_each_entry_safe(pkt_info, dummy, &inst->pending_pkts, list) {
-		src_hdr = (struct hfi_header *)(pkt_info->data);
-		num_packets = src_hdr->num_packets;
-		src_pkt = (struct hfi_packet *)((u8 *)src_hdr + sizeof(struct hfi_header));
-		while (num_packets > 0) {
-			memcpy((u8 *)hdr + hdr->size, (void *)src_pkt, src_pkt->size);
-			hdr->num_packets++;
-			hdr->size += src_pkt->size;
-			num_packets--;
-			src_pkt = (struct hfi_packet *)((u8 *)src_pkt + src_pkt->size);
-			if ((u8 *)src_pkt < (u8 *)src_hdr ||
-					(u8 *)src_pkt > (u8 *)src_hdr + hdr->size) {
-				i_vpr_e(inst, "%s: invalid packet address\n", __func__);
-				return -EINVAL;
-			}
-		}
-		list_del(&pkt_info->list);
-		msm_vidc_pool_free(inst, pkt_info);
+	if (!pkts->size)
+		goto exit;
+
+	if (hdr->size + pkts->size > inst->packet_size) {
+		i_vpr_e(inst, "%s: pending packets %u do not fit, hdr size %u packet size %u\n",
+			__func__, pkts->size, hdr->size, inst->packet_size);
+		rc = -EINVAL;
+		goto exit;
 	}
+
+	memcpy((u8 *)hdr + hdr->size, pkts->data, pkts->size);
+	hdr->size += pkts->size;
+	hdr->num_packets += pkts->num_packets;
+
+exit:
+	pkts->last_frame_bytes = pkts->size;
+	pkts->max_frame_bytes = max(pkts->max_frame_bytes, pkts->size);
+	pkts->size = 0;
+	pkts->num_packets = 0;
+
 	return rc;
 }
 
@@ -1753,6 +2064,7 @@ int venus_hfi_queue_buffer(struct msm_vidc_inst *inst,
 	int rc = 0;
 	struct msm_vidc_core *core;
 	struct hfi_buffer hfi_buffer, hfi_meta_buffer;
+	u32 packet_id;
 
 	if (!inst->packet) {
 		d_vpr_e("%s: invalid params\n", __func__);
@@ -1775,13 +2087,14 @@ int venus_hfi_queue_buffer(struct msm_vidc_inst *inst,
 	if (rc)
 		goto unlock;
 
+	packet_id = core->packet_id++;
 	rc = hfi_create_packet(inst->packet,
 			inst->packet_size,
 			HFI_CMD_BUFFER,
 			HFI_HOST_FLAGS_INTR_REQUIRED,
 			HFI_PAYLOAD_STRUCTURE,
 			get_hfi_port_from_buffer_type(inst, buffer->type),
-			core->packet_id++,
+			packet_id,
 			&hfi_buffer,
 			sizeof(hfi_buffer));
 	if (rc)
@@ -1832,8 +2145,13 @@ int venus_hfi_queue_buffer(struct msm_vidc_inst *inst,
 	if (rc)
 		goto unlock;
 
+	buffer->submit_time_ns = ktime_get_ns();
+	msm_vidc_record_frame_submit(inst, buffer, hfi_buffer.timestamp);
 	/* update start timestamp */
 	msm_vidc_add_buffer_stats(inst, buffer, hfi_buffer.timestamp);
+	trace_msm_vidc_buffer_stage(inst, MSM_VIDC_BUF_STAGE_SUBMIT,
+		buffer->type, buffer->index, buffer->device_addr,
+		buffer->timestamp, packet_id);
 
 unlock:
 	core_unlock(core, __func__);
@@ -1893,27 +2211,104 @@ unlock:
 	return rc;
 }
 
+/*
+ * clock and rail voting may sleep for a long time in the clock framework,
+ * so only record the latest requested rate here and let clk_work apply it.
+ * Requests arriving while the work is pending are coalesced. Posting only
+ * takes clk_req_lock, never core->lock, so qbuf does not wait behind a
+ * clock change in progress.
+ */
 int venus_hfi_scale_clocks(struct msm_vidc_inst *inst, u64 freq)
 {
-	int rc = 0;
+	struct clock_scaling_stats *stats;
 	struct msm_vidc_core *core;
 
 	core = inst->core;
+	stats = &core->resource->scaling_stats;
+
+	spin_lock(&core->clk_req_lock);
+	stats->requested++;
+	core->clk_req_freq = freq;
+	if (!queue_work(core->pm_workq, &core->clk_work))
+		stats->coalesced++;
+	spin_unlock(&core->clk_req_lock);
+
+	return 0;
+}
+
+/* requested rate as clk_work applies it: capped by the thermal state */
+static u64 __clk_req_capped(struct msm_vidc_core *core, u64 freq)
+{
+	u64 max_freq;
+
+	max_freq = msm_vidc_thermal_max_freq(core);
+	if (max_freq && freq > max_freq && !msm_vidc_clock_voting)
+		freq = max_freq;
+
+	return freq;
+}
+
+/*
+ * reapply the last requested rate after the thermal cap changed. A power
+ * collapsed core is left collapsed: only the rate power_on programs on the
+ * next resume is updated, clk_work is not woken for it.
+ */
+int venus_hfi_reapply_clocks(struct msm_vidc_core *core)
+{
+	u64 freq;
+	int rc;
+
+	rc = __strict_check(core, __func__);
+	if (rc)
+		return rc;
+
+	spin_lock(&core->clk_req_lock);
+	freq = core->clk_req_freq;
+	spin_unlock(&core->clk_req_lock);
+	if (!freq || !core_in_valid_state(core))
+		return 0;
+
+	if (!is_core_sub_state(core, CORE_SUBSTATE_POWER_ENABLE)) {
+		core->power.clk_freq = __clk_req_capped(core, freq);
+		return 0;
+	}
+
+	queue_work(core->pm_workq, &core->clk_work);
+
+	return 0;
+}
+
+void venus_hfi_clk_work_handler(struct work_struct *work)
+{
+	struct msm_vidc_core *core;
+	u64 freq;
+	int rc = 0;
+
+	core = container_of(work, struct msm_vidc_core, clk_work);
+
+	spin_lock(&core->clk_req_lock);
+	freq = core->clk_req_freq;
+	spin_unlock(&core->clk_req_lock);
 
 	core_lock(core, __func__);
-	rc = __resume(core);
-	if (rc) {
-		i_vpr_e(inst, "%s: Resume from power collapse failed\n", __func__);
-		goto exit;
+	/* core deinited after the request was queued - nothing to scale */
+	if (!core_in_valid_state(core))
+		goto unlock;
+
+	freq = __clk_req_capped(core, freq);
+
+	/* power collapsed: power_on programs power.clk_freq on next resume */
+	if (!is_core_sub_state(core, CORE_SUBSTATE_POWER_ENABLE)) {
+		core->power.clk_freq = freq;
+		goto unlock;
 	}
+
 	rc = call_res_op(core, set_clks, core, freq);
 	if (rc)
-		goto exit;
+		d_vpr_e("%s: failed to set clock rate %llu\n", __func__, freq);
 
-exit:
+unlock:
 	core_unlock(core, __func__);
-
-	return rc;
 }
 
 int venus_hfi_scale_buses(struct msm_vidc_inst *inst, u64 bw_ddr, u64 bw_llcc)
@@ -1952,6 +2347,10 @@ int venus_hfi_set_ir_period(struct msm_vidc_inst *inst, u32 ir_type,
 
 	ir_period = inst->capabilities[cap_id].value;
 
+	rc = __session_property_batch_sync(inst, __func__);
+	if (rc)
+		goto exit;
+
 	rc = hfi_create_header(inst->packet, inst->packet_size,
 			       inst->session_id, core->header_id++);
 	if (rc)
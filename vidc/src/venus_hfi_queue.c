@@ -79,7 +79,7 @@ static int __write_queue(struct msm_vidc_iface_q_info *qinfo, u8 *packet,
 		return -ENOENT;
 	}
 
-	if (msm_vidc_debug & VIDC_PKT)
+	if (msm_vidc_log_on(VIDC_PKT))
 		__dump_packet(packet, __func__, qinfo);
 
 	// TODO: handle writing packet
@@ -255,7 +255,7 @@ static int __read_queue(struct msm_vidc_iface_q_info *qinfo, u8 *packet,
 
 	*pb_tx_req_is_set = (queue->qhdr_tx_req == 1) ? 1 : 0;
 
-	if ((msm_vidc_debug & VIDC_PKT) &&
+	if (msm_vidc_log_on(VIDC_PKT) &&
 		!(queue->qhdr_type & HFI_Q_ID_CTRL_TO_HOST_DEBUG_Q)) {
 		__dump_packet(packet, __func__, qinfo);
 	}
@@ -506,13 +506,13 @@ int venus_hfi_queue_init(struct msm_vidc_core *core)
 	mem.region = MSM_VIDC_NON_SECURE;
 	mem.size = TOTAL_QSIZE;
 	mem.secure = false;
-	mem.map_kernel = true;
+	mem.map_kernel = msm_vidc_buffer_map_kernel(mem.type);
 	rc = call_mem_op(core, memory_alloc_map, core, &mem);
 	if (rc) {
 		d_vpr_e("%s: alloc and map failed\n", __func__);
 		goto fail_alloc_queue;
 	}
-	core->iface_q_table.align_virtual_addr = mem.kvaddr;
+	core->iface_q_table.align_virtual_addr = msm_vidc_mem_kvaddr(&mem);
 	core->iface_q_table.align_device_addr = mem.device_addr;
 	core->iface_q_table.mem = mem;
 
@@ -567,13 +567,13 @@ int venus_hfi_queue_init(struct msm_vidc_core *core)
 	mem.region = MSM_VIDC_NON_SECURE;
 	mem.size = ALIGNED_SFR_SIZE;
 	mem.secure = false;
-	mem.map_kernel = true;
+	mem.map_kernel = msm_vidc_buffer_map_kernel(mem.type);
 	rc = call_mem_op(core, memory_alloc_map, core, &mem);
 	if (rc) {
 		d_vpr_e("%s: sfr alloc and map failed\n", __func__);
 		goto fail_alloc_queue;
 	}
-	core->sfr.align_virtual_addr = mem.kvaddr;
+	core->sfr.align_virtual_addr = msm_vidc_mem_kvaddr(&mem);
 	core->sfr.align_device_addr = mem.device_addr;
 	core->sfr.mem = mem;
 
@@ -601,13 +601,13 @@ int venus_hfi_queue_init(struct msm_vidc_core *core)
 	mem.region = MSM_VIDC_NON_SECURE;
 	mem.size = ALIGNED_MMAP_BUF_SIZE;
 	mem.secure = false;
-	mem.map_kernel = true;
+	mem.map_kernel = msm_vidc_buffer_map_kernel(mem.type);
 	rc = call_mem_op(core, memory_alloc_map, core, &mem);
 	if (rc) {
 		d_vpr_e("%s: mmap buffer alloc and map failed\n", __func__);
 		goto fail_alloc_queue;
 	}
-	core->mmap_buf.align_virtual_addr = mem.kvaddr;
+	core->mmap_buf.align_virtual_addr = msm_vidc_mem_kvaddr(&mem);
 	core->mmap_buf.align_device_addr = mem.device_addr;
 	core->mmap_buf.mem_size = ALIGNED_MMAP_BUF_SIZE;
 	core->mmap_buf.mem = mem;
@@ -15,6 +15,8 @@
 #include "msm_vidc_memory.h"
 #include "msm_vidc_fence.h"
 #include "msm_vidc_platform.h"
+#include "msm_vidc_power.h"
+#include "msm_vidc_events.h"
 
 #define check_in_range(range, val) (((range.begin) < (val)) && ((range.end) > (val)))
 
@@ -729,6 +731,8 @@ static int handle_input_buffer(struct msm_vidc_inst *inst,
 		print_vidc_buffer(VIDC_ERR, "err ", "not queued", inst, buf);
 		return 0;
 	}
+	trace_msm_vidc_buffer_stage(inst, MSM_VIDC_BUF_STAGE_FW_DONE,
+		buf->type, buf->index, buf->device_addr, buf->timestamp, 0);
 
 	if (is_decode_session(inst) && inst->codec == MSM_VIDC_AV1) {
 		if (inst->hfi_frame_info.av1_tile_rows_columns) {
@@ -744,6 +748,7 @@ static int handle_input_buffer(struct msm_vidc_inst *inst,
 	}
 
 	buf->data_size = buffer->data_size;
+	msm_vidc_update_input_size(inst, buf);
 	buf->attr &= ~MSM_VIDC_ATTR_QUEUED;
 	buf->attr |= MSM_VIDC_ATTR_DEQUEUED;
 
@@ -894,7 +899,6 @@ static int handle_output_buffer(struct msm_vidc_inst *inst,
 			__func__, buffer->index, buffer->base_address);
 		return 0;
 	}
-
 	buf->data_offset = buffer->data_offset;
 	buf->data_size = buffer->data_size;
 	buf->timestamp = buffer->timestamp;
@@ -988,8 +992,12 @@ static int handle_output_buffer(struct msm_vidc_inst *inst,
 	if (is_ts_reorder_allowed(inst) && buf->data_size)
 		msm_vidc_ts_reorder_get_first_timestamp(inst, &buf->timestamp);
 
+	/* logged with the timestamp vb2_done and dqbuf will report */
+	trace_msm_vidc_buffer_stage(inst, MSM_VIDC_BUF_STAGE_FW_DONE,
+		buf->type, buf->index, buf->device_addr, buf->timestamp, 0);
 	print_vidc_buffer(VIDC_HIGH, "high", "dqbuf", inst, buf);
 	msm_vidc_update_stats(inst, buf, MSM_VIDC_DEBUGFS_EVENT_FBD);
+	msm_vidc_update_frame_time(inst, buf, buffer->timestamp);
 
 	/* fbd: print stats and remove entry */
 	msm_vidc_remove_buffer_stats(inst, buf, buffer->timestamp);
@@ -1584,6 +1592,7 @@ static int handle_dpb_list_property(struct msm_vidc_inst *inst,
 		return -EINVAL;
 	}
 	memcpy(inst->dpb_list_payload, payload_start, payload_size);
+	msm_vdec_update_dpb_slots(inst);
 
 	/*
 	 * dpb_list_payload details:
@@ -1923,40 +1932,134 @@ exit:
 	return rc;
 }
 
+static const struct msm_vidc_inst_hfi_range session_be[HFI_PKT_CLASS_MAX] = {
+	[HFI_PKT_CLASS_SESSION_ERROR] =
+		{HFI_SESSION_ERROR_BEGIN,  HFI_SESSION_ERROR_END,  handle_session_error    },
+	[HFI_PKT_CLASS_INFORMATION] =
+		{HFI_INFORMATION_BEGIN,    HFI_INFORMATION_END,    handle_session_info     },
+	[HFI_PKT_CLASS_PROPERTY] =
+		{HFI_PROP_BEGIN,           HFI_PROP_END,           handle_session_property },
+	[HFI_PKT_CLASS_COMMAND] =
+		{HFI_CMD_BEGIN,            HFI_CMD_END,            handle_session_command  },
+};
+
+/* packet class lookup, indexed by the range byte of the packet type */
+#define HFI_PKT_RANGE_INDEX(type) ((type) >> 24)
+static const u8 session_pkt_class[] = {
+	[HFI_PKT_RANGE_INDEX(HFI_CMD_BEGIN)]           = HFI_PKT_CLASS_COMMAND,
+	[HFI_PKT_RANGE_INDEX(HFI_PROP_BEGIN)]          = HFI_PKT_CLASS_PROPERTY,
+	[HFI_PKT_RANGE_INDEX(HFI_SESSION_ERROR_BEGIN)] = HFI_PKT_CLASS_SESSION_ERROR,
+	[HFI_PKT_RANGE_INDEX(HFI_INFORMATION_BEGIN)]   = HFI_PKT_CLASS_INFORMATION,
+};
+
+static u32 get_session_pkt_class(struct hfi_packet *packet)
+{
+	u32 index, pkt_class;
+
+	index = HFI_PKT_RANGE_INDEX(packet->type);
+	if (index >= ARRAY_SIZE(session_pkt_class))
+		return HFI_PKT_CLASS_NONE;
+
+	pkt_class = session_pkt_class[index];
+	if (pkt_class == HFI_PKT_CLASS_NONE ||
+	    !check_in_range(session_be[pkt_class], packet->type))
+		return HFI_PKT_CLASS_NONE;
+
+	return pkt_class;
+}
+
+static void queue_session_pkt(struct msm_vidc_hfi_dispatch *dispatch,
+	u32 pkt_class, u32 offset)
+{
+	dispatch->offset[pkt_class][dispatch->count[pkt_class]++] = offset;
+}
+
+/*
+ * Validate and classify all packets of a session response in a single
+ * walk. Each packet is queued into the list of its class, preserving
+ * the packet order within the class. Packets flagged with session error
+ * are additionally queued into the session error list.
+ */
+static int decode_session_packets(struct msm_vidc_core *core,
+	struct hfi_header *hdr, const char *function)
+{
+	struct msm_vidc_hfi_dispatch *dispatch = &core->response_dispatch;
+	struct hfi_packet *packet;
+	u8 *pkt, *start_pkt;
+	u32 pkt_class;
+	int i, rc = 0;
+
+	if (hdr->size < sizeof(struct hfi_header) + sizeof(struct hfi_packet)) {
+		d_vpr_e("%s: invalid header size %d\n", __func__, hdr->size);
+		return -EINVAL;
+	}
+
+	if (hdr->num_packets > HFI_RESPONSE_MAX_PACKETS) {
+		d_vpr_e("%s: invalid num packets %d\n", __func__, hdr->num_packets);
+		return -EINVAL;
+	}
+
+	memset(dispatch->count, 0, sizeof(dispatch->count));
+	dispatch->found_ipsc = false;
+
+	start_pkt = (u8 *)((u8 *)hdr + sizeof(struct hfi_header));
+	pkt = start_pkt;
+	for (i = 0; i < hdr->num_packets; i++) {
+		packet = (struct hfi_packet *)pkt;
+		rc = validate_packet(pkt, core->response_packet, core->packet_size, function);
+		if (rc)
+			return rc;
+
+		pkt_class = get_session_pkt_class(packet);
+		if ((packet->flags & HFI_FW_FLAGS_SESSION_ERROR) ||
+		    pkt_class == HFI_PKT_CLASS_SESSION_ERROR)
+			queue_session_pkt(dispatch, HFI_PKT_CLASS_SESSION_ERROR,
+				pkt - start_pkt);
+		if (pkt_class != HFI_PKT_CLASS_NONE &&
+		    pkt_class != HFI_PKT_CLASS_SESSION_ERROR)
+			queue_session_pkt(dispatch, pkt_class, pkt - start_pkt);
+
+		/* search for input port settings change pkt */
+		if (packet->type == HFI_CMD_SETTINGS_CHANGE &&
+		    packet->port == HFI_PORT_BITSTREAM)
+			dispatch->found_ipsc = true;
+
+		pkt += packet->size;
+	}
+
+	return 0;
+}
+
 static int __handle_session_response(struct msm_vidc_inst *inst,
 				     struct hfi_header *hdr)
 {
-	int rc = 0;
+	struct msm_vidc_core *core = inst->core;
+	struct msm_vidc_hfi_dispatch *dispatch = &core->response_dispatch;
 	struct hfi_packet *packet;
-	u8 *pkt, *start_pkt;
+	u8 *start_pkt;
 	bool dequeue = false;
-	int i, j;
-	static const struct msm_vidc_inst_hfi_range be[] = {
-		{HFI_SESSION_ERROR_BEGIN,  HFI_SESSION_ERROR_END,  handle_session_error    },
-		{HFI_INFORMATION_BEGIN,    HFI_INFORMATION_END,    handle_session_info     },
-		{HFI_PROP_BEGIN,           HFI_PROP_END,           handle_session_property },
-		{HFI_CMD_BEGIN,            HFI_CMD_END,            handle_session_command  },
-	};
+	u32 pkt_class, i;
+	int rc = 0;
 
 	memset(&inst->hfi_frame_info, 0, sizeof(struct msm_vidc_hfi_frame_info));
 	start_pkt = (u8 *)((u8 *)hdr + sizeof(struct hfi_header));
-	for (i = 0; i < ARRAY_SIZE(be); i++) {
-		pkt = start_pkt;
-		for (j = 0; j < hdr->num_packets; j++) {
-			packet = (struct hfi_packet *)pkt;
+	for (pkt_class = HFI_PKT_CLASS_SESSION_ERROR; pkt_class < HFI_PKT_CLASS_MAX; pkt_class++) {
+		for (i = 0; i < dispatch->count[pkt_class]; i++) {
+			packet = (struct hfi_packet *)(start_pkt + dispatch->offset[pkt_class][i]);
 			/* handle session error */
-			if (packet->flags & HFI_FW_FLAGS_SESSION_ERROR) {
+			if (pkt_class == HFI_PKT_CLASS_SESSION_ERROR &&
+			    (packet->flags & HFI_FW_FLAGS_SESSION_ERROR)) {
 				i_vpr_e(inst, "%s: received session error %#x\n",
 					__func__, packet->type);
 				handle_session_error(inst, packet);
+				/* queued only because of the error flag */
+				if (!check_in_range(session_be[pkt_class], packet->type))
+					continue;
 			}
-			if (check_in_range(be[i], packet->type)) {
-				dequeue |= (packet->type == HFI_CMD_BUFFER);
-				rc = be[i].handle(inst, packet);
-				if (rc)
-					msm_vidc_change_state(inst, MSM_VIDC_ERROR, __func__);
-			}
-			pkt += packet->size;
+			dequeue |= (packet->type == HFI_CMD_BUFFER);
+			rc = session_be[pkt_class].handle(inst, packet);
+			if (rc)
+				msm_vidc_change_state(inst, MSM_VIDC_ERROR, __func__);
 		}
 	}
 
@@ -1970,14 +2073,89 @@ static int __handle_session_response(struct msm_vidc_inst *inst,
 	return rc;
 }
 
+/*
+ * Check whether a session response only returns input buffers of a
+ * streaming session. Such a response touches nothing but the buffer
+ * lists, timestamps and stats, so it can be handled with buffer_lock
+ * alone instead of waiting behind a control holding the instance lock.
+ * Must be called with buffer_lock held.
+ */
+static bool is_input_buffer_done_only(struct msm_vidc_inst *inst,
+				      struct hfi_header *hdr)
+{
+	struct msm_vidc_core *core = inst->core;
+	struct msm_vidc_hfi_dispatch *dispatch = &core->response_dispatch;
+	struct hfi_packet *packet;
+	struct hfi_buffer *buffer;
+	u32 port, buf_type, i;
+	u8 *start_pkt;
+
+	if (!is_state(inst, MSM_VIDC_STREAMING) || dispatch->found_ipsc)
+		return false;
+
+	if (dispatch->count[HFI_PKT_CLASS_SESSION_ERROR] ||
+	    dispatch->count[HFI_PKT_CLASS_INFORMATION] ||
+	    dispatch->count[HFI_PKT_CLASS_PROPERTY] ||
+	    !dispatch->count[HFI_PKT_CLASS_COMMAND])
+		return false;
+
+	if (msm_vidc_is_super_buffer(inst))
+		return false;
+
+	if (is_decode_session(inst)) {
+		port = HFI_PORT_BITSTREAM;
+		buf_type = HFI_BUFFER_BITSTREAM;
+	} else {
+		port = HFI_PORT_RAW;
+		buf_type = HFI_BUFFER_RAW;
+	}
+
+	start_pkt = (u8 *)((u8 *)hdr + sizeof(struct hfi_header));
+	for (i = 0; i < dispatch->count[HFI_PKT_CLASS_COMMAND]; i++) {
+		packet = (struct hfi_packet *)(start_pkt +
+			dispatch->offset[HFI_PKT_CLASS_COMMAND][i]);
+		if (packet->type != HFI_CMD_BUFFER || packet->port != port ||
+		    packet->payload_info != HFI_PAYLOAD_STRUCTURE ||
+		    packet->size < sizeof(struct hfi_packet) + sizeof(struct hfi_buffer))
+			return false;
+
+		buffer = (struct hfi_buffer *)((u8 *)packet + sizeof(struct hfi_packet));
+		if (buffer->type != buf_type ||
+		    buffer->flags & (HFI_BUF_FW_FLAG_LAST | HFI_BUF_FW_FLAG_PSC_LAST))
+			return false;
+	}
+
+	return true;
+}
+
+static int handle_input_buffer_done(struct msm_vidc_inst *inst,
+				    struct hfi_header *hdr)
+{
+	struct msm_vidc_core *core = inst->core;
+	struct msm_vidc_hfi_dispatch *dispatch = &core->response_dispatch;
+	struct hfi_packet *packet;
+	u8 *start_pkt;
+	u32 i;
+	int rc = 0;
+
+	memset(&inst->hfi_frame_info, 0, sizeof(struct msm_vidc_hfi_frame_info));
+	start_pkt = (u8 *)((u8 *)hdr + sizeof(struct hfi_header));
+	for (i = 0; i < dispatch->count[HFI_PKT_CLASS_COMMAND]; i++) {
+		packet = (struct hfi_packet *)(start_pkt +
+			dispatch->offset[HFI_PKT_CLASS_COMMAND][i]);
+		rc = handle_session_buffer(inst, packet);
+		if (rc)
+			return rc;
+	}
+
+	return handle_dequeue_buffers(inst);
+}
+
 static int handle_session_response(struct msm_vidc_core *core,
 				   struct hfi_header *hdr)
 {
 	struct msm_vidc_inst *inst;
-	struct hfi_packet *packet;
-	u8 *pkt;
-	int i, rc = 0;
-	bool found_ipsc = false;
+	int rc = 0;
 
 	inst = get_inst(core, hdr->session_id);
 	if (!inst) {
@@ -1985,22 +2163,24 @@ static int handle_session_response(struct msm_vidc_core *core,
 		return -EINVAL;
 	}
 
-	inst_lock(inst, __func__);
-	/* search for cmd settings change pkt */
-	pkt = (u8 *)((u8 *)hdr + sizeof(struct hfi_header));
-	for (i = 0; i < hdr->num_packets; i++) {
-		packet = (struct hfi_packet *)pkt;
-		if (packet->type == HFI_CMD_SETTINGS_CHANGE) {
-			if (packet->port == HFI_PORT_BITSTREAM) {
-				found_ipsc = true;
-				break;
-			}
+	buffer_lock(inst, __func__);
+	if (is_input_buffer_done_only(inst, hdr)) {
+		rc = handle_input_buffer_done(inst, hdr);
+		buffer_unlock(inst, __func__);
+		if (rc) {
+			/* state change needs the instance lock */
+			inst_lock(inst, __func__);
+			msm_vidc_change_state(inst, MSM_VIDC_ERROR, __func__);
+			inst_unlock(inst, __func__);
 		}
-		pkt += packet->size;
+		put_inst(inst);
+		return rc;
 	}
+	buffer_unlock(inst, __func__);
 
+	inst_lock(inst, __func__);
 	/* if ipsc packet is found, initialise subsc_params */
-	if (found_ipsc)
+	if (core->response_dispatch.found_ipsc)
 		msm_vdec_init_input_subcr_params(inst);
 
 	rc = __handle_session_response(inst, hdr);
@@ -2019,7 +2199,10 @@ int handle_response(struct msm_vidc_core *core, void *response)
 	int rc = 0;
 
 	hdr = (struct hfi_header *)response;
-	rc = validate_hdr_packet(core, hdr, __func__);
+	if (!hdr->session_id)
+		rc = validate_hdr_packet(core, hdr, __func__);
+	else
+		rc = decode_session_packets(core, hdr, __func__);
 	if (rc) {
 		d_vpr_e("%s: hdr pkt validation failed\n", __func__);
 		return handle_system_error(core, NULL);